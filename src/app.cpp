@@ -8,6 +8,9 @@
 #include "err.h"
 #include "app.h"
 #include "renderer.h"
+#include "benchmark.h"
+#include "vertexformat.h"
+#include "meshcache.h"
 
 #include "viewport.h"
 #include "camera.h"
@@ -21,10 +24,33 @@
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <cstring>
+
+// Frames rendered by --headless without --frames
+static const int DEFAULT_HEADLESS_FRAMES = 1000;
 
 App::App()
-    : m_Worker(new Renderer)
-    , m_Joystick(nullptr)
+    : m_Joystick(nullptr)
+    , m_Headless(false)
+    , m_FrameLimit(0)
+    , m_NumCubes(1)
+    , m_NumCylinders(1)
+    , m_NumSpheres(1)
+    , m_Benchmark(nullptr)
+    , m_Strips(false)
+    , m_Instancing(false)
+    , m_Indirect(false)
+    , m_Attach(false)
+    , m_Culling(true)
+    , m_SpatialIndex(false)
+    , m_DetailLevels(false)
+    , m_ArenaPageSize(-1)
+    , m_InitBudget(0)
+    , m_TargetFrameTime(0)
+    , m_NumInitialized(0)
+    , m_NumFailed(0)
 {
 }
 
@@ -34,6 +60,92 @@ App::~App()
 
 void App::Init(int argc, char* argv[])
 {
+    for ( int i = 1; i < argc; ++i ) {
+        if ( std::strcmp( argv[i], "--headless" ) == 0 ) {
+            m_Headless = true;
+        }
+        else if ( std::strcmp( argv[i], "--instancing" ) == 0 ) {
+            m_Instancing = true;
+        }
+        else if ( std::strcmp( argv[i], "--indirect" ) == 0 ) {
+            m_Instancing = true;
+            m_Indirect   = true;
+        }
+        else if ( std::strcmp( argv[i], "--attach" ) == 0 ) {
+            m_Attach = true;
+        }
+        else if ( std::strcmp( argv[i], "--no-culling" ) == 0 ) {
+            m_Culling = false;
+        }
+        else if ( std::strcmp( argv[i], "--bvh" ) == 0 ) {
+            m_SpatialIndex = true;
+        }
+        else if ( std::strcmp( argv[i], "--lod" ) == 0 ) {
+            m_DetailLevels = true;
+        }
+        else if ( i+1 < argc ) {
+            // options with a numeric argument
+            if ( std::strcmp( argv[i], "--frames" ) == 0 ) {
+                m_FrameLimit = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--cubes" ) == 0 ) {
+                m_NumCubes = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--cylinders" ) == 0 ) {
+                m_NumCylinders = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--spheres" ) == 0 ) {
+                m_NumSpheres = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--init-budget" ) == 0 ) {
+                m_InitBudget = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--target-frame-time" ) == 0 ) {
+                m_TargetFrameTime = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--arena-page-size" ) == 0 ) {
+                m_ArenaPageSize = boost::lexical_cast<int>( argv[++i] );
+            }
+            else if ( std::strcmp( argv[i], "--bench" ) == 0 ) {
+                m_Benchmark = argv[++i];
+            }
+            else if ( std::strcmp( argv[i], "--vertex-format" ) == 0 ) {
+                ++i;
+                if ( std::strcmp( argv[i], "float" ) == 0 ) {
+                    VertexFormat::SetDefault( VertexFormat::Float() );
+                } else if ( std::strcmp( argv[i], "compact" ) == 0 ) {
+                    VertexFormat::SetDefault( VertexFormat::Compact() );
+                } else {
+                    THROW( "Unknown vertex format '%s'. Use float or compact", argv[i] );
+                }
+            }
+            else if ( std::strcmp( argv[i], "--topology" ) == 0 ) {
+                ++i;
+                if ( std::strcmp( argv[i], "triangles" ) == 0 ) {
+                    m_Strips = false;
+                } else if ( std::strcmp( argv[i], "strips" ) == 0 ) {
+                    m_Strips = true;
+                } else {
+                    THROW( "Unknown topology '%s'. Use triangles or strips", argv[i] );
+                }
+            }
+        }
+    }
+    if ( m_Benchmark ) {
+        // CPU only - no SDL, no GL
+        return;
+    }
+
+    if ( m_Headless ) {
+        // Nobody can close an offscreen context - stop after a fixed number of frames
+        if ( m_FrameLimit <= 0 ) {
+            m_FrameLimit = DEFAULT_HEADLESS_FRAMES;
+        }
+        // No X server required. SDL still provides timers and the event queue
+        SDL_putenv( (char*)"SDL_VIDEODRIVER=dummy" );
+    }
+    m_Worker.reset( new Renderer( m_Headless ? Renderer::BACKEND_HEADLESS : Renderer::BACKEND_WINDOW ) );
+
     int err = SDL_Init(SDL_INIT_VIDEO|SDL_INIT_JOYSTICK);
     ASSERT( err != -1, "Failed to initialize SDL video system! SDL Error: %s\n", SDL_GetError());
 
@@ -75,56 +187,134 @@ void App::Init(int argc, char* argv[])
 
 }
 
+void App::OnEntityInitialized( const EntityPtr& entity, bool initialized )
+{
+    if ( initialized ) {
+        ++m_NumInitialized;
+    } else {
+        ++m_NumFailed;
+    }
+}
+
 int App::Run()
 {
     int r(0);
 
+    if ( m_Benchmark ) {
+        if ( !RunBenchmark( m_Benchmark, stdout ) ) {
+            ListBenchmarks( stderr );
+            r = -1;
+        }
+        return r;
+    }
+
     // somebody must attach a worker
     BOOST_ASSERT( m_Worker);
 
     int width(960);
     int height(544);
-    SDL_Surface *screen;
-    screen = SDL_SetVideoMode(width, height, 32, SDL_OPENGL);
-    if (screen == NULL)
-    {
-        THROW("Unable to set %dx%d video! SDL Error: %s\n", width, height, SDL_GetError());
+    if ( !m_Headless ) {
+        SDL_Surface *screen;
+        screen = SDL_SetVideoMode(width, height, 32, SDL_OPENGL);
+        if (screen == NULL)
+        {
+            THROW("Unable to set %dx%d video! SDL Error: %s\n", width, height, SDL_GetError());
+        }
     }
 
     Renderer* renderer = dynamic_cast<Renderer*>(m_Worker.get());
     BOOST_ASSERT(renderer);
-    renderer->Init();
+    renderer->Init( width, height );
+    if ( m_InitBudget > 0 ) {
+        renderer->SetInitBudget( m_InitBudget );
+    }
+    if ( m_TargetFrameTime > 0 ) {
+        renderer->SetTargetFrameTime( m_TargetFrameTime );
+    }
+    renderer->SetInstancing( m_Instancing );
+    renderer->SetIndirect( m_Indirect );
+    renderer->SetCulling( m_Culling );
+    renderer->SetSpatialIndex( m_SpatialIndex );
+    renderer->SetDetailLevels( m_DetailLevels );
+    if ( m_ArenaPageSize >= 0 ) {
+        renderer->SetArenaPageSize( m_ArenaPageSize * 1024 );
+    }
+    if ( m_FrameLimit > 0 ) {
+        renderer->SetFrameLimit( m_FrameLimit );
+        renderer->GetProfiler().Enable( true, m_FrameLimit );
+    }
 
     ////////////////////////////////////////////////////////////////////////////
-    // Compose our scene
+    // Compose our scene. Entities are prepared on the thread pool and show up as soon as they are uploaded
     int order(0);
+    Renderer::InitCallback initialized = boost::bind( &App::OnEntityInitialized, this, _1, _2 );
 
     // Add a cube
     EntityPtr viewport(new Viewport(width, height));
     // this entity renders
-    renderer->AddEntity(viewport, order++);
+    renderer->AddEntity(viewport, order++, initialized);
 
     // Add the camera
-    EntityPtr camera(new Camera(m_Joystick));
+    boost::shared_ptr<Camera> camera(new Camera(m_Joystick));
+    if ( m_SpatialIndex ) {
+        // left click reports the entity under the cursor
+        camera->SetPickHandler( [renderer]( int x, int y ) {
+            renderer->Pick( x, y, []( const EntityPtr& entity, float distance ) {
+                if ( entity ) {
+                    printf( "Picked entity %p at distance %.2f\n", (void*) entity.get(), distance );
+                } else {
+                    printf( "Picked nothing\n" );
+                }
+            } );
+        } );
+    }
     // this entity handles events
     m_EventHandlerList.push_back(camera);
     // this entity renders
-    renderer->AddEntity(camera, order++);
+    renderer->AddEntity(camera, order++, initialized);
+
+    // Scene geometry shares one priority - the renderer orders it by GL state, buffer and depth
+    // Add cubes
+    for ( int i = 0; i < m_NumCubes; ++i ) {
+        EntityPtr cube(new Cube);
+        // this entity renders
+        renderer->AddEntity(cube, order, initialized);
+    }
 
-    // Add a cube
-    EntityPtr cube(new Cube);
-    // this entity renders
-    renderer->AddEntity(cube, order++);
+    MeshBuilder::Topology topology = m_Strips ? MeshBuilder::TRIANGLE_STRIP : MeshBuilder::TRIANGLES;
+    // --lod: 8 up to 256 columns, spheres 8x4 up to 256x128
+    const int levels  = m_DetailLevels ? 6 : 1;
+    const int columns = m_DetailLevels ? 256 : Sphere::DEFAULT_COLUMNS;
+    const int rows    = m_DetailLevels ? 128 : Sphere::DEFAULT_ROWS;
+
+    // Add cylinders
+    EntityList cylinders;
+    for ( int i = 0; i < m_NumCylinders; ++i ) {
+        EntityPtr cylinder(new Cylinder( topology, m_DetailLevels ? columns : Cylinder::DEFAULT_COLUMNS, levels ));
+        // this entity renders
+        renderer->AddEntity(cylinder, order, initialized);
+        cylinders.push_back(cylinder);
+    }
 
-    // Add a cylinder
-    EntityPtr cylinder(new Cylinder);
-    // this entity renders
-    renderer->AddEntity(cylinder, order++);
+    // Add spheres
+    EntityList spheres;
+    for ( int i = 0; i < m_NumSpheres; ++i ) {
+        EntityPtr sphere(new Sphere( 1.0f, columns, rows, topology, levels ));
+        // this entity renders
+        renderer->AddEntity(sphere, order, initialized);
+        spheres.push_back(sphere);
+    }
 
-    // Add a sphere
-    EntityPtr sphere(new Sphere);
-    // this entity renders
-    renderer->AddEntity(sphere, order++);
+    // Cylinders move along with the spheres, round robin
+    if ( m_Attach && !spheres.empty() ) {
+        auto parent = spheres.begin();
+        for ( auto& cylinder : cylinders ) {
+            renderer->SetParent( cylinder, *parent );
+            if ( ++parent == spheres.end() ) {
+                parent = spheres.begin();
+            }
+        }
+    }
 
     // Run our worker thread
     boost::thread worker(boost::bind(&Worker::Run, m_Worker));
@@ -183,6 +373,22 @@ int App::Run()
     m_Worker->Terminate();
     worker.join();
 
+    if ( renderer->GetProfiler().IsEnabled() ) {
+        printf( "Scene: %d cubes, %d cylinders, %d spheres (%d entities initialized, %d failed)\n",
+                m_NumCubes, m_NumCylinders, m_NumSpheres, int(m_NumInitialized), int(m_NumFailed) );
+        renderer->GetProfiler().Report( stdout );
+        renderer->GetUploads().Report( stdout );
+        renderer->GetStaging().Report( stdout );
+        renderer->GetArena().Report( stdout );
+        renderer->GetState().Report( stdout );
+        renderer->GetInstancer().Report( stdout );
+        renderer->GetScene().Report( stdout );
+        renderer->GetCuller().Report( stdout );
+        renderer->GetSpatialIndex().Report( stdout );
+        renderer->GetLodSelector().Report( stdout );
+        MeshCache::GetDefault().Report( stdout );
+    }
+
     return r;
 }
 
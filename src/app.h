@@ -13,12 +13,36 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <atomic>
+
 class App
 {
 	boost::shared_ptr< Worker > m_Worker;
 
     SDL_Joystick   *m_Joystick;
     EntityList      m_EventHandlerList;
+
+    bool            m_Headless;
+    int             m_FrameLimit;   // > 0 runs a profiled benchmark of that many frames
+    int             m_NumCubes;
+    int             m_NumCylinders;
+    int             m_NumSpheres;
+    const char     *m_Benchmark;    // CPU micro benchmark to run instead of the scene
+    bool            m_Strips;       // spheres and cylinders use triangle strips
+    bool            m_Instancing;   // spheres and cylinders of the same shape share one draw call
+    bool            m_Indirect;     // instanced shapes go out with multi-draw indirect
+    bool            m_Attach;       // cylinders are children of the spheres
+    bool            m_Culling;      // entities outside the view frustum are skipped
+    bool            m_SpatialIndex; // culling and picking go through a BVH
+    bool            m_DetailLevels; // spheres and cylinders pick their tessellation from their size on screen
+    int             m_ArenaPageSize;    // KB. -1 keeps the renderer's default, 0 gives every mesh its own buffers
+    int             m_InitBudget;   // microseconds per frame for entity uploads. 0 keeps the renderer default
+    int             m_TargetFrameTime;  // microseconds. Entity uploads get what's left of it. 0 uses the full budget
+
+    std::atomic< int > m_NumInitialized;    // written by the render thread
+    std::atomic< int > m_NumFailed;
+
+    void OnEntityInitialized( const EntityPtr& entity, bool initialized );
 public:
 	App();
 
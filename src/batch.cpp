@@ -0,0 +1,276 @@
+/*
+ * batch.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "batch.h"
+
+// NEON only has vector sqrt/div on AArch64. 32bit ARM takes the scalar path
+#if defined(SIMD_NEON) && defined(__aarch64__)
+#define BATCH_NEON 1
+#endif
+
+namespace batch
+{
+
+// Vector is exactly 4 tightly packed floats - treat the array as one float stream
+static inline float* floats( Vector* v ) { return (float*)v; }
+
+static inline const float* floats( const Vector* v ) { return (const float*)v; }
+
+#if defined(SIMD_AVX)
+// two Vectors that are 4 Vectors apart in one register
+static inline __m256 load2( const float* lo, const float* hi )
+{
+    return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( lo ) ), _mm_loadu_ps( hi ), 1 );
+}
+
+static inline void store2( float* lo, float* hi, __m256 v )
+{
+    _mm_storeu_ps( lo, _mm256_castps256_ps128( v ) );
+    _mm_storeu_ps( hi, _mm256_extractf128_ps( v, 1 ) );
+}
+#endif
+
+void Normalize( Vector* v, std::size_t count )
+{
+    Normalize( v, v, count );
+}
+
+void Normalize( Vector* out, const Vector* in, std::size_t count )
+{
+    std::size_t i(0);
+    const float* f = floats( in );
+    float* dst = floats( out );
+#if defined(SIMD_AVX)
+    const __m256 one  = _mm256_set1_ps( 1.0f );
+    const __m256 zero = _mm256_setzero_ps();
+    for ( ; i + 8 <= count; i += 8, f += 32, dst += 32 ) {
+        // r0 = {v0,v4}, r1 = {v1,v5}, ... - transpose within each 128 bit lane
+        __m256 r0 = load2( f +  0, f + 16 );
+        __m256 r1 = load2( f +  4, f + 20 );
+        __m256 r2 = load2( f +  8, f + 24 );
+        __m256 r3 = load2( f + 12, f + 28 );
+        __m256 t0 = _mm256_unpacklo_ps( r0, r1 );
+        __m256 t1 = _mm256_unpacklo_ps( r2, r3 );
+        __m256 t2 = _mm256_unpackhi_ps( r0, r1 );
+        __m256 t3 = _mm256_unpackhi_ps( r2, r3 );
+        __m256 x  = _mm256_shuffle_ps( t0, t1, 0x44 );
+        __m256 y  = _mm256_shuffle_ps( t0, t1, 0xEE );
+        __m256 z  = _mm256_shuffle_ps( t2, t3, 0x44 );
+
+        __m256 length = _mm256_sqrt_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, x ), _mm256_mul_ps( y, y ) ), _mm256_mul_ps( z, z ) ) );
+        // zero length vectors stay untouched
+        __m256 scale  = _mm256_blendv_ps( one, _mm256_div_ps( one, length ), _mm256_cmp_ps( length, zero, _CMP_GT_OQ ) );
+
+        r0 = _mm256_mul_ps( r0, _mm256_permute_ps( scale, 0x00 ) );
+        r1 = _mm256_mul_ps( r1, _mm256_permute_ps( scale, 0x55 ) );
+        r2 = _mm256_mul_ps( r2, _mm256_permute_ps( scale, 0xAA ) );
+        r3 = _mm256_mul_ps( r3, _mm256_permute_ps( scale, 0xFF ) );
+        store2( dst +  0, dst + 16, r0 );
+        store2( dst +  4, dst + 20, r1 );
+        store2( dst +  8, dst + 24, r2 );
+        store2( dst + 12, dst + 28, r3 );
+    }
+#elif defined(SIMD_SSE)
+    const __m128 one  = _mm_set1_ps( 1.0f );
+    const __m128 zero = _mm_setzero_ps();
+    for ( ; i + 4 <= count; i += 4, f += 16, dst += 16 ) {
+        __m128 r0 = _mm_loadu_ps( f +  0 );
+        __m128 r1 = _mm_loadu_ps( f +  4 );
+        __m128 r2 = _mm_loadu_ps( f +  8 );
+        __m128 r3 = _mm_loadu_ps( f + 12 );
+        __m128 x = r0, y = r1, z = r2, w = r3;
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+
+        __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+        // zero length vectors stay untouched
+        __m128 mask   = _mm_cmpgt_ps( length, zero );
+        __m128 scale  = _mm_or_ps( _mm_and_ps( mask, _mm_div_ps( one, length ) ), _mm_andnot_ps( mask, one ) );
+
+        _mm_storeu_ps( dst +  0, _mm_mul_ps( r0, _mm_shuffle_ps( scale, scale, 0x00 ) ) );
+        _mm_storeu_ps( dst +  4, _mm_mul_ps( r1, _mm_shuffle_ps( scale, scale, 0x55 ) ) );
+        _mm_storeu_ps( dst +  8, _mm_mul_ps( r2, _mm_shuffle_ps( scale, scale, 0xAA ) ) );
+        _mm_storeu_ps( dst + 12, _mm_mul_ps( r3, _mm_shuffle_ps( scale, scale, 0xFF ) ) );
+    }
+#elif defined(BATCH_NEON)
+    const float32x4_t one  = vdupq_n_f32( 1.0f );
+    const float32x4_t zero = vdupq_n_f32( 0.0f );
+    for ( ; i + 4 <= count; i += 4, f += 16, dst += 16 ) {
+        // de-interleaving load: val[0] = x0..x3, val[1] = y0..y3, ...
+        float32x4x4_t r = vld4q_f32( f );
+        float32x4_t length = vsqrtq_f32( vaddq_f32( vaddq_f32( vmulq_f32( r.val[0], r.val[0] ), vmulq_f32( r.val[1], r.val[1] ) ), vmulq_f32( r.val[2], r.val[2] ) ) );
+        float32x4_t scale  = vbslq_f32( vcgtq_f32( length, zero ), vdivq_f32( one, length ), one );
+        r.val[0] = vmulq_f32( r.val[0], scale );
+        r.val[1] = vmulq_f32( r.val[1], scale );
+        r.val[2] = vmulq_f32( r.val[2], scale );
+        r.val[3] = vmulq_f32( r.val[3], scale );
+        vst4q_f32( dst, r );
+    }
+#endif
+    for ( ; i < count; ++i ) {
+        out[i] = in[i].Normalized();
+    }
+}
+
+void Add( Vector* v, std::size_t count, const Vector& a )
+{
+    std::size_t i(0);
+#if defined(SIMD_AVX)
+    float* f = floats( v );
+    const __m256 a2 = _mm256_broadcast_ps( (const __m128*)(const float*)a );
+    for ( ; i + 2 <= count; i += 2, f += 8 ) {
+        _mm256_storeu_ps( f, _mm256_add_ps( _mm256_loadu_ps( f ), a2 ) );
+    }
+#elif defined(SIMD_ENABLED)
+    float* f = floats( v );
+    // keep a in a register - it might alias v as far as the compiler knows
+    const simd::float4 a1 = simd::load( a );
+    for ( ; i < count; ++i, f += 4 ) {
+        simd::store( f, simd::add( simd::load( f ), a1 ) );
+    }
+#endif
+    for ( ; i < count; ++i ) {
+        v[i] += a;
+    }
+}
+
+void Mul( Vector* v, std::size_t count, const Vector& m )
+{
+    std::size_t i(0);
+#if defined(SIMD_AVX)
+    float* f = floats( v );
+    const __m256 m2 = _mm256_broadcast_ps( (const __m128*)(const float*)m );
+    for ( ; i + 2 <= count; i += 2, f += 8 ) {
+        _mm256_storeu_ps( f, _mm256_mul_ps( _mm256_loadu_ps( f ), m2 ) );
+    }
+#elif defined(SIMD_ENABLED)
+    float* f = floats( v );
+    // keep m in a register - it might alias v as far as the compiler knows
+    const simd::float4 m1 = simd::load( m );
+    for ( ; i < count; ++i, f += 4 ) {
+        simd::store( f, simd::mul( simd::load( f ), m1 ) );
+    }
+#endif
+    for ( ; i < count; ++i ) {
+        v[i] *= m;
+    }
+}
+
+void Mul( Vector* v, std::size_t count, float s )
+{
+    Mul( v, count, Vector( s, s, s, s ) );
+}
+
+void Transform( Vector* out, const Vector* in, std::size_t count, const float matrix[16] )
+{
+    std::size_t i(0);
+    const float* src = floats( in );
+    float* dst = floats( out );
+#if defined(SIMD_AVX)
+    const __m256 c0 = _mm256_broadcast_ps( (const __m128*)( matrix +  0 ) );
+    const __m256 c1 = _mm256_broadcast_ps( (const __m128*)( matrix +  4 ) );
+    const __m256 c2 = _mm256_broadcast_ps( (const __m128*)( matrix +  8 ) );
+    const __m256 c3 = _mm256_broadcast_ps( (const __m128*)( matrix + 12 ) );
+    for ( ; i + 2 <= count; i += 2, src += 8, dst += 8 ) {
+        __m256 v = _mm256_loadu_ps( src );
+        __m256 r = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps(
+                        _mm256_mul_ps( c0, _mm256_permute_ps( v, 0x00 ) ),
+                        _mm256_mul_ps( c1, _mm256_permute_ps( v, 0x55 ) ) ),
+                        _mm256_mul_ps( c2, _mm256_permute_ps( v, 0xAA ) ) ),
+                        _mm256_mul_ps( c3, _mm256_permute_ps( v, 0xFF ) ) );
+        _mm256_storeu_ps( dst, r );
+    }
+#elif defined(SIMD_ENABLED)
+    const simd::float4 c0 = simd::load( matrix +  0 );
+    const simd::float4 c1 = simd::load( matrix +  4 );
+    const simd::float4 c2 = simd::load( matrix +  8 );
+    const simd::float4 c3 = simd::load( matrix + 12 );
+    for ( ; i < count; ++i, src += 4, dst += 4 ) {
+        simd::float4 r = simd::add( simd::add( simd::add(
+                        simd::mul( c0, simd::splat( src[0] ) ),
+                        simd::mul( c1, simd::splat( src[1] ) ) ),
+                        simd::mul( c2, simd::splat( src[2] ) ) ),
+                        simd::mul( c3, simd::splat( src[3] ) ) );
+        simd::store( dst, r );
+    }
+#endif
+    for ( ; i < count; ++i, src += 4, dst += 4 ) {
+        float x = src[0], y = src[1], z = src[2], w = src[3];
+        for ( int row = 0; row < 4; ++row ) {
+            dst[row] = ((matrix[row]*x + matrix[4+row]*y) + matrix[8+row]*z) + matrix[12+row]*w;
+        }
+    }
+}
+
+void ToSoA( VectorSoA& out, const Vector* in, std::size_t count )
+{
+    out.resize( count );
+    std::size_t i(0);
+    const float* f = floats( in );
+#if defined(SIMD_SSE)
+    for ( ; i + 4 <= count; i += 4, f += 16 ) {
+        __m128 x = _mm_loadu_ps( f +  0 );
+        __m128 y = _mm_loadu_ps( f +  4 );
+        __m128 z = _mm_loadu_ps( f +  8 );
+        __m128 w = _mm_loadu_ps( f + 12 );
+        _MM_TRANSPOSE4_PS( x, y, z, w );
+        _mm_storeu_ps( &out.x[i], x );
+        _mm_storeu_ps( &out.y[i], y );
+        _mm_storeu_ps( &out.z[i], z );
+        _mm_storeu_ps( &out.w[i], w );
+    }
+#elif defined(SIMD_NEON)
+    for ( ; i + 4 <= count; i += 4, f += 16 ) {
+        float32x4x4_t r = vld4q_f32( f );
+        vst1q_f32( &out.x[i], r.val[0] );
+        vst1q_f32( &out.y[i], r.val[1] );
+        vst1q_f32( &out.z[i], r.val[2] );
+        vst1q_f32( &out.w[i], r.val[3] );
+    }
+#endif
+    for ( ; i < count; ++i, f += 4 ) {
+        out.x[i] = f[0];
+        out.y[i] = f[1];
+        out.z[i] = f[2];
+        out.w[i] = f[3];
+    }
+}
+
+void ToAoS( Vector* out, const VectorSoA& in )
+{
+    std::size_t count = in.size();
+    std::size_t i(0);
+    float* f = floats( out );
+#if defined(SIMD_SSE)
+    for ( ; i + 4 <= count; i += 4, f += 16 ) {
+        __m128 r0 = _mm_loadu_ps( &in.x[i] );
+        __m128 r1 = _mm_loadu_ps( &in.y[i] );
+        __m128 r2 = _mm_loadu_ps( &in.z[i] );
+        __m128 r3 = _mm_loadu_ps( &in.w[i] );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        _mm_storeu_ps( f +  0, r0 );
+        _mm_storeu_ps( f +  4, r1 );
+        _mm_storeu_ps( f +  8, r2 );
+        _mm_storeu_ps( f + 12, r3 );
+    }
+#elif defined(SIMD_NEON)
+    for ( ; i + 4 <= count; i += 4, f += 16 ) {
+        float32x4x4_t r;
+        r.val[0] = vld1q_f32( &in.x[i] );
+        r.val[1] = vld1q_f32( &in.y[i] );
+        r.val[2] = vld1q_f32( &in.z[i] );
+        r.val[3] = vld1q_f32( &in.w[i] );
+        vst4q_f32( f, r );
+    }
+#endif
+    for ( ; i < count; ++i, f += 4 ) {
+        f[0] = in.x[i];
+        f[1] = in.y[i];
+        f[2] = in.z[i];
+        f[3] = in.w[i];
+    }
+}
+
+}
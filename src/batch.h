@@ -0,0 +1,66 @@
+/*
+ * batch.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "vector.h"
+
+#include <vector>
+
+// Bulk versions of the Vector operations over contiguous arrays. Processes 4 (SSE/NEON) or 8 (AVX) vectors per
+// iteration instead of one call + temporary per vector. Results are bit-identical to the per-Vector operations.
+namespace batch
+{
+    // Structure of arrays: x[i],y[i],z[i],w[i] belong to vector i
+    struct VectorSoA
+    {
+        std::vector< float > x, y, z, w;
+
+        std::size_t size() const { return x.size(); }
+
+        void resize( std::size_t count ) { x.resize( count ); y.resize( count ); z.resize( count ); w.resize( count ); }
+    };
+
+    // v[i].Normalize()
+    void Normalize( Vector* v, std::size_t count );
+
+    // out[i] = in[i].Normalized(). in and out may be the same array
+    void Normalize( Vector* out, const Vector* in, std::size_t count );
+
+    // v[i] += a
+    void Add( Vector* v, std::size_t count, const Vector& a );
+
+    // v[i] *= m
+    void Mul( Vector* v, std::size_t count, const Vector& m );
+
+    // v[i] *= s
+    void Mul( Vector* v, std::size_t count, float s );
+
+    // out[i] = matrix * in[i]. matrix is column major (OpenGL layout). in and out may be the same array
+    void Transform( Vector* out, const Vector* in, std::size_t count, const float matrix[16] );
+
+    void ToSoA( VectorSoA& out, const Vector* in, std::size_t count );
+
+    void ToAoS( Vector* out, const VectorSoA& in );
+
+    // std::vector convenience
+    inline void Normalize( std::vector< Vector >& v ) { if ( !v.empty() ) Normalize( &v[0], v.size() ); }
+
+    inline void Add( std::vector< Vector >& v, const Vector& a ) { if ( !v.empty() ) Add( &v[0], v.size(), a ); }
+
+    inline void Mul( std::vector< Vector >& v, const Vector& m ) { if ( !v.empty() ) Mul( &v[0], v.size(), m ); }
+
+    inline void Mul( std::vector< Vector >& v, float s ) { if ( !v.empty() ) Mul( &v[0], v.size(), s ); }
+
+    inline void Transform( std::vector< Vector >& v, const float matrix[16] ) { if ( !v.empty() ) Transform( &v[0], &v[0], v.size(), matrix ); }
+
+    inline void ToSoA( VectorSoA& out, const std::vector< Vector >& in ) { out.resize( in.size() ); if ( !in.empty() ) ToSoA( out, &in[0], in.size() ); }
+
+    inline void ToAoS( std::vector< Vector >& out, const VectorSoA& in ) { out.resize( in.size() ); if ( !out.empty() ) ToAoS( &out[0], in ); }
+}
+
+#endif /* BATCH_H_ */
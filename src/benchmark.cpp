@@ -0,0 +1,988 @@
+/*
+ * benchmark.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "benchmark.h"
+#include "vector.h"
+#include "matrix.h"
+#include "scenegraph.h"
+#include "frustum.h"
+#include "bvh.h"
+#include "lod.h"
+#include "batch.h"
+#include "meshoptimizer.h"
+#include "sphere.h"
+#include "threadpool.h"
+#include "commandqueue.h"
+#include "renderlist.h"
+#include "radixsort.h"
+#include "drawkey.h"
+
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double elapsedNs( Clock::time_point start )
+{
+    return std::chrono::duration< double, std::nano >( Clock::now() - start ).count();
+}
+
+static void reportResult( FILE* out, const char* test, std::size_t count, double referenceNs, double ns )
+{
+    fprintf( out, "%-12s %10.2f ns/op %10.2f ns/op %8.2fx\n", test, referenceNs/count, ns/count, referenceNs/ns );
+}
+
+// The scalar implementation Vector had before it went SIMD. Kept here as baseline
+namespace reference
+{
+    struct Vector { float vec[4]; };
+
+    static void normalize( Vector& v )
+    {
+        float length = std::sqrt( v.vec[0]*v.vec[0] + v.vec[1]*v.vec[1] + v.vec[2]*v.vec[2] );
+        if ( length > 0 ) {
+            float s = 1/length;
+            v.vec[0] *= s; v.vec[1] *= s; v.vec[2] *= s; v.vec[3] *= s;
+        }
+    }
+
+    static float dot( const Vector& a, const Vector& b )
+    {
+        return a.vec[0]*b.vec[0] + a.vec[1]*b.vec[1] + a.vec[2]*b.vec[2];
+    }
+
+    static void cross( Vector& a, const Vector& b )
+    {
+        float x = a.vec[1] * b.vec[2] - a.vec[2] * b.vec[1];
+        float y = a.vec[2] * b.vec[0] - a.vec[0] * b.vec[2];
+        float z = a.vec[0] * b.vec[1] - a.vec[1] * b.vec[0];
+        a.vec[0] = x; a.vec[1] = y; a.vec[2] = z; a.vec[3] = 0;
+    }
+
+    static void madd( Vector& a, const Vector& b, float s )
+    {
+        a.vec[0] += b.vec[0]*s; a.vec[1] += b.vec[1]*s; a.vec[2] += b.vec[2]*s; a.vec[3] += b.vec[3]*s;
+    }
+}
+
+static void benchmarkVector( FILE* out )
+{
+    // small enough to stay in L1/L2 - we want to measure the math, not the memory bus
+    const std::size_t count = 4096;
+    const int rounds = 2048;
+
+    std::vector< Vector > vectors( count );
+    std::vector< reference::Vector > refVectors( count );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        float f = float(i);
+        vectors[i] = Vector( std::sin( f ) * 10, std::cos( f ) * 5, f * 0.001f );
+        std::memcpy( refVectors[i].vec, (const float*)vectors[i], sizeof(float)*4 );
+    }
+    std::vector< Vector > work( vectors );
+    std::vector< reference::Vector > refWork( refVectors );
+
+#ifdef SIMD_ENABLED
+    fprintf( out, "Vector: SIMD enabled (%s)\n",
+#if defined(SIMD_SSE4)
+            "SSE4.1"
+#elif defined(SIMD_SSE)
+            "SSE2"
+#else
+            "NEON"
+#endif
+    );
+#else
+    fprintf( out, "Vector: SIMD disabled\n" );
+#endif
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "scalar", "Vector", "speedup" );
+
+    // keeps the optimizer from dropping the loops
+    float sink(0);
+    double refNs, ns;
+    Clock::time_point start;
+
+    // normalizing twice is a no-op, so we can keep running over the same data
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( auto& v : refWork ) reference::normalize( v ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( auto& v : work ) v.Normalize(); }
+    ns = elapsedNs( start );
+    reportResult( out, "normalize", count*rounds, refNs, ns );
+
+    work = vectors;
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( auto& v : work ) v.NormalizeFast(); }
+    ns = elapsedNs( start );
+    reportResult( out, "normalize~", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 1; i < count; ++i ) sink += reference::dot( refVectors[i-1], refVectors[i] ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 1; i < count; ++i ) sink += vectors[i-1].Dot( vectors[i] ); }
+    ns = elapsedNs( start );
+    reportResult( out, "dot", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = 1; i < count; ++i ) { refWork[i] = refVectors[i]; reference::cross( refWork[i], refVectors[i-1] ); }
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = 1; i < count; ++i ) { work[i] = vectors[i]; work[i].Cross( vectors[i-1] ); }
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "cross", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 1; i < count; ++i ) reference::madd( refWork[i], refVectors[i-1], 0.5f ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 1; i < count; ++i ) work[i] += vectors[i-1] * 0.5f; }
+    ns = elapsedNs( start );
+    reportResult( out, "add/mul", count*rounds, refNs, ns );
+
+    sink += work[ count/2 ][ Vector::X ] + refWork[ count/2 ].vec[0];
+    fprintf( out, "(checksum %f)\n", sink );
+}
+
+static void benchmarkBatch( FILE* out )
+{
+    // a 512x256 sphere worth of vertices
+    const std::size_t count = 512*256;
+    const int rounds = 32;
+
+    std::vector< Vector > vertices( count );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        float f = float(i);
+        vertices[i] = Vector( std::sin( f ) * 10, std::cos( f ) * 5, f * 0.001f );
+    }
+    std::vector< Vector > normals( count );
+    float matrix[16] = { 0,1,0,0,  -1,0,0,0,  0,0,1,0,  5,1,0,1 }; // rotate 90 deg around z + translate
+
+    fprintf( out, "Batch: %u vertices\n", (unsigned)count );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "per Vector", "batch", "speedup" );
+
+    double refNs, ns;
+    Clock::time_point start;
+
+    // what MakeSphere used to do: normal = vertex.Normalized()
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 0; i < count; ++i ) normals[i] = vertices[i].Normalized(); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { batch::Normalize( &normals[0], &vertices[0], count ); }
+    ns = elapsedNs( start );
+    reportResult( out, "normalize", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = 0; i < count; ++i ) {
+            const Vector& v = vertices[i];
+            normals[i] = Vector( matrix ) * v[ Vector::X ] + Vector( matrix + 4 ) * v[ Vector::Y ] + Vector( matrix + 8 ) * v[ Vector::Z ] + Vector( matrix + 12 ) * v[ Vector::W ];
+        }
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { batch::Transform( &normals[0], &vertices[0], count, matrix ); }
+    ns = elapsedNs( start );
+    reportResult( out, "transform", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( auto& v : normals ) v += Vector( 1, 2, 3, 0 ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { batch::Add( normals, Vector( 1, 2, 3, 0 ) ); }
+    ns = elapsedNs( start );
+    reportResult( out, "add", count*rounds, refNs, ns );
+
+    batch::VectorSoA soa;
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        soa.resize( count );
+        for ( std::size_t i = 0; i < count; ++i ) {
+            soa.x[i] = vertices[i][ Vector::X ]; soa.y[i] = vertices[i][ Vector::Y ]; soa.z[i] = vertices[i][ Vector::Z ]; soa.w[i] = vertices[i][ Vector::W ];
+        }
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { batch::ToSoA( soa, vertices ); }
+    ns = elapsedNs( start );
+    reportResult( out, "aos->soa", count*rounds, refNs, ns );
+
+    fprintf( out, "(checksum %f)\n", normals[ count/2 ][ Vector::X ] + soa.y[ count/3 ] );
+}
+
+// Scalar column major 4x4 product and the glTranslatef/glScalef/glRotatef sequence, as the baseline for Matrix4
+namespace reference
+{
+    static void multiply( float r[16], const float a[16], const float b[16] )
+    {
+        for ( int col = 0; col < 4; ++col ) {
+            for ( int row = 0; row < 4; ++row ) {
+                r[ col*4 + row ] = a[ row ] * b[ col*4 ] + a[ 4 + row ] * b[ col*4 + 1 ] + a[ 8 + row ] * b[ col*4 + 2 ] + a[ 12 + row ] * b[ col*4 + 3 ];
+            }
+        }
+    }
+
+    static void rotate( float m[16], float degrees, int axis )
+    {
+        float rad = degrees * 3.14159265f / 180.0f;
+        float s = std::sin( rad ), c = std::cos( rad );
+        float r[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        int i = ( axis + 1 ) % 3, j = ( axis + 2 ) % 3;
+        r[ i*4 + i ] = c; r[ i*4 + j ] = s; r[ j*4 + i ] = -s; r[ j*4 + j ] = c;
+        float t[16];
+        multiply( t, m, r );
+        std::memcpy( m, t, sizeof( t ) );
+    }
+
+    static void compose( float m[16], const ::Vector& position, const ::Vector& scale, const ::Vector& rotation )
+    {
+        // glTranslatef, glScalef
+        float t[16] = { scale[ ::Vector::X ],0,0,0, 0,scale[ ::Vector::Y ],0,0, 0,0,scale[ ::Vector::Z ],0,
+                        position[ ::Vector::X ], position[ ::Vector::Y ], position[ ::Vector::Z ], 1 };
+        std::memcpy( m, t, sizeof( t ) );
+        rotate( m, rotation[ ::Vector::X ], 0 );
+        rotate( m, rotation[ ::Vector::Y ], 1 );
+        rotate( m, rotation[ ::Vector::Z ], 2 );
+    }
+}
+
+static void benchmarkMatrix( FILE* out )
+{
+    // what the transform stage does per frame for this many entities
+    const std::size_t count = 10000;
+    const int rounds = 100;
+
+    std::vector< Vector > positions( count ), scales( count ), rotations( count );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        float f = float(i);
+        positions[i] = Vector( std::sin( f ) * 10, std::cos( f ) * 5, f * 0.001f );
+        scales[i]    = Vector( 1 + float( i % 3 ) * 0.5f, 1, 0.5f + float( i % 5 ) * 0.25f );   // non-uniform - order matters
+        rotations[i] = Vector( f, f * 0.5f, 0 );
+    }
+    std::vector< Matrix4 > world( count ), modelView( count );
+    std::vector< float > refWorld( count * 16 ), refModelView( count * 16 );
+    Matrix4 view = Matrix4::Rotation( Quaternion::FromEuler( Vector( 30, 45, 0 ) ) ) * Matrix4::Translation( Vector( 0, -1, -10 ) );
+
+    fprintf( out, "Matrix: %u entities\n", (unsigned)count );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "scalar", "Matrix4", "speedup" );
+
+    double refNs, ns;
+    Clock::time_point start;
+
+    // glTranslatef + glScalef + 3x glRotatef on the CPU against the quaternion composition
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 0; i < count; ++i ) reference::compose( &refWorld[ i*16 ], positions[i], scales[i], rotations[i] ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = 0; i < count; ++i ) world[i] = Matrix4::Compose( positions[i], Quaternion::FromEuler( rotations[i] ), scales[i] );
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "compose", count*rounds, refNs, ns );
+
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 0; i < count; ++i ) reference::multiply( &refModelView[ i*16 ], view, &refWorld[ i*16 ] ); }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 0; i < count; ++i ) Matrix4::Multiply( view, world[i], modelView[i] ); }
+    ns = elapsedNs( start );
+    reportResult( out, "view*world", count*rounds, refNs, ns );
+
+    // both paths must agree
+    float error(0);
+    for ( std::size_t i = 0; i < count; ++i ) {
+        for ( int k = 0; k < 16; ++k ) {
+            error = std::max( error, std::fabs( refModelView[ i*16 + k ] - ((const float*)modelView[i])[k] ) );
+        }
+    }
+    fprintf( out, "(max difference %g)\n", error );
+}
+
+static void benchmarkSceneGraph( FILE* out )
+{
+    // roots with 9 children of 10 children each: 100 nodes per subtree
+    const int roots = 1000;
+    const int rounds = 50;
+
+    SceneGraph scene;
+    std::vector< SceneGraph::NodeId > rootNodes;
+    Clock::time_point start = Clock::now();
+    for ( int r = 0; r < roots; ++r ) {
+        SceneGraph::NodeId root = scene.Add();
+        rootNodes.push_back( root );
+        for ( int c = 0; c < 9; ++c ) {
+            SceneGraph::NodeId child = scene.Add( root );
+            scene.SetLocal( child, Matrix4::Translation( Vector( float(c), 0, 0 ) ) );
+            for ( int g = 0; g < 10; ++g ) {
+                SceneGraph::NodeId grandChild = scene.Add( child );
+                scene.SetLocal( grandChild, Matrix4::Compose( Vector( 0, float(g), 0 ), Quaternion::FromEuler( Vector( float(g) * 10, 0, 0 ) ), Vector( 1, 1, 1 ) ) );
+            }
+        }
+    }
+    double buildNs = elapsedNs( start );
+    const std::size_t nodes = scene.GetSize();
+    scene.Update();
+
+    Matrix4 moved[2] = { Matrix4::Translation( Vector( 1, 0, 0 ) ), Matrix4::Translation( Vector( 2, 0, 0 ) ) };
+    fprintf( out, "Scene graph: %u nodes in %d subtrees, built in %.2f ms, %u pool threads\n", unsigned( nodes ), roots,
+            buildNs / 1e6, ThreadPool::GetDefault().GetSize() );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "baseline", "SceneGraph", "speedup" );
+
+    double refNs, ns;
+
+    // every root moves: the whole graph is updated, serial against parallel across subtrees
+    scene.SetParallelThreshold( 0 );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( auto root : rootNodes ) scene.SetLocal( root, moved[ r & 1 ] );
+        scene.Update();
+    }
+    refNs = elapsedNs( start );
+    scene.SetParallelThreshold( 1 );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( auto root : rootNodes ) scene.SetLocal( root, moved[ r & 1 ] );
+        scene.Update();
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "parallel", nodes*rounds, refNs, ns );
+
+    // 1% of the roots move: only their subtrees are updated. Against updating everything (serial)
+    scene.SetParallelThreshold( 0 );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( int i = r % 100; i < roots; i += 100 ) scene.SetLocal( rootNodes[i], moved[ r & 1 ] );
+        scene.Update();
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "dirty 1%", nodes*rounds, refNs, ns );
+
+    fprintf( out, "(checksum %f)\n", scene.GetWorld( rootNodes[ roots/2 ] )( 0, 3 ) );
+}
+
+static void benchmarkCull( FILE* out )
+{
+    // spheres scattered around the camera - about a sixth of them in view
+    const std::size_t count = 100000;
+    const int rounds = 100;
+
+    std::vector< Vector > centers( count );
+    std::vector< float > x( count ), y( count ), z( count ), radius( count );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        float f = float(i);
+        centers[i] = Vector( std::sin( f ) * 100, std::cos( f * 0.7f ) * 100, std::sin( f * 1.3f ) * 100 );
+        x[i] = centers[i][ Vector::X ];
+        y[i] = centers[i][ Vector::Y ];
+        z[i] = centers[i][ Vector::Z ];
+        radius[i] = 1 + float( i % 5 );
+    }
+    Matrix4 view = Matrix4::Rotation( Quaternion::FromEuler( Vector( 10, 30, 0 ) ) ) * Matrix4::Translation( Vector( 0, -1, -10 ) );
+    Frustum frustum;
+    frustum.Extract( Matrix4::Perspective( 60, 4.0f/3.0f, 1, 1000 ) * view );
+    std::vector< char > refVisible( count ), visible( count );
+
+    fprintf( out, "Frustum culling: %u spheres\n", (unsigned)count );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "scalar", "SoA", "speedup" );
+
+    Clock::time_point start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) { for ( std::size_t i = 0; i < count; ++i ) refVisible[i] = frustum.Intersects( centers[i], radius[i] ); }
+    double refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) frustum.Intersects( &x[0], &y[0], &z[0], &radius[0], count, &visible[0] );
+    double ns = elapsedNs( start );
+    reportResult( out, "sphere test", count*rounds, refNs, ns );
+
+    // both paths must agree
+    std::size_t inside(0), mismatches(0);
+    for ( std::size_t i = 0; i < count; ++i ) {
+        inside += visible[i];
+        mismatches += visible[i] != refVisible[i];
+    }
+    fprintf( out, "(%u visible, %u mismatches)\n", unsigned( inside ), unsigned( mismatches ) );
+}
+
+static void benchmarkBvh( FILE* out )
+{
+    // a static scene: unit sized entities scattered over a 1000^3 volume
+    const std::size_t count = 200000;
+    const int rounds = 5;
+    const int queries = 200;
+
+    std::vector< Box > boxes( count );
+    unsigned seed = 12345;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return float( seed >> 8 ) / float( 1 << 24 );
+    };
+    for ( auto& box : boxes ) {
+        Vector center( random() * 1000 - 500, random() * 1000 - 500, random() * 1000 - 500 );
+        float size = 0.5f + random() * 2;
+        box = Box( center - size, center + size );
+    }
+
+    Bvh bvh;
+    fprintf( out, "BVH: %u boxes, %u pool threads\n", unsigned( count ), ThreadPool::GetDefault().GetSize() );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "baseline", "BVH", "speedup" );
+
+    double refNs, ns;
+    Clock::time_point start;
+
+    // serial against parallel SAH build
+    bvh.SetParallelThreshold( 0 );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) bvh.Build( boxes );
+    refNs = elapsedNs( start );
+    bvh.SetParallelThreshold( 1 );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) bvh.Build( boxes );
+    ns = elapsedNs( start );
+    reportResult( out, "build", count*rounds, refNs, ns );
+
+    // 1% of the entities move: refit against a rebuild
+    std::vector< Box > moved( boxes );
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = r; i < count; i += 100 ) { moved[i].min[0] += 1; moved[i].max[0] += 1; }
+        bvh.Build( moved );
+    }
+    refNs = elapsedNs( start );
+    bvh.Build( boxes );
+    moved = boxes;
+    start = Clock::now();
+    for ( int r = 0; r < rounds; ++r ) {
+        for ( std::size_t i = r; i < count; i += 100 ) { moved[i].min[0] += 1; moved[i].max[0] += 1; bvh.SetBounds( i, moved[i] ); }
+        bvh.Refit();
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "refit 1%", count*rounds, refNs, ns );
+    bvh.Build( boxes );
+
+    // every box against the query, against the tree. Both must find the same
+    std::vector< Bvh::ItemId > found;
+    std::size_t refFound(0), treeFound(0);
+    std::vector< Frustum > frustums( queries );
+    for ( int q = 0; q < queries; ++q ) {
+        Matrix4 view = Matrix4::Rotation( Quaternion::FromEuler( Vector( random() * 360, random() * 360, 0 ) ) ) *
+                Matrix4::Translation( Vector( random() * 200 - 100, random() * 200 - 100, random() * 200 - 100 ) );
+        frustums[q].Extract( Matrix4::Perspective( 60, 16.0f/9.0f, 1, 100 ) * view );
+    }
+    start = Clock::now();
+    for ( auto& frustum : frustums ) {
+        for ( auto& box : boxes ) refFound += frustum.Classify( box ) != Frustum::OUTSIDE;
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( auto& frustum : frustums ) {
+        found.clear();
+        bvh.Query( frustum, found );
+        treeFound += found.size();
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "frustum", queries, refNs, ns );
+    std::size_t mismatches = refFound != treeFound;
+
+    std::vector< Vector > centers( queries );
+    for ( auto& center : centers ) center = Vector( random() * 1000 - 500, random() * 1000 - 500, random() * 1000 - 500 );
+    refFound = treeFound = 0;
+    start = Clock::now();
+    for ( auto& center : centers ) {
+        for ( auto& box : boxes ) refFound += box.GetDistanceSq( center ) <= 50*50;
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( auto& center : centers ) {
+        found.clear();
+        bvh.Query( center, 50, found );
+        treeFound += found.size();
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "radius 50", queries, refNs, ns );
+    mismatches += refFound != treeFound;
+
+    // rays from the centers towards the origin: nearest hit
+    std::vector< Bvh::ItemId > refHits( queries ), hits( queries );
+    start = Clock::now();
+    for ( int q = 0; q < queries; ++q ) {
+        Vector direction = ( Vector( 0, 0, 0 ) - centers[q] ).Normalize();
+        float o[3] = { centers[q][ Vector::X ], centers[q][ Vector::Y ], centers[q][ Vector::Z ] };
+        float best = 2000;
+        refHits[q] = Bvh::INVALID_ITEM;
+        for ( std::size_t i = 0; i < count; ++i ) {
+            float enter(0), leave( best );
+            for ( int axis = 0; axis < 3; ++axis ) {
+                float inverse = 1 / direction[ Vector::Coord( axis ) ];
+                float t0 = ( boxes[i].min[ axis ] - o[ axis ] ) * inverse, t1 = ( boxes[i].max[ axis ] - o[ axis ] ) * inverse;
+                enter = std::max( enter, std::min( t0, t1 ) );
+                leave = std::min( leave, std::max( t0, t1 ) );
+            }
+            if ( enter <= leave && enter < best ) {
+                best = enter;
+                refHits[q] = i;
+            }
+        }
+    }
+    refNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int q = 0; q < queries; ++q ) {
+        float distance;
+        hits[q] = bvh.Raycast( centers[q], ( Vector( 0, 0, 0 ) - centers[q] ).Normalize(), 2000, distance );
+    }
+    ns = elapsedNs( start );
+    reportResult( out, "raycast", queries, refNs, ns );
+    for ( int q = 0; q < queries; ++q ) {
+        mismatches += hits[q] != refHits[q];
+    }
+    fprintf( out, "(%u nodes, %u mismatches)\n", unsigned( bvh.GetNodeCount() ), unsigned( mismatches ) );
+}
+
+static void benchmarkLod( FILE* out )
+{
+    // spheres in front of the camera from 3 to 600 units away, 960x544 at 60 degrees like the viewport
+    const std::size_t count = 10000;
+    const int levels = 6;
+    const int frames = 100;
+    const int height = 544;
+    Matrix4 projection = Matrix4::Perspective( 60, 960.0f/544.0f, 1, 1000 );
+    Matrix4 view;
+
+    std::vector< std::size_t > triangles( levels );
+    std::vector< LodChain > chains( count );
+    for ( int level = 0; level < levels; ++level ) {
+        int columns = 256 >> ( levels - 1 - level );
+        MeshBuilder geometry;
+        Sphere::MakeGeometry( geometry, 1.0f, columns, columns / 2 );
+        triangles[ level ] = geometry.GetIndices().size() / 3;
+        for ( auto& chain : chains ) {
+            chain.AddLevel( level, columns );
+        }
+    }
+    MeshBuilder fixed;
+    Sphere::MakeGeometry( fixed, 1.0f, Sphere::DEFAULT_COLUMNS, Sphere::DEFAULT_ROWS );
+    std::vector< Vector > centers( count );
+    for ( std::size_t i = 0; i < count; ++i ) {
+        float f = float(i);
+        float distance = 3 * std::pow( 200.0f, f / count );
+        centers[i] = Vector( std::sin( f ) * distance * 0.3f, std::cos( f * 0.7f ) * distance * 0.2f, -distance );
+    }
+
+    LodSelector selector;
+    Clock::time_point start = Clock::now();
+    for ( int frame = 0; frame < frames; ++frame ) {
+        selector.Begin( projection, view, height );
+        for ( std::size_t i = 0; i < count; ++i ) {
+            selector.Selected( chains[i].Select( selector.GetScreenRadius( centers[i], 1.0f ) ) );
+        }
+        selector.End();
+    }
+    double ns = elapsedNs( start );
+
+    std::vector< std::size_t > histogram( levels );
+    std::size_t selected(0);
+    for ( auto& chain : chains ) {
+        ++histogram[ chain.GetLevel() ];
+        selected += triangles[ chain.GetLevel() ];
+    }
+    fprintf( out, "Detail levels: %u spheres 3-600 units away, 8x4 up to 256x128\n", (unsigned)count );
+    fprintf( out, "selection %.2f ns per entity\n", ns / ( count * frames ) );
+    for ( int level = 0; level < levels; ++level ) {
+        int columns = 256 >> ( levels - 1 - level );
+        fprintf( out, "  %3dx%-3d %6u tris, up to %7.1f px: %u spheres\n", columns, columns / 2, (unsigned)triangles[ level ],
+                LodChain::GetMaxRadius( columns ), (unsigned)histogram[ level ] );
+    }
+    fprintf( out, "triangles per frame: %u at 256x128, %u at %dx%d, %u with detail levels\n",
+            unsigned( triangles[ levels - 1 ] * count ), unsigned( fixed.GetIndices().size() / 3 * count ),
+            Sphere::DEFAULT_COLUMNS, Sphere::DEFAULT_ROWS, unsigned( selected ) );
+
+    // a sphere wobbling 2% around the distance where the 32x16 level takes over from 16x8
+    float threshold = LodChain::GetMaxRadius( 16 );
+    float distance = projection( 1, 1 ) * 0.5f * height / threshold;
+    LodChain damped, undamped;
+    for ( int level = 0; level < levels; ++level ) {
+        damped.AddLevel( level, 256 >> ( levels - 1 - level ) );
+        undamped.AddLevel( level, 256 >> ( levels - 1 - level ) );
+    }
+    undamped.SetHysteresis( 0 );
+    selector.Begin( projection, view, height );
+    unsigned dampedSwitches(0), undampedSwitches(0);
+    for ( int frame = 0; frame < 1000; ++frame ) {
+        float pixels = selector.GetScreenRadius( Vector( 0, 0, -distance * ( 1 + 0.02f * std::sin( frame * 0.3f ) ) ), 1.0f );
+        dampedSwitches   += damped.Select( pixels );
+        undampedSwitches += undamped.Select( pixels );
+    }
+    fprintf( out, "level switches over 1000 frames near a threshold: %u without hysteresis, %u with\n",
+            undampedSwitches, dampedSwitches );
+}
+
+static void reportCache( FILE* out, const char* stage, const VertexCacheStats& stats )
+{
+    fprintf( out, "  %-10s %8u %8u %10u %8.3f %8.3f\n", stage, (unsigned)stats.triangles, (unsigned)stats.vertices,
+            (unsigned)stats.transformed, stats.acmr, stats.atvr );
+}
+
+static void benchmarkMeshOptimizer( FILE* out )
+{
+    const int sizes[][2] = { { Sphere::DEFAULT_COLUMNS, Sphere::DEFAULT_ROWS }, { 128, 64 }, { 512, 256 } };
+    const unsigned int cacheSize = 16;
+
+    fprintf( out, "Sphere meshes, %u entry FIFO cache\n", cacheSize );
+    for ( auto& size : sizes ) {
+        MeshBuilder geometry;
+        Sphere::MakeGeometry( geometry, 1.0f, size[0], size[1] );
+
+        fprintf( out, "%dx%d\n  %-10s %8s %8s %10s %8s %8s\n", size[0], size[1], "stage", "tris", "verts", "transforms", "ACMR", "ATVR" );
+        reportCache( out, "generated", AnalyzeVertexCache( geometry.GetIndices(), geometry.GetVertices().size(), cacheSize ) );
+
+        Clock::time_point start = Clock::now();
+        OptimizeVertexCache( geometry.GetIndices(), geometry.GetVertices().size() );
+        double cacheNs = elapsedNs( start );
+        reportCache( out, "cache", AnalyzeVertexCache( geometry.GetIndices(), geometry.GetVertices().size(), cacheSize ) );
+
+        start = Clock::now();
+        OptimizeOverdraw( geometry.GetIndices(), geometry.GetVertices(), cacheSize );
+        double overdrawNs = elapsedNs( start );
+        reportCache( out, "overdraw", AnalyzeVertexCache( geometry.GetIndices(), geometry.GetVertices().size(), cacheSize ) );
+
+        start = Clock::now();
+        OptimizeVertexFetch( geometry.GetVertices(), geometry.GetIndices() );
+        double fetchNs = elapsedNs( start );
+        reportCache( out, "fetch", AnalyzeVertexCache( geometry.GetIndices(), geometry.GetVertices().size(), cacheSize ) );
+
+        fprintf( out, "  time: cache %.3f ms, overdraw %.3f ms, fetch %.3f ms\n", cacheNs * 1e-6, overdrawNs * 1e-6, fetchNs * 1e-6 );
+    }
+}
+
+static bool sameGeometry( const MeshBuilder& a, const MeshBuilder& b )
+{
+    return a.GetVertices().size() == b.GetVertices().size() && a.GetIndices() == b.GetIndices() &&
+        std::memcmp( &a.GetVertices()[0], &b.GetVertices()[0], sizeof(Vertex)*a.GetVertices().size() ) == 0;
+}
+
+static void benchmarkMeshGeneration( FILE* out )
+{
+    const int sizes[][2] = { { 256, 128 }, { 1024, 512 }, { 2048, 1024 } };
+    ThreadPool& pool = ThreadPool::GetDefault();
+
+    fprintf( out, "Sphere generation, %u pool threads + caller\n", pool.GetSize() );
+    fprintf( out, "%-12s %16s %16s %9s\n", "size", "serial", "parallel", "speedup" );
+    for ( auto& size : sizes ) {
+        char name[32];
+        snprintf( name, sizeof(name), "%dx%d", size[0], size[1] );
+
+        pool.SetMaxParallelism( 0 );
+        Clock::time_point start = Clock::now();
+        MeshBuilder serial;
+        Sphere::MakeGeometry( serial, 1.0f, size[0], size[1] );
+        double serialNs = elapsedNs( start );
+
+        pool.SetMaxParallelism( pool.GetSize() );
+        start = Clock::now();
+        MeshBuilder parallel;
+        Sphere::MakeGeometry( parallel, 1.0f, size[0], size[1] );
+        double parallelNs = elapsedNs( start );
+
+        fprintf( out, "%-12s %13.2f ms %13.2f ms %8.2fx%s\n", name, serialNs * 1e-6, parallelNs * 1e-6, serialNs/parallelNs,
+                sameGeometry( serial, parallel ) ? "" : "  MISMATCH" );
+    }
+}
+
+// What the stress test pushes: producer id and a running number per producer
+struct QueueItem
+{
+    int producer;
+    int sequence;
+};
+
+// The mutex protected list the renderer used before CommandQueue. Same interface, baseline only
+class LockedQueue
+{
+    boost::mutex m_Mutex;
+    std::deque< QueueItem > m_Items;
+public:
+    void Push( const QueueItem& item )
+    {
+        boost::lock_guard< boost::mutex > lock( m_Mutex );
+        m_Items.push_back( item );
+    }
+
+    template< typename Fn >
+    std::size_t Drain( Fn fn )
+    {
+        std::deque< QueueItem > items;
+        {
+            boost::lock_guard< boost::mutex > lock( m_Mutex );
+            items.swap( m_Items );
+        }
+        for ( auto& item : items ) {
+            fn( item );
+        }
+        return items.size();
+    }
+};
+
+// numProducers threads push perProducer items each while the calling thread drains, like the render thread does.
+// Returns false if an item got lost, duplicated or arrived out of order for its producer
+template< typename Queue >
+static bool stressQueue( Queue& queue, int numProducers, int perProducer, double& ns )
+{
+    std::vector< int > next( numProducers, 0 );
+    bool ordered(true);
+    auto consume = [&]( const QueueItem& item ) {
+        ordered &= item.sequence == next[ item.producer ];
+        ++next[ item.producer ];
+    };
+
+    std::atomic< bool > go( false );
+    boost::thread_group producers;
+    for ( int p = 0; p < numProducers; ++p ) {
+        producers.create_thread( [&queue, &go, p, perProducer]() {
+            while ( !go ) {
+                boost::this_thread::yield();
+            }
+            for ( int i = 0; i < perProducer; ++i ) {
+                QueueItem item = { p, i };
+                queue.Push( item );
+            }
+        } );
+    }
+
+    const std::size_t total = std::size_t( numProducers ) * perProducer;
+    std::size_t received(0);
+    Clock::time_point start = Clock::now();
+    go = true;
+    while ( received < total ) {
+        std::size_t count = queue.Drain( consume );
+        if ( count == 0 ) {
+            boost::this_thread::yield();
+        }
+        received += count;
+    }
+    ns = elapsedNs( start );
+    producers.join_all();
+
+    // nothing may show up after the last expected item
+    received += queue.Drain( consume );
+    return ordered && received == total;
+}
+
+static void benchmarkCommandQueue( FILE* out )
+{
+    const int perProducer = 200000;
+    const int numProducers = std::max( 4u, boost::thread::hardware_concurrency() * 2 );
+
+    fprintf( out, "Command queue, %d producers x %d items, 1 consumer\n", numProducers, perProducer );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "mutex", "lock-free", "speedup" );
+
+    const std::size_t capacities[] = { 64, 4096 };
+    for ( auto capacity : capacities ) {
+        double lockedNs(0), lockFreeNs(0);
+        LockedQueue locked;
+        bool lockedOk = stressQueue( locked, numProducers, perProducer, lockedNs );
+        // small queues keep producers waiting for the consumer - that path has to hold up as well
+        CommandQueue< QueueItem > queue( capacity );
+        bool lockFreeOk = stressQueue( queue, numProducers, perProducer, lockFreeNs );
+
+        char name[32];
+        snprintf( name, sizeof(name), "cap %u", unsigned( capacity ) );
+        std::size_t count = std::size_t( numProducers ) * perProducer;
+        fprintf( out, "%-12s %10.2f ns/op %10.2f ns/op %8.2fx%s\n", name, lockedNs/count, lockFreeNs/count, lockedNs/lockFreeNs,
+                lockedOk && lockFreeOk ? "" : "  MISMATCH" );
+    }
+}
+
+// Does nothing, but has to be reached through the pointer like every real entity
+class BenchEntity : public Entity
+{
+public:
+    int  order;
+    bool removed;
+
+    explicit BenchEntity( int o ) : order(o), removed(false) {}
+
+    virtual bool HandleEvent( const SDL_Event& event ) { return false; }
+protected:
+    virtual bool Initialize() { return true; }
+
+    virtual void Render( long ticks ) {}
+};
+
+static void benchmarkRenderList( FILE* out )
+{
+    const int count = 100000;
+    const int frames = 100;
+
+    // same entities for both, shuffled priorities. Every 10th one gets removed
+    std::vector< EntityPtr > entities( count );
+    for ( int i = 0; i < count; ++i ) {
+        entities[i].reset( new BenchEntity( ( i * 7919 ) % count ) );
+    }
+    auto orderOf = []( const Entity* entity ) { return static_cast< const BenchEntity* >( entity )->order; };
+
+    fprintf( out, "Render list, %d entities\n", count );
+    fprintf( out, "%-12s %16s %16s %9s\n", "test", "std::list", "RenderList", "speedup" );
+
+    // add + sort
+    Clock::time_point start = Clock::now();
+    EntityList list;
+    for ( auto& entity : entities ) {
+        list.push_back( entity );
+    }
+    list.sort( [&]( const EntityPtr& a, const EntityPtr& b ) { return orderOf( a.get() ) < orderOf( b.get() ); } );
+    double listNs = elapsedNs( start );
+
+    start = Clock::now();
+    RenderList renderList;
+    renderList.Reserve( count );
+    std::vector< RenderList::Handle > handles( count );
+    for ( int i = 0; i < count; ++i ) {
+        handles[i] = renderList.Add( entities[i], orderOf( entities[i].get() ) );
+    }
+    renderList.Sort();
+    double renderListNs = elapsedNs( start );
+    reportResult( out, "add+sort", count, listNs, renderListNs );
+
+    // traversal like Renderer::Run, read the flags of every entity
+    uint32_t listSum(0), renderListSum(0);
+    start = Clock::now();
+    for ( int f = 0; f < frames; ++f ) {
+        for ( auto& entity : list ) {
+            listSum += entity->AreFlagsSet( Entity::F_ENABLE );
+        }
+    }
+    listNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int f = 0; f < frames; ++f ) {
+        for ( auto& item : renderList ) {
+            renderListSum += item.entity->AreFlagsSet( Entity::F_ENABLE );
+        }
+    }
+    renderListNs = elapsedNs( start );
+    reportResult( out, "traverse", std::size_t( count ) * frames, listNs, renderListNs );
+
+    // remove: the list sweeps for the flagged entities, the render list removes by handle and compacts
+    for ( int i = 0; i < count; i += 10 ) {
+        static_cast< BenchEntity* >( entities[i].get() )->removed = true;
+    }
+    start = Clock::now();
+    for ( auto entity = list.begin(); entity != list.end(); ) {
+        if ( static_cast< BenchEntity* >( entity->get() )->removed ) {
+            entity = list.erase( entity );
+            continue;
+        }
+        ++entity;
+    }
+    listNs = elapsedNs( start );
+    start = Clock::now();
+    for ( int i = 0; i < count; i += 10 ) {
+        renderList.Remove( handles[i] );
+    }
+    renderList.Compact();
+    renderListNs = elapsedNs( start );
+    reportResult( out, "remove", count / 10, listNs, renderListNs );
+
+    // both must end up with the same entities in the same order
+    bool same = list.size() == renderList.size() && listSum == renderListSum;
+    std::size_t i(0);
+    for ( auto entity = list.begin(); same && entity != list.end(); ++entity, ++i ) {
+        same = entity->get() == renderList[i].entity;
+    }
+    if ( !same ) {
+        fprintf( out, "MISMATCH\n" );
+    }
+}
+
+static void benchmarkDrawSort( FILE* out )
+{
+    const std::size_t sizes[] = { 1000, 100000, 1000000 };
+
+    fprintf( out, "Draw key sort\n" );
+    fprintf( out, "%-12s %16s %16s %9s\n", "size", "stable_sort", "radix", "speedup" );
+    for ( auto size : sizes ) {
+        // one opaque layer, a few priorities and states, lots of buffers and depths - what a big scene looks like
+        std::vector< RenderList::Item > items( size );
+        uint32_t seed(12345);
+        for ( std::size_t i = 0; i < size; ++i ) {
+            seed = seed * 1664525u + 1013904223u;
+            items[i].key = DrawKey::Make( DrawInfo::LAYER_OPAQUE, seed % 4, ( seed >> 8 ) % 16, ( seed >> 4 ) % 4096,
+                    float( seed >> 16 ) / 65536.0f * DrawKey::MAX_DEPTH );
+            items[i].entity = nullptr;
+            items[i].handle = i;
+        }
+        std::vector< RenderList::Item > reference( items ), scratch;
+
+        Clock::time_point start = Clock::now();
+        std::stable_sort( reference.begin(), reference.end(),
+                []( const RenderList::Item& a, const RenderList::Item& b ) { return a.key < b.key; } );
+        double referenceNs = elapsedNs( start );
+
+        start = Clock::now();
+        RadixSort( items, scratch, []( const RenderList::Item& item ) { return item.key; } );
+        double ns = elapsedNs( start );
+
+        // both are stable - same keys and same tie order
+        bool same(true);
+        for ( std::size_t i = 0; same && i < size; ++i ) {
+            same = items[i].key == reference[i].key && items[i].handle == reference[i].handle;
+        }
+        char name[32];
+        snprintf( name, sizeof(name), "%u", unsigned( size ) );
+        fprintf( out, "%-12s %10.2f ns/op %10.2f ns/op %8.2fx%s\n", name, referenceNs/size, ns/size, referenceNs/ns,
+                same ? "" : "  MISMATCH" );
+    }
+}
+
+struct BenchmarkEntry
+{
+    const char* name;
+    void (*run)( FILE* out );
+};
+
+static const BenchmarkEntry sBenchmarks[] =
+{
+    { "vector", benchmarkVector },
+    { "batch",  benchmarkBatch  },
+    { "matrix", benchmarkMatrix },
+    { "scenegraph", benchmarkSceneGraph },
+    { "cull",   benchmarkCull   },
+    { "bvh",    benchmarkBvh    },
+    { "lod",    benchmarkLod    },
+    { "meshopt", benchmarkMeshOptimizer },
+    { "meshgen", benchmarkMeshGeneration },
+    { "cmdqueue", benchmarkCommandQueue },
+    { "renderlist", benchmarkRenderList },
+    { "drawsort", benchmarkDrawSort },
+};
+
+bool RunBenchmark( const char* name, FILE* out )
+{
+    for ( auto& entry : sBenchmarks ) {
+        if ( std::strcmp( entry.name, name ) == 0 ) {
+            entry.run( out );
+            return true;
+        }
+    }
+    return false;
+}
+
+void ListBenchmarks( FILE* out )
+{
+    fprintf( out, "Available benchmarks:" );
+    for ( auto& entry : sBenchmarks ) {
+        fprintf( out, " %s", entry.name );
+    }
+    fprintf( out, "\n" );
+}
@@ -0,0 +1,19 @@
+/*
+ * benchmark.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <cstdio>
+
+// CPU side micro benchmarks. No window or GL context required. Run with: sdl-vbo --bench <name>
+// Returns false if there is no benchmark called name.
+bool RunBenchmark( const char* name, FILE* out );
+
+// Lists all available benchmarks
+void ListBenchmarks( FILE* out );
+
+#endif /* BENCHMARK_H_ */
@@ -0,0 +1,129 @@
+/*
+ * bounds.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include "matrix.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Axis aligned box in plain floats - what the BVH stores per item and node. Empty (min > max) until something is added
+struct Box
+{
+    float min[3];
+    float max[3];
+
+    Box()
+    {
+        min[0] = min[1] = min[2] = std::numeric_limits< float >::max();
+        max[0] = max[1] = max[2] = -std::numeric_limits< float >::max();
+    }
+
+    Box( const Vector& lo, const Vector& hi )
+    {
+        for ( int axis = 0; axis < 3; ++axis ) {
+            min[ axis ] = lo[ Vector::Coord( axis ) ];
+            max[ axis ] = hi[ Vector::Coord( axis ) ];
+        }
+    }
+
+    bool IsEmpty() const { return min[0] > max[0]; }
+
+    void Add( const Box& box )
+    {
+        for ( int axis = 0; axis < 3; ++axis ) {
+            min[ axis ] = std::min( min[ axis ], box.min[ axis ] );
+            max[ axis ] = std::max( max[ axis ], box.max[ axis ] );
+        }
+    }
+
+    void Add( const float point[3] )
+    {
+        for ( int axis = 0; axis < 3; ++axis ) {
+            min[ axis ] = std::min( min[ axis ], point[ axis ] );
+            max[ axis ] = std::max( max[ axis ], point[ axis ] );
+        }
+    }
+
+    float GetCenter( int axis ) const { return ( min[ axis ] + max[ axis ] ) * 0.5f; }
+
+    // Surface area, 0 for empty boxes
+    float GetArea() const
+    {
+        if ( IsEmpty() ) {
+            return 0;
+        }
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return 2 * ( dx*dy + dy*dz + dz*dx );
+    }
+
+    // Squared distance from point to the box, 0 inside
+    float GetDistanceSq( const Vector& point ) const
+    {
+        float distanceSq(0);
+        for ( int axis = 0; axis < 3; ++axis ) {
+            float p = point[ Vector::Coord( axis ) ];
+            float d = std::max( std::max( min[ axis ] - p, p - max[ axis ] ), 0.0f );
+            distanceSq += d*d;
+        }
+        return distanceSq;
+    }
+};
+
+// Model space bounding box and bounding sphere of a mesh. The sphere is centered on the box, with the radius of the
+// farthest vertex - tighter than the box's half diagonal for round shapes
+struct Bounds
+{
+    Vector min;
+    Vector max;
+    Vector center;
+    float  radius;
+
+    Bounds() : min( 0, 0, 0 ), max( 0, 0, 0 ), center( 0, 0, 0 ), radius( 0 ) {}
+
+    static Bounds FromBox( const Vector& min, const Vector& max )
+    {
+        Bounds bounds;
+        bounds.min    = min;
+        bounds.max    = max;
+        bounds.center = ( min + max ) * 0.5f;
+        bounds.center[ Vector::W ] = 1;
+        bounds.radius = ( max - bounds.center ).Magnitude();
+        return bounds;
+    }
+
+    // The sphere after world (rotation, translation and scale - the largest axis scale wins)
+    void GetWorldSphere( const Matrix4& world, Vector& worldCenter, float& worldRadius ) const
+    {
+        worldCenter = world * center;
+        float scale(0);
+        for ( int col = 0; col < 3; ++col ) {
+            scale = std::max( scale, world( 0, col ) * world( 0, col ) + world( 1, col ) * world( 1, col ) + world( 2, col ) * world( 2, col ) );
+        }
+        worldRadius = radius * std::sqrt( scale );
+    }
+
+    // The box after world: the box around the transformed box (rotations make it grow)
+    Box GetWorldBox( const Matrix4& world ) const
+    {
+        Vector boxCenter = world * ( ( min + max ) * 0.5f );
+        Vector extent = ( max - min ) * 0.5f;
+        Box box;
+        for ( int row = 0; row < 3; ++row ) {
+            float e = std::fabs( world( row, 0 ) ) * extent[ Vector::X ] + std::fabs( world( row, 1 ) ) * extent[ Vector::Y ] +
+                      std::fabs( world( row, 2 ) ) * extent[ Vector::Z ];
+            box.min[ row ] = boxCenter[ Vector::Coord( row ) ] - e;
+            box.max[ row ] = boxCenter[ Vector::Coord( row ) ] + e;
+        }
+        return box;
+    }
+};
+
+#endif /* BOUNDS_H_ */
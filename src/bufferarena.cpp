@@ -0,0 +1,236 @@
+/*
+ * bufferarena.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "bufferarena.h"
+#include "glstate.h"
+#include "stagingbuffer.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+
+BufferArena *BufferArena::sCurrent = nullptr;
+
+static GLintptr Align( GLintptr offset, GLsizei alignment )
+{
+    return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+static GLStateCache::Buffer GetTarget( BufferArena::Kind kind )
+{
+    return kind == BufferArena::VERTICES ? GLStateCache::BUFFER_ARRAY : GLStateCache::BUFFER_ELEMENT_ARRAY;
+}
+
+BufferArena::BufferArena()
+    : m_PageSize(0)
+    , m_Enabled(false)
+    , m_CanCompact(false)
+    , m_Compactions(0)
+    , m_Allocations(0)
+    , m_PeakPages(0)
+    , m_PeakSize(0)
+{
+}
+
+BufferArena::~BufferArena()
+{
+    // GL objects are gone with the context if Release wasn't called
+}
+
+void BufferArena::Init( GLsizeiptr pageSize )
+{
+    Release();
+
+    m_PageSize   = pageSize;
+    m_Enabled    = pageSize > 0 && ( GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex );
+    m_CanCompact = glewGetExtension("GL_ARB_copy_buffer");
+}
+
+void BufferArena::Release()
+{
+    for ( auto& page : m_Pages ) {
+        GLStateCache::DeleteBuffers( 1, &page.buffer );
+    }
+    m_Pages.clear();
+    m_Blocks.clear();
+    m_FreeBlocks.clear();
+    if ( sCurrent == this ) {
+        sCurrent = nullptr;
+    }
+    m_Enabled = false;
+}
+
+uint32_t BufferArena::AddPage( Kind kind, GLsizei alignment, GLsizeiptr size )
+{
+    Page page;
+    page.kind      = kind;
+    page.alignment = alignment;
+    page.size      = std::max( m_PageSize, Align( size, alignment ) );
+    page.free      = page.size;
+    Range all = { 0, page.size };
+    page.ranges.push_back( all );
+
+    glGenBuffers( 1, &page.buffer );
+    GLStateCache& state = GLStateCache::GetCurrent();
+    state.BindBuffer( GetTarget( kind ), page.buffer );
+    glBufferData( kind == VERTICES ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, page.size, nullptr, GL_STATIC_DRAW );
+
+    m_Pages.push_back( page );
+    m_PeakPages = std::max< unsigned >( m_PeakPages, m_Pages.size() );
+    GLsizeiptr total(0);
+    for ( auto& p : m_Pages ) {
+        total += p.size;
+    }
+    m_PeakSize = std::max( m_PeakSize, total );
+    return m_Pages.size() - 1;
+}
+
+GLintptr BufferArena::Fit( Page& page, GLsizeiptr size )
+{
+    for ( auto it = page.ranges.begin(); it != page.ranges.end(); ++it ) {
+        GLintptr offset = Align( it->offset, page.alignment );
+        GLintptr end    = it->offset + it->size;
+        if ( offset + size > end ) {
+            continue;
+        }
+        // the alignment padding stays free in front, the rest behind
+        Range before = { it->offset, offset - it->offset };
+        Range after  = { offset + size, end - offset - size };
+        it = page.ranges.erase( it );
+        if ( after.size > 0 ) {
+            it = page.ranges.insert( it, after );
+        }
+        if ( before.size > 0 ) {
+            page.ranges.insert( it, before );
+        }
+        page.free -= size;
+        return offset;
+    }
+    return -1;
+}
+
+void BufferArena::Compact( uint32_t index )
+{
+    Page& page = m_Pages[ index ];
+    std::vector< BlockId > blocks;
+    for ( BlockId id = 0; id < m_Blocks.size(); ++id ) {
+        if ( m_Blocks[ id ].used && m_Blocks[ id ].page == index ) {
+            blocks.push_back( id );
+        }
+    }
+    std::sort( blocks.begin(), blocks.end(), [this]( BlockId a, BlockId b ) { return m_Blocks[a].offset < m_Blocks[b].offset; } );
+
+    // copy the live blocks to the front of a fresh buffer - no overlapping copies within one buffer
+    GLuint buffer(0);
+    glGenBuffers( 1, &buffer );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, buffer );
+    glBufferData( GL_COPY_WRITE_BUFFER, page.size, nullptr, GL_STATIC_DRAW );
+    glBindBuffer( GL_COPY_READ_BUFFER, page.buffer );
+    GLintptr cursor(0);
+    for ( BlockId id : blocks ) {
+        Block& block = m_Blocks[ id ];
+        cursor = Align( cursor, page.alignment );
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, block.offset, cursor, block.size );
+        block.offset = cursor;
+        cursor += block.size;
+    }
+    glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+    GLStateCache::DeleteBuffers( 1, &page.buffer );
+    page.buffer = buffer;
+
+    page.ranges.clear();
+    if ( cursor < page.size ) {
+        Range rest = { cursor, page.size - cursor };
+        page.ranges.push_back( rest );
+    }
+    page.free = page.size - cursor;
+    ++m_Compactions;
+}
+
+BufferArena::BlockId BufferArena::Allocate( Kind kind, GLsizei alignment, GLsizeiptr size )
+{
+    BOOST_ASSERT( m_Enabled && alignment > 0 && size > 0 );
+
+    uint32_t index(0);
+    GLintptr offset(-1);
+    for ( uint32_t i = 0; i < m_Pages.size() && offset < 0; ++i ) {
+        Page& page = m_Pages[i];
+        if ( page.kind == kind && page.alignment == alignment ) {
+            index  = i;
+            offset = Fit( page, size );
+        }
+    }
+    // fragmented: the space is there, just not in one piece
+    for ( uint32_t i = 0; i < m_Pages.size() && offset < 0 && m_CanCompact; ++i ) {
+        Page& page = m_Pages[i];
+        if ( page.kind == kind && page.alignment == alignment && page.free >= size ) {
+            Compact( i );
+            index  = i;
+            offset = Fit( m_Pages[i], size );
+        }
+    }
+    if ( offset < 0 ) {
+        index  = AddPage( kind, alignment, size );
+        offset = Fit( m_Pages[ index ], size );
+    }
+    BOOST_ASSERT( offset >= 0 );
+
+    ++m_Allocations;
+    Block block = { index, offset, size, true };
+    if ( !m_FreeBlocks.empty() ) {
+        BlockId id = m_FreeBlocks.back();
+        m_FreeBlocks.pop_back();
+        m_Blocks[ id ] = block;
+        return id;
+    }
+    m_Blocks.push_back( block );
+    return m_Blocks.size() - 1;
+}
+
+void BufferArena::Free( BlockId id )
+{
+    BOOST_ASSERT( id < m_Blocks.size() && m_Blocks[ id ].used );
+    Block& block = m_Blocks[ id ];
+    Page& page = m_Pages[ block.page ];
+
+    // back into the sorted free list, merged with the neighbours it touches
+    Range range = { block.offset, block.size };
+    auto it = std::lower_bound( page.ranges.begin(), page.ranges.end(), range,
+            []( const Range& a, const Range& b ) { return a.offset < b.offset; } );
+    if ( it != page.ranges.end() && range.offset + range.size == it->offset ) {
+        range.size += it->size;
+        it = page.ranges.erase( it );
+    }
+    if ( it != page.ranges.begin() && ( it - 1 )->offset + ( it - 1 )->size == range.offset ) {
+        ( it - 1 )->size += range.size;
+    } else {
+        page.ranges.insert( it, range );
+    }
+    page.free += block.size;
+
+    block.used = false;
+    m_FreeBlocks.push_back( id );
+}
+
+void BufferArena::Upload( BlockId id, GLsizeiptr size, const GLvoid* data )
+{
+    const Block& block = m_Blocks[ id ];
+    const Page& page = m_Pages[ block.page ];
+    BOOST_ASSERT( size <= block.size );
+    GLStateCache::GetCurrent().BindBuffer( GetTarget( page.kind ), page.buffer );
+    StagedBufferSubData( page.kind == VERTICES ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, block.offset, size, data );
+}
+
+void BufferArena::Report( FILE* out ) const
+{
+    if ( m_PeakPages == 0 ) {
+        fprintf( out, "Arena: not used\n" );
+        return;
+    }
+    fprintf( out, "Arena: %u pages, %u KB at peak, %u allocations, %u compactions\n", m_PeakPages,
+            unsigned( m_PeakSize / 1024 ), m_Allocations, m_Compactions );
+}
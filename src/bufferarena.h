@@ -0,0 +1,115 @@
+/*
+ * bufferarena.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef BUFFERARENA_H_
+#define BUFFERARENA_H_
+
+#include <GL/glew.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+// A few big GL buffers (pages) that all static geometry is suballocated from - instead of a buffer object per mesh.
+// Vertex pages only hold blocks of one stride, aligned to it, so a mesh can draw with base vertex = offset / stride
+// and the pointers set up for the page serve every mesh in it. Blocks are first fit from a free list sorted by
+// offset; freed blocks coalesce with their neighbours. A page that has the space but no hole big enough is
+// compacted on the GPU (GL_ARB_copy_buffer) - block offsets and the page's buffer id change then.
+// Render thread only
+class BufferArena : boost::noncopyable
+{
+public:
+    enum Kind {
+        VERTICES = 0,   // GL_ARRAY_BUFFER
+        INDICES,        // GL_ELEMENT_ARRAY_BUFFER
+    };
+
+    typedef uint32_t BlockId;
+
+    static const BlockId INVALID_BLOCK = ~0u;
+private:
+    struct Range
+    {
+        GLintptr   offset;
+        GLsizeiptr size;
+    };
+
+    struct Page
+    {
+        GLuint     buffer;
+        Kind       kind;
+        GLsizei    alignment;   // vertex pages: the stride of all blocks in it
+        GLsizeiptr size;
+        GLsizeiptr free;        // sum of ranges
+        std::vector< Range > ranges;    // free ranges, sorted by offset
+    };
+
+    struct Block
+    {
+        uint32_t   page;
+        GLintptr   offset;
+        GLsizeiptr size;
+        bool       used;
+    };
+
+    std::vector< Page >    m_Pages;
+    std::vector< Block >   m_Blocks;
+    std::vector< BlockId > m_FreeBlocks;    // unused entries of m_Blocks
+
+    GLsizeiptr m_PageSize;
+    bool       m_Enabled;
+    bool       m_CanCompact;
+    unsigned   m_Compactions;
+    unsigned   m_Allocations;
+    unsigned   m_PeakPages;
+    GLsizeiptr m_PeakSize;      // bytes in all pages
+
+    static BufferArena *sCurrent;
+
+    // Offset of a size byte block in page, -1 if no free range fits
+    GLintptr Fit( Page& page, GLsizeiptr size );
+
+    void Compact( uint32_t index );
+
+    uint32_t AddPage( Kind kind, GLsizei alignment, GLsizeiptr size );
+public:
+    BufferArena();
+
+    ~BufferArena();
+
+    // Needs base vertex draws (GL 3.2 or GL_ARB_draw_elements_base_vertex). pageSize 0 disables the arena - meshes
+    // get buffers of their own then
+    void Init( GLsizeiptr pageSize );
+
+    // Must be called while the context is still current
+    void Release();
+
+    bool IsEnabled() const { return m_Enabled; }
+
+    // size bytes aligned to alignment (the vertex stride, the index size). Never fails - adds a page if needed
+    BlockId Allocate( Kind kind, GLsizei alignment, GLsizeiptr size );
+
+    void Free( BlockId block );
+
+    // Uploads size bytes to the start of block (staged). Leaves the page bound to its target in the GLStateCache
+    void Upload( BlockId block, GLsizeiptr size, const GLvoid* data );
+
+    GLuint GetBuffer( BlockId block ) const { return m_Pages[ m_Blocks[ block ].page ].buffer; }
+
+    GLintptr GetOffset( BlockId block ) const { return m_Blocks[ block ].offset; }
+
+    void Report( FILE* out ) const;
+
+    // Arena of the render thread. nullptr if there is none
+    static BufferArena* GetCurrent() { return sCurrent; }
+
+    static void SetCurrent( BufferArena* arena ) { sCurrent = arena; }
+};
+
+#endif /* BUFFERARENA_H_ */
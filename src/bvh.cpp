@@ -0,0 +1,407 @@
+/*
+ * bvh.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "bvh.h"
+#include "frustum.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+const Bvh::ItemId Bvh::INVALID_ITEM;
+const uint32_t Bvh::NO_NODE;
+
+Bvh::Bvh()
+    : m_ParallelThreshold(16384)
+    , m_BuildArea(0)
+    , m_Area(0)
+    , m_Builds(0)
+    , m_BuildMs(0)
+    , m_Refits(0)
+    , m_RefitNodes(0)
+{
+}
+
+uint32_t Bvh::Split( Node& node, uint32_t first, uint32_t last, uint32_t depth )
+{
+    Box bounds, centers;
+    for ( uint32_t i = first; i < last; ++i ) {
+        ItemId item = m_Items[i];
+        bounds.Add( m_Boxes[ item ] );
+        centers.Add( &m_Centers[ item*3 ] );
+    }
+    node.box   = bounds;
+    node.first = first;
+    node.count = last - first;
+
+    const uint32_t count = last - first;
+    if ( count == 1 || depth + 1 >= MAX_DEPTH ) {
+        return last;
+    }
+    int axis(0);
+    for ( int a = 1; a < 3; ++a ) {
+        if ( centers.max[ a ] - centers.min[ a ] > centers.max[ axis ] - centers.min[ axis ] ) {
+            axis = a;
+        }
+    }
+    const float extent = centers.max[ axis ] - centers.min[ axis ];
+    if ( extent <= 0 ) {
+        // all on one spot - any split is as good as the other
+        return count <= MAX_LEAF_SIZE ? last : first + count/2;
+    }
+
+    const float origin = centers.min[ axis ];
+    const float scale  = BINS / extent;
+    auto binOf = [&]( ItemId item ) {
+        return std::min( int( ( m_Centers[ item*3 + axis ] - origin ) * scale ), int( BINS - 1 ) );
+    };
+    Box      binBoxes[ BINS ];
+    uint32_t binCounts[ BINS ] = {};
+    for ( uint32_t i = first; i < last; ++i ) {
+        int bin = binOf( m_Items[i] );
+        binBoxes[ bin ].Add( m_Boxes[ m_Items[i] ] );
+        ++binCounts[ bin ];
+    }
+
+    // sweep from the right, then from the left: cost of splitting after each bin
+    float    rightArea[ BINS ];
+    uint32_t rightCount[ BINS ];
+    Box box;
+    uint32_t n(0);
+    for ( int bin = BINS - 1; bin > 0; --bin ) {
+        box.Add( binBoxes[ bin ] );
+        n += binCounts[ bin ];
+        rightArea[ bin - 1 ]  = box.GetArea();
+        rightCount[ bin - 1 ] = n;
+    }
+    float bestCost = -1;
+    int   bestBin(0);
+    box = Box();
+    n = 0;
+    for ( int bin = 0; bin < BINS - 1; ++bin ) {
+        box.Add( binBoxes[ bin ] );
+        n += binCounts[ bin ];
+        if ( n == 0 || rightCount[ bin ] == 0 ) {
+            continue;
+        }
+        float cost = box.GetArea() * n + rightArea[ bin ] * rightCount[ bin ];
+        if ( bestCost < 0 || cost < bestCost ) {
+            bestCost = cost;
+            bestBin  = bin;
+        }
+    }
+
+    // one traversal step against testing every item. Cheap leaves stay leaves
+    float area = bounds.GetArea();
+    if ( count <= MAX_LEAF_SIZE && ( bestCost < 0 || area <= 0 || 1 + bestCost / area >= float( count ) ) ) {
+        return last;
+    }
+    if ( bestCost < 0 ) {
+        return first + count/2;
+    }
+    return std::partition( m_Items.begin() + first, m_Items.begin() + last,
+            [&]( ItemId item ) { return binOf( item ) <= bestBin; } ) - m_Items.begin();
+}
+
+void Bvh::BuildTask( std::vector< Node >& nodes, const Task& task, std::size_t deferBelow, std::vector< Task >* deferred )
+{
+    std::vector< Task > work( 1, task );
+    while ( !work.empty() ) {
+        Task t = work.back();
+        work.pop_back();
+        if ( deferred && t.last - t.first < deferBelow ) {
+            deferred->push_back( t );
+            continue;
+        }
+        uint32_t mid = Split( nodes[ t.node ], t.first, t.last, t.depth );
+        if ( mid == t.last ) {
+            continue;
+        }
+        uint32_t left = nodes.size();
+        nodes[ t.node ].first = left;
+        nodes[ t.node ].count = 0;
+        nodes.resize( left + 2 );
+        Task right = { left + 1, mid, t.last, t.depth + 1 };
+        Task leftTask = { left, t.first, mid, t.depth + 1 };
+        work.push_back( right );
+        work.push_back( leftTask );
+    }
+}
+
+void Bvh::Build( const std::vector< Box >& boxes )
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    m_Boxes = boxes;
+    m_Items.clear();
+    m_Leaves.assign( boxes.size(), NO_NODE );
+    m_Centers.resize( boxes.size() * 3 );
+    for ( ItemId item = 0; item < boxes.size(); ++item ) {
+        if ( !boxes[ item ].IsEmpty() ) {
+            m_Items.push_back( item );
+            for ( int axis = 0; axis < 3; ++axis ) {
+                m_Centers[ item*3 + axis ] = boxes[ item ].GetCenter( axis );
+            }
+        }
+    }
+    m_Nodes.clear();
+    const std::size_t count = m_Items.size();
+    if ( count > 0 ) {
+        m_Nodes.resize( 1 );
+        Task root = { 0, 0, uint32_t( count ), 0 };
+        if ( m_ParallelThreshold > 0 && count >= m_ParallelThreshold ) {
+            // split the top until there are a few subtrees per thread, build those concurrently
+            ThreadPool& pool = ThreadPool::GetDefault();
+            std::vector< Task > tasks;
+            BuildTask( m_Nodes, root, std::max< std::size_t >( 1, count / ( 8 * ( pool.GetSize() + 1 ) ) ), &tasks );
+
+            std::vector< std::vector< Node > > subtrees( tasks.size() );
+            pool.ParallelFor( 0, tasks.size(), [&]( int first, int last ) {
+                for ( int t = first; t < last; ++t ) {
+                    Task local = { 0, tasks[t].first, tasks[t].last, tasks[t].depth };
+                    subtrees[t].resize( 1 );
+                    BuildTask( subtrees[t], local, 0, nullptr );
+                }
+            } );
+
+            // local node i > 0 goes to offset + i, the local root replaces the task's placeholder
+            for ( std::size_t t = 0; t < tasks.size(); ++t ) {
+                const std::vector< Node >& local = subtrees[t];
+                uint32_t offset = m_Nodes.size() - 1;
+                for ( std::size_t i = 0; i < local.size(); ++i ) {
+                    Node node = local[i];
+                    if ( node.count == 0 ) {
+                        node.first += offset;
+                    }
+                    if ( i == 0 ) {
+                        m_Nodes[ tasks[t].node ] = node;
+                    } else {
+                        m_Nodes.push_back( node );
+                    }
+                }
+            }
+        } else {
+            BuildTask( m_Nodes, root, 0, nullptr );
+        }
+    }
+
+    m_Parents.assign( m_Nodes.size(), NO_NODE );
+    m_Dirty.assign( m_Nodes.size(), 0 );
+    m_DirtyNodes.clear();
+    m_Area = 0;
+    for ( uint32_t i = 0; i < m_Nodes.size(); ++i ) {
+        const Node& node = m_Nodes[i];
+        m_Area += node.box.GetArea();
+        if ( node.count == 0 ) {
+            m_Parents[ node.first ] = m_Parents[ node.first + 1 ] = i;
+        } else {
+            for ( uint32_t k = node.first; k < node.first + node.count; ++k ) {
+                m_Leaves[ m_Items[k] ] = i;
+            }
+        }
+    }
+    m_BuildArea = m_Area;
+    ++m_Builds;
+    m_BuildMs = std::chrono::duration< double, std::milli >( Clock::now() - start ).count();
+}
+
+bool Bvh::SetBounds( ItemId item, const Box& box )
+{
+    if ( !Contains( item ) ) {
+        return false;
+    }
+    if ( std::memcmp( &m_Boxes[ item ], &box, sizeof( Box ) ) == 0 ) {
+        return true;
+    }
+    m_Boxes[ item ] = box;
+    // up to the first node that is dirty already - everything above it is as well
+    for ( uint32_t node = m_Leaves[ item ]; node != NO_NODE && !m_Dirty[ node ]; node = m_Parents[ node ] ) {
+        m_Dirty[ node ] = 1;
+        m_DirtyNodes.push_back( node );
+    }
+    return true;
+}
+
+void Bvh::UpdateBox( uint32_t index )
+{
+    Node& node = m_Nodes[ index ];
+    Box box;
+    if ( node.count == 0 ) {
+        box = m_Nodes[ node.first ].box;
+        box.Add( m_Nodes[ node.first + 1 ].box );
+    } else {
+        for ( uint32_t k = node.first; k < node.first + node.count; ++k ) {
+            box.Add( m_Boxes[ m_Items[k] ] );
+        }
+    }
+    m_Area += box.GetArea() - node.box.GetArea();
+    node.box = box;
+}
+
+void Bvh::Refit()
+{
+    if ( m_DirtyNodes.empty() ) {
+        return;
+    }
+    // children come after their parents: back to front is bottom up
+    std::sort( m_DirtyNodes.begin(), m_DirtyNodes.end(), []( uint32_t a, uint32_t b ) { return a > b; } );
+    for ( uint32_t node : m_DirtyNodes ) {
+        UpdateBox( node );
+        m_Dirty[ node ] = 0;
+    }
+    ++m_Refits;
+    m_RefitNodes += m_DirtyNodes.size();
+    m_DirtyNodes.clear();
+}
+
+void Bvh::Query( const Frustum& frustum, std::vector< ItemId >& items ) const
+{
+    if ( m_Nodes.empty() ) {
+        return;
+    }
+    // a path down plus one sibling per level. The high bit marks nodes known to be inside
+    const uint32_t INSIDE_BIT = 0x80000000u;
+    uint32_t stack[ MAX_DEPTH + 1 ];
+    int size(0);
+    stack[ size++ ] = 0;
+    while ( size > 0 ) {
+        uint32_t entry = stack[ --size ];
+        const Node& node = m_Nodes[ entry & ~INSIDE_BIT ];
+        uint32_t inside = entry & INSIDE_BIT;
+        if ( !inside ) {
+            Frustum::Test test = frustum.Classify( node.box );
+            if ( test == Frustum::OUTSIDE ) {
+                continue;
+            }
+            inside = test == Frustum::INSIDE ? INSIDE_BIT : 0;
+        }
+        if ( node.count == 0 ) {
+            stack[ size++ ] = ( node.first + 1 ) | inside;
+            stack[ size++ ] = node.first | inside;
+            continue;
+        }
+        for ( uint32_t k = node.first; k < node.first + node.count; ++k ) {
+            ItemId item = m_Items[k];
+            if ( inside || frustum.Classify( m_Boxes[ item ] ) != Frustum::OUTSIDE ) {
+                items.push_back( item );
+            }
+        }
+    }
+}
+
+void Bvh::Query( const Vector& center, float radius, std::vector< ItemId >& items ) const
+{
+    if ( m_Nodes.empty() ) {
+        return;
+    }
+    const float radiusSq = radius * radius;
+    uint32_t stack[ MAX_DEPTH + 1 ];
+    int size(0);
+    stack[ size++ ] = 0;
+    while ( size > 0 ) {
+        const Node& node = m_Nodes[ stack[ --size ] ];
+        if ( node.box.GetDistanceSq( center ) > radiusSq ) {
+            continue;
+        }
+        if ( node.count == 0 ) {
+            stack[ size++ ] = node.first + 1;
+            stack[ size++ ] = node.first;
+            continue;
+        }
+        for ( uint32_t k = node.first; k < node.first + node.count; ++k ) {
+            ItemId item = m_Items[k];
+            if ( m_Boxes[ item ].GetDistanceSq( center ) <= radiusSq ) {
+                items.push_back( item );
+            }
+        }
+    }
+}
+
+// Slab test. Entry distance of the ray into box (0 if it starts inside), false if it misses or enters beyond limit
+static bool intersectRay( const Box& box, const float origin[3], const float inverse[3], float limit, float& distance )
+{
+    // inverted slabs of an empty box would let every ray through
+    if ( box.IsEmpty() ) {
+        return false;
+    }
+    float enter(0), leave( limit );
+    for ( int axis = 0; axis < 3; ++axis ) {
+        float t0 = ( box.min[ axis ] - origin[ axis ] ) * inverse[ axis ];
+        float t1 = ( box.max[ axis ] - origin[ axis ] ) * inverse[ axis ];
+        enter = std::max( enter, std::min( t0, t1 ) );
+        leave = std::min( leave, std::max( t0, t1 ) );
+    }
+    distance = enter;
+    return enter <= leave;
+}
+
+Bvh::ItemId Bvh::Raycast( const Vector& origin, const Vector& direction, float maxDistance, float& distance ) const
+{
+    ItemId hit = INVALID_ITEM;
+    distance = maxDistance;
+    if ( m_Nodes.empty() ) {
+        return hit;
+    }
+    const float o[3] = { origin[ Vector::X ], origin[ Vector::Y ], origin[ Vector::Z ] };
+    // axis parallel rays divide by zero: +-inf keeps the slab test working
+    const float inverse[3] = { 1 / direction[ Vector::X ], 1 / direction[ Vector::Y ], 1 / direction[ Vector::Z ] };
+
+    uint32_t stack[ MAX_DEPTH + 1 ];
+    float    entry[ MAX_DEPTH + 1 ];
+    int size(0);
+    float t;
+    if ( !intersectRay( m_Nodes[0].box, o, inverse, distance, t ) ) {
+        return hit;
+    }
+    stack[ size ] = 0;
+    entry[ size++ ] = t;
+    while ( size > 0 ) {
+        --size;
+        if ( entry[ size ] > distance ) {
+            // something nearer was found since this was pushed
+            continue;
+        }
+        const Node& node = m_Nodes[ stack[ size ] ];
+        if ( node.count == 0 ) {
+            // the nearer child is popped first
+            float tLeft, tRight;
+            bool left  = intersectRay( m_Nodes[ node.first ].box, o, inverse, distance, tLeft );
+            bool right = intersectRay( m_Nodes[ node.first + 1 ].box, o, inverse, distance, tRight );
+            if ( left && right && tLeft < tRight ) {
+                stack[ size ] = node.first + 1; entry[ size++ ] = tRight;
+                stack[ size ] = node.first;     entry[ size++ ] = tLeft;
+            } else {
+                if ( left ) {
+                    stack[ size ] = node.first;     entry[ size++ ] = tLeft;
+                }
+                if ( right ) {
+                    stack[ size ] = node.first + 1; entry[ size++ ] = tRight;
+                }
+            }
+            continue;
+        }
+        for ( uint32_t k = node.first; k < node.first + node.count; ++k ) {
+            ItemId item = m_Items[k];
+            if ( intersectRay( m_Boxes[ item ], o, inverse, distance, t ) && ( t < distance || hit == INVALID_ITEM ) ) {
+                distance = t;
+                hit = item;
+            }
+        }
+    }
+    return hit;
+}
+
+void Bvh::Report( FILE* out ) const
+{
+    if ( !m_Builds ) {
+        return;
+    }
+    fprintf( out, "BVH: %u items in %u nodes, %u builds (last %.2f ms), %u refits with %.1f nodes each, degradation %.2f\n",
+            unsigned( m_Items.size() ), unsigned( m_Nodes.size() ), m_Builds, m_BuildMs, m_Refits,
+            m_Refits ? double( m_RefitNodes ) / m_Refits : 0.0, GetDegradation() );
+}
@@ -0,0 +1,128 @@
+/*
+ * bvh.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef BVH_H_
+#define BVH_H_
+
+#include "bounds.h"
+#include "vector.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+class Frustum;
+
+// Bounding volume hierarchy over world space boxes, for visibility, picking and proximity queries that would
+// otherwise touch every entity. Built top down with a binned surface area heuristic; the top levels are split on
+// the calling thread, the subtrees below are built in parallel on the ThreadPool. Moving items don't rebuild: their
+// leaves and the nodes above are refit, which loosens the tree over time - GetDegradation tells when a rebuild pays.
+// Nodes are in one array, children after their parents, the two children of a node next to each other.
+// Not thread safe; queries are const and may run concurrently with each other
+class Bvh : boost::noncopyable
+{
+public:
+    typedef uint32_t ItemId;
+
+    static const ItemId INVALID_ITEM = ~0u;
+private:
+    enum {
+        BINS          = 16,     // SAH split candidates per axis
+        MAX_LEAF_SIZE = 8,      // larger leaves are split even if the SAH disagrees
+        MAX_DEPTH     = 64,     // nodes this deep are leaves - bounds the query stacks
+    };
+
+    static const uint32_t NO_NODE = ~0u;
+
+    struct Node
+    {
+        Box      box;
+        uint32_t first;     // internal nodes: the left child, the right one follows. Leaves: first entry in m_Items
+        uint32_t count;     // items in a leaf, 0 for internal nodes
+    };
+
+    // A node whose subtree still has to be built
+    struct Task
+    {
+        uint32_t node;
+        uint32_t first;
+        uint32_t last;
+        uint32_t depth;
+    };
+
+    std::vector< Node >     m_Nodes;    // root first
+    std::vector< uint32_t > m_Parents;  // by node, NO_NODE for the root
+    std::vector< char >     m_Dirty;    // by node: bounds changed since the last Refit
+    std::vector< uint32_t > m_DirtyNodes;
+    std::vector< ItemId >   m_Items;    // leaf order - every node covers a contiguous range
+    std::vector< Box >      m_Boxes;    // by item
+    std::vector< float >    m_Centers;  // by item, x y z. Build scratch
+    std::vector< uint32_t > m_Leaves;   // by item, NO_NODE if the item isn't in the tree
+
+    std::size_t m_ParallelThreshold;
+    float       m_BuildArea;    // summed node areas right after the build
+    float       m_Area;         // the same after the refits since
+    unsigned    m_Builds;
+    double      m_BuildMs;      // last build
+    unsigned    m_Refits;
+    std::size_t m_RefitNodes;
+
+    // Computes node's box over m_Items [first, last) and partitions the range for its children. Returns the split
+    // position, last if node stays a leaf. Touches nothing outside the range - ranges can be split concurrently
+    uint32_t Split( Node& node, uint32_t first, uint32_t last, uint32_t depth );
+
+    // Builds the subtree of task into nodes. Subtrees smaller than deferBelow are appended to deferred instead
+    void BuildTask( std::vector< Node >& nodes, const Task& task, std::size_t deferBelow, std::vector< Task >* deferred );
+
+    void UpdateBox( uint32_t node );
+public:
+    Bvh();
+
+    // Rebuilds the tree over boxes, by item id. Empty boxes are left out
+    void Build( const std::vector< Box >& boxes );
+
+    // Moves item to box and marks the nodes above it for Refit. Nothing happens if the box didn't change. False if
+    // item wasn't in the last Build. An empty box keeps the item out of the queries
+    bool SetBounds( ItemId item, const Box& box );
+
+    // Recomputes the boxes of the nodes above moved items, bottom up
+    void Refit();
+
+    // Items in the tree, in no particular order
+    const std::vector< ItemId >& GetItems() const { return m_Items; }
+
+    // Item ids the last Build was given boxes for: [0, GetSize())
+    std::size_t GetSize() const { return m_Boxes.size(); }
+
+    bool Contains( ItemId item ) const { return item < m_Leaves.size() && m_Leaves[ item ] != NO_NODE; }
+
+    const Box& GetBounds( ItemId item ) const { return m_Boxes[ item ]; }
+
+    // Summed node areas against those right after the build: 1 for a fresh tree, growing as refits loosen it
+    float GetDegradation() const { return m_BuildArea > 0 ? m_Area / m_BuildArea : 1.0f; }
+
+    // Items from which Build goes parallel. 0 never does
+    void SetParallelThreshold( std::size_t items ) { m_ParallelThreshold = items; }
+
+    // Appends the items whose boxes aren't completely outside frustum. Subtrees inside aren't tested any further
+    void Query( const Frustum& frustum, std::vector< ItemId >& items ) const;
+
+    // Appends the items whose boxes are within radius of center
+    void Query( const Vector& center, float radius, std::vector< ItemId >& items ) const;
+
+    // Nearest item whose box the ray from origin along direction hits within maxDistance, INVALID_ITEM if there is
+    // none. distance is in units of direction
+    ItemId Raycast( const Vector& origin, const Vector& direction, float maxDistance, float& distance ) const;
+
+    std::size_t GetNodeCount() const { return m_Nodes.size(); }
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* BVH_H_ */
@@ -97,7 +97,12 @@ bool Camera::HandleEvent(const SDL_Event& event)
 
             switch (event.button.button)
             {
-            case 1: m_MouseLeftDown   = true; break;
+            case 1:
+                m_MouseLeftDown = true;
+                if ( m_PickHandler ) {
+                    m_PickHandler( event.button.x, event.button.y );
+                }
+                break;
             case 2: m_MouseMiddleDown = true; break;
             case 3: m_MouseRightDown  = true; break;
             default: break;
@@ -135,13 +140,35 @@ bool Camera::HandleEvent(const SDL_Event& event)
     return processed;
 }
 
-void Camera::Render( long ticks )
+void Camera::GetDrawInfo( DrawInfo& info ) const
+{
+    info.layer = DrawInfo::LAYER_SETUP;
+    // Render translates the world by ( x, -y, -z ) - the eye sits at the inverse
+    info.viewer      = true;
+    info.hasPosition = true;
+    info.position    = { -m_CameraPosition[ Vector::X ], m_CameraPosition[ Vector::Y ], m_CameraPosition[ Vector::Z ] };
+}
+
+bool Camera::UpdateTransform( long ticks, Matrix4& local )
 {
     m_CameraPosition += m_JoyStickMotionAxis;
     m_CameraAngle    += m_JoystickOrientationAxis;
 
-    glLoadIdentity();
-    glRotatef( m_CameraAngle[ Vector::X ], 1.0f, 0.0f, 0.0f );
-    glRotatef( m_CameraAngle[ Vector::Y ], 0.0f, 1.0f, 0.0f );
-    glTranslatef( m_CameraPosition[Vector::X], -m_CameraPosition[Vector::Y], -m_CameraPosition[Vector::Z] );
+    // rotate around x, then y, then move the world
+    Quaternion rotation = Quaternion::FromEuler( { m_CameraAngle[ Vector::X ], m_CameraAngle[ Vector::Y ], 0 } );
+    Matrix4 view = Matrix4::Rotation( rotation ) *
+            Matrix4::Translation( { m_CameraPosition[Vector::X], -m_CameraPosition[Vector::Y], -m_CameraPosition[Vector::Z] } );
+    // the renderer takes the view back from where the camera sits
+    if ( !view.Inverse( local ) ) {
+        local.SetIdentity();
+    }
+    return true;
+}
+
+void Camera::Render( long ticks )
+{
+    // where the camera sits might depend on a parent entity
+    Matrix4 view;
+    GetWorld().Inverse( view );
+    glLoadMatrixf( view );
 }
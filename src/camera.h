@@ -12,8 +12,14 @@
 #include "entity.h"
 #include "vector.h"
 
+#include <boost/function.hpp>
+
 class Camera : public Entity
 {
+public:
+    // Left clicks, in window coordinates
+    typedef boost::function< void( int x, int y ) > PickHandler;
+private:
     bool   m_MouseLeftDown;
     bool   m_MouseMiddleDown;
     bool   m_MouseRightDown;
@@ -26,16 +32,23 @@ class Camera : public Entity
     Vector m_JoyStickMotionAxis;
     Vector m_JoystickOrientationAxis;
     SDL_Joystick *m_Joystick;
+    PickHandler   m_PickHandler;
 public:
     Camera( SDL_Joystick* joystick );
 
     virtual ~Camera();
 
+    void SetPickHandler( const PickHandler& handler ) { m_PickHandler = handler; }
+
 private:
     virtual bool HandleEvent( const SDL_Event& event ); // -> ?? override; not working
 
     virtual bool Initialize( );
 
+    virtual void GetDrawInfo( DrawInfo& info ) const;
+
+    virtual bool UpdateTransform( long ticks, Matrix4& local );
+
     virtual void Render( long ticks );
 
     float GetJoystickAxisValue( int index );
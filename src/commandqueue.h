@@ -0,0 +1,122 @@
+/*
+ * commandqueue.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef COMMANDQUEUE_H_
+#define COMMANDQUEUE_H_
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue: any number of producers, one consumer. Every cell carries a sequence number telling
+// whose turn it is (D. Vyukov's bounded MPMC queue, with the consumer side reduced to a single thread).
+// Producers only contend on one atomic increment, the consumer never blocks.
+template< typename T >
+class CommandQueue : boost::noncopyable
+{
+    enum { CACHE_LINE = 64 };
+
+    struct Cell
+    {
+        std::atomic< std::size_t > sequence;
+        T                          value;
+    };
+
+    boost::scoped_array< Cell > m_Cells;
+    const std::size_t m_Mask;
+
+    // producers and consumer write on different cache lines
+    char m_Pad0[ CACHE_LINE ];
+    std::atomic< std::size_t > m_Tail;  // next cell to push to
+    char m_Pad1[ CACHE_LINE ];
+    std::size_t m_Head;                 // next cell to pop from. Consumer only
+    char m_Pad2[ CACHE_LINE ];
+public:
+    // capacity must be a power of two
+    explicit CommandQueue( std::size_t capacity )
+        : m_Cells( new Cell[ capacity ] )
+        , m_Mask( capacity - 1 )
+        , m_Tail( 0 )
+        , m_Head( 0 )
+    {
+        BOOST_ASSERT( capacity >= 2 && ( capacity & m_Mask ) == 0 );
+        for ( std::size_t i = 0; i < capacity; ++i ) {
+            m_Cells[i].sequence.store( i, std::memory_order_relaxed );
+        }
+    }
+
+    std::size_t GetCapacity() const { return m_Mask + 1; }
+
+    // Any thread. Returns false if the queue is full
+    bool TryPush( const T& value )
+    {
+        std::size_t pos = m_Tail.load( std::memory_order_relaxed );
+        Cell* cell;
+        for (;;) {
+            cell = &m_Cells[ pos & m_Mask ];
+            std::size_t seq = cell->sequence.load( std::memory_order_acquire );
+            std::ptrdiff_t diff = std::ptrdiff_t( seq ) - std::ptrdiff_t( pos );
+            if ( diff == 0 ) {
+                // cell is free - claim it
+                if ( m_Tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+                    break;
+                }
+            } else if ( diff < 0 ) {
+                // the consumer hasn't released this cell from the last round yet
+                return false;
+            } else {
+                // another producer was faster
+                pos = m_Tail.load( std::memory_order_relaxed );
+            }
+        }
+        cell->value = value;
+        cell->sequence.store( pos + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Any thread. Yields until there is room - the consumer drains once per frame
+    void Push( const T& value )
+    {
+        while ( !TryPush( value ) ) {
+            boost::this_thread::yield();
+        }
+    }
+
+    // Consumer thread only. Returns false if the queue is empty
+    bool TryPop( T& value )
+    {
+        Cell& cell = m_Cells[ m_Head & m_Mask ];
+        if ( cell.sequence.load( std::memory_order_acquire ) != m_Head + 1 ) {
+            return false;
+        }
+        value = cell.value;
+        // drop the references now, not when the cell is reused
+        cell.value = T();
+        cell.sequence.store( m_Head + m_Mask + 1, std::memory_order_release );
+        ++m_Head;
+        return true;
+    }
+
+    // Consumer thread only. Pops at most one queue full - producers can't keep the consumer busy forever.
+    // Returns the number of commands handled
+    template< typename Fn >
+    std::size_t Drain( Fn fn )
+    {
+        std::size_t count(0);
+        T value;
+        while ( count <= m_Mask && TryPop( value ) ) {
+            fn( value );
+            ++count;
+        }
+        return count;
+    }
+};
+
+#endif /* COMMANDQUEUE_H_ */
@@ -7,6 +7,9 @@
  */
 
 #include "cube.h"
+#include "glstate.h"
+
+#include <vector>
 
 // cube ///////////////////////////////////////////////////////////////////////
 //    v6----- v5
@@ -82,6 +85,7 @@ GLfloat colors[]    = { 1, 1, 1,   1, 1, 0,   1, 0, 0,      // v0-v1-v2 (front)
 
 Cube::Cube()
     : m_VboID(0)
+    , m_Block(BufferArena::INVALID_BLOCK)
     , m_Position( { -5, -1, 0 } )
     , m_Scale( { 1,1,1 } )
     , m_Rotation( { 0,0,0,0 } )
@@ -90,7 +94,23 @@ Cube::Cube()
 
 Cube::~Cube()
 {
-    glDeleteBuffersARB(1, &m_VboID);
+    if ( m_VboID > 0 ) {
+        GLStateCache::DeleteBuffers(1, &m_VboID);
+    }
+    BufferArena* arena = BufferArena::GetCurrent();
+    if ( arena && m_Block != BufferArena::INVALID_BLOCK ) {
+        arena->Free( m_Block );
+    }
+}
+
+GLuint Cube::GetBufferId() const
+{
+    return m_Block != BufferArena::INVALID_BLOCK ? BufferArena::GetCurrent()->GetBuffer( m_Block ) : m_VboID;
+}
+
+GLintptr Cube::GetOffset() const
+{
+    return m_Block != BufferArena::INVALID_BLOCK ? BufferArena::GetCurrent()->GetOffset( m_Block ) : 0;
 }
 
 bool Cube::HandleEvent(const SDL_Event& event)
@@ -98,13 +118,37 @@ bool Cube::HandleEvent(const SDL_Event& event)
 	return false;
 }
 
+std::size_t Cube::GetUploadSize() const
+{
+    return sizeof(vertices)+sizeof(normals)+sizeof(colors);
+}
+
+void Cube::GetDrawInfo( DrawInfo& info ) const
+{
+    // state 0: planar float arrays, glDrawArrays
+    info.buffer      = GetBufferId();
+    info.hasPosition = true;
+    info.position    = m_Position;
+}
+
 bool Cube::Initialize()
 {
     bool m_HasVBO  = glewGetExtension("GL_ARB_vertex_buffer_object");
     ASSERT( m_HasVBO, "VBOs not supported!" );
 
+    BufferArena* arena = BufferArena::GetCurrent();
+    if ( arena && arena->IsEnabled() ) {
+        // one block, the arrays back to back like in the buffer below
+        std::vector< GLfloat > arrays( vertices, vertices + sizeof(vertices)/sizeof(GLfloat) );
+        arrays.insert( arrays.end(), normals, normals + sizeof(normals)/sizeof(GLfloat) );
+        arrays.insert( arrays.end(), colors, colors + sizeof(colors)/sizeof(GLfloat) );
+        m_Block = arena->Allocate( BufferArena::VERTICES, sizeof(GLfloat), arrays.size()*sizeof(GLfloat) );
+        arena->Upload( m_Block, arrays.size()*sizeof(GLfloat), &arrays[0] );
+        return true;
+    }
+
     glGenBuffers(1, &m_VboID);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VboID);
+    GLStateCache::GetCurrent().BindBuffer(GLStateCache::BUFFER_ARRAY, m_VboID);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices)+sizeof(normals)+sizeof(colors), 0, GL_STATIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);                             // copy vertices starting from 0 offest
     glBufferSubData(GL_ARRAY_BUFFER, sizeof(vertices), sizeof(normals), normals);                // copy normals after vertices
@@ -113,57 +157,41 @@ bool Cube::Initialize()
     return true;
 }
 
-void Cube::Render(long ticks)
+bool Cube::UpdateTransform( long ticks, Matrix4& local )
 {
-    int normalArrayEnabled(0);
-    int colorArrayEnabled(0);
-    int vertexArrayEnabled(0);
-
-    // save the initial ModelView matrix before modifying ModelView matrix
-    glPushMatrix();
-
     m_Rotation[ Vector::X ] -= 45.0f * float(ticks) / 1000.0f;
     m_Rotation[ Vector::Y ] += 45.0f * float(ticks) / 1000.0f;
 
-    glTranslatef( m_Position[Vector::X], m_Position[Vector::Y], m_Position[Vector::Z] );
-    glScalef( m_Scale[Vector::X], m_Scale[Vector::Y], m_Scale[Vector::Z] );
-    glRotatef( m_Rotation[ Vector::X ], 1, 0, 0);
-    glRotatef( m_Rotation[ Vector::Y ], 0, 1, 0);
-    glRotatef( m_Rotation[ Vector::Z ], 0, 0, 1);
+    local = Matrix4::Compose( m_Position, Quaternion::FromEuler( m_Rotation ), m_Scale );
+    return true;
+}
+
+bool Cube::GetBounds( Bounds& bounds ) const
+{
+    // the vertex array spans -1..1 on every axis
+    static const Bounds sBounds = Bounds::FromBox( Vector( -1, -1, -1 ), Vector( 1, 1, 1 ) );
+    bounds = sBounds;
+    return true;
+}
+
+void Cube::Render(long ticks)
+{
+    glLoadMatrixf( GetModelView() );
 
     // enable vertex arrays
-    glGetIntegerv( GL_NORMAL_ARRAY, &normalArrayEnabled );
-    if ( !normalArrayEnabled )  {
-        glEnableClientState(GL_NORMAL_ARRAY);
-    }
-    glGetIntegerv( GL_COLOR_ARRAY, &colorArrayEnabled );
-    if ( !colorArrayEnabled) {
-        glEnableClientState(GL_COLOR_ARRAY);
-    }
-    glGetIntegerv( GL_VERTEX_ARRAY, &vertexArrayEnabled );
-    if (!vertexArrayEnabled) {
-        glEnableClientState(GL_VERTEX_ARRAY);
-    }
+    GLStateCache& state = GLStateCache::GetCurrent();
+    state.EnableClientState( GLStateCache::ARRAY_VERTEX );
+    state.EnableClientState( GLStateCache::ARRAY_NORMAL );
+    state.EnableClientState( GLStateCache::ARRAY_COLOR );
+    state.Disable( GLStateCache::CAP_NORMALIZE );
 
     // Render with VBO - if available
-    glBindBuffer(GL_ARRAY_BUFFER, m_VboID);
+    state.BindBuffer(GLStateCache::BUFFER_ARRAY, GetBufferId());
     // before draw, specify vertex and index arrays with their offsets
-    glNormalPointer(GL_FLOAT, 0, (void*)sizeof(vertices));
-    glColorPointer(3, GL_FLOAT, 0, (void*)(sizeof(vertices)+sizeof(normals)));
-    glVertexPointer(3, GL_FLOAT, 0, 0);
+    const GLintptr offset = GetOffset();
+    state.NormalPointer(GL_FLOAT, 0, (void*)(offset+sizeof(vertices)));
+    state.ColorPointer(3, GL_FLOAT, 0, (void*)(offset+sizeof(vertices)+sizeof(normals)));
+    state.VertexPointer(3, GL_FLOAT, 0, (void*)offset);
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if (!vertexArrayEnabled)  {
-        glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
-    }
-    if (!colorArrayEnabled)   {
-        glDisableClientState(GL_COLOR_ARRAY);
-    }
-    if (!normalArrayEnabled) {
-        glDisableClientState(GL_NORMAL_ARRAY);
-    }
-    glPopMatrix();
 }
@@ -11,12 +11,19 @@
 #include "err.h"
 #include "entity.h"
 #include "vector.h"
+#include "bufferarena.h"
 
 #include <GL/glew.h>
 
 class Cube : public Entity
 {
-	GLuint m_VboID;
+	GLuint m_VboID;                 // own buffer - 0 if the arrays live in the arena
+	BufferArena::BlockId m_Block;   // vertices, normals and colors back to back
+
+	GLuint GetBufferId() const;
+
+	// Start of the arrays in the buffer
+	GLintptr GetOffset() const;
 
     Vector m_Position;
     Vector m_Scale;
@@ -26,10 +33,18 @@ public:
 
 	virtual ~Cube();
 private:
+	virtual std::size_t GetUploadSize() const;
+
+	virtual void GetDrawInfo( DrawInfo& info ) const;
+
 	virtual bool Initialize();
 
 	virtual bool HandleEvent( const SDL_Event& event );
 
+	virtual bool UpdateTransform( long ticks, Matrix4& local );
+
+	virtual bool GetBounds( Bounds& bounds ) const;
+
 	virtual void Render( long ticks );
 
 };
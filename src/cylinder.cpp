@@ -1,35 +1,43 @@
 #include "cylinder.h"
+#include "batch.h"
+#include "instancer.h"
 
 #include <GL/glew.h>
 
 #include <cmath>
+#include <cstring>
 
+#include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 
-const int _columns = 32;
 const int _rows    = 2;
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-Cylinder::Cylinder( )
-    : m_Buffers( { -1 } )
-    , m_Stride(1) // needed if/when we pack color + vertex into one array
+Cylinder::Cylinder( MeshBuilder::Topology topology /*= MeshBuilder::TRIANGLES*/, int columns /*= DEFAULT_COLUMNS*/,
+                    int levels /*= 1*/ )
+    : m_Topology(topology)
     , m_Radius(1.0f)
+    , m_Columns(columns)
     , m_Position( {  +5, 1, 0 } )
     , m_Scale( { 1,1,1 } )
     , m_Rotation( { 0,0,0,0 } )
 {
+    // the sides are flat - only the columns change between levels
+    BOOST_ASSERT( levels > 0 && ( columns >> ( levels - 1 ) ) >= 3 );
+    for ( int level = levels - 1; level >= 0; --level ) {
+        int levelColumns = columns >> level;
+        m_Lod.AddLevel( MakeShapeKey( "cylinder", { m_Radius, float(levelColumns), float(_rows), float(topology) } ), levelColumns );
+    }
 }
 
 Cylinder::~Cylinder()
 {
-    // shouldn't be done in d'tor...might be weakly linked to e.g. event handler...but vbo must be released from render thread
-    glDeleteBuffers( MAX_BUFFERS, (GLuint*)m_Buffers);
 }
 
-void Cylinder::MakeCylinder( float columns, float rows )
+void Cylinder::MakeGeometry( MeshBuilder& geometry, float radius, float columns, float rows )
 {
     std::vector< std::vector< Vector > > rings;
 
@@ -39,18 +47,22 @@ void Cylinder::MakeCylinder( float columns, float rows )
     int lastRow = rows;
     ++rows; // one extra row to top off the poly
 
-    // Add two extra vertices at center bottom and top
-    m_VertexBuffer.resize( columns*rows*m_Stride + 2 );
-    m_NormalBuffer.resize( columns*rows*m_Stride + 2 );
-    m_ColorBuffer.resize( columns*rows*m_Stride + 2 );
+    // Add two extra vertices at center bottom and top. Planar scratch buffers - interleaved into geometry at the end
+    VectorArray vertexBuffer( columns*rows + 2 );
+    VectorArray normalBuffer( columns*rows + 2 );
+    VectorArray colorBuffer( columns*rows + 2 );
 
     // generate index array; we got rows * columns * 2 tris
-    m_IndexArray.resize( columns * rows * 3 * 2 + columns*3*2 ); // 3 vertices per tri, 2 tri per quad = 6 entries per iteration
+    const bool strips = geometry.GetTopology() == MeshBuilder::TRIANGLE_STRIP;
+    IndexArray& indexArray = geometry.GetIndices();
+    if ( !strips ) {
+        indexArray.resize( columns * rows * 3 * 2 + columns*3*2 ); // 3 vertices per tri, 2 tri per quad = 6 entries per iteration
+    }
 
     const float height = 6;
-    auto vit = m_VertexBuffer.begin();
-    auto nit = m_NormalBuffer.begin();
-    auto cit = m_ColorBuffer.begin();
+    auto vit = vertexBuffer.begin();
+    auto nit = normalBuffer.begin();
+    auto cit = colorBuffer.begin();
     int looper(0);
 
     // need one extra ring to close the gap (overlaps 0)
@@ -63,32 +75,32 @@ void Cylinder::MakeCylinder( float columns, float rows )
             // vertex
             auto& vertex = *vit; ++vit;
             // Cylinder
-            vertex[ Vector::X ] = std::cos(phi) * m_Radius; //std::cos(theta) * std::sin(phi);
+            vertex[ Vector::X ] = std::cos(phi) * radius; //std::cos(theta) * std::sin(phi);
             vertex[ Vector::Y ] = vpy; // std::sin(theta) * std::cos(phi);
-            vertex[ Vector::Z ] = std::sin(phi) * m_Radius; // std::cos(phi);
+            vertex[ Vector::Z ] = std::sin(phi) * radius; // std::cos(phi);
 
-            // Add normal vectors - at vertex direction from center (at y pos)
+            // Add normal vectors - at vertex direction from center (at y pos). Normalized in bulk below
             auto& normal = *nit; ++nit;
-            normal = Vector( vertex ).Sub( {  0, vpy, 0  } ).Normalize();
+            normal = { vertex[ Vector::X ], 0, vertex[ Vector::Z ], 0 };
 
             // vertex color
             auto& color = *cit; ++cit;
             color = { 1.0f - y/rows, 1.0f, y/rows, 1.0f };
 
             // skip last column/row - already indexed
-            if ( y < lastRow ) {
+            if ( y < lastRow && !strips ) {
                 // vertices don't need to be set just yet. We just index them here
 
                 // top tri
                 int
-                idx = int((int(x + 0) % lastColumn) + columns*y);     m_IndexArray[ looper++ ] = idx;  // 0x0
-                idx = int((int(x + 1) % lastColumn) + columns*y);     m_IndexArray[ looper++ ] = idx;  // 1x0
-                idx = int((int(x + 0) % lastColumn) + columns*(y+1)); m_IndexArray[ looper++ ] = idx;  // 1x1 - bottom row
+                idx = int((int(x + 0) % lastColumn) + columns*y);     indexArray[ looper++ ] = idx;  // 0x0
+                idx = int((int(x + 1) % lastColumn) + columns*y);     indexArray[ looper++ ] = idx;  // 1x0
+                idx = int((int(x + 0) % lastColumn) + columns*(y+1)); indexArray[ looper++ ] = idx;  // 1x1 - bottom row
 
                 // bottom tri
-                idx = int((int(x + 1) % lastColumn) + columns*y);     m_IndexArray[ looper++ ] = idx; // 0x0
-                idx = int((int(x + 1) % lastColumn) + columns*(y+1)); m_IndexArray[ looper++ ] = idx; // 0x1 - bottom row
-                idx = int((int(x + 0) % lastColumn) + columns*(y+1)); m_IndexArray[ looper++ ] = idx; // 1x1 - bottom row
+                idx = int((int(x + 1) % lastColumn) + columns*y);     indexArray[ looper++ ] = idx; // 0x0
+                idx = int((int(x + 1) % lastColumn) + columns*(y+1)); indexArray[ looper++ ] = idx; // 0x1 - bottom row
+                idx = int((int(x + 0) % lastColumn) + columns*(y+1)); indexArray[ looper++ ] = idx; // 1x1 - bottom row
                 idx = 0;
             }
         }
@@ -101,14 +113,39 @@ void Cylinder::MakeCylinder( float columns, float rows )
     nb = { 0, -1, 0 };         // point down
     auto& cb = *cit; ++cit;
     cb = { 1.0f, 1.0f, 0.0f, 1.0f };
-    int bottomIdx = columns * rows * m_Stride;
+    int bottomIdx = columns * rows;
+    int topIdx = bottomIdx+1;
+    if ( strips ) {
+        // sides: one strip per row, 2 indices per quad
+        for( int y = 0; y < lastRow; ++y ) {
+            for( int x = 0; x <= columns; ++x ) {
+                indexArray.push_back( int(x % lastColumn + columns*(y+1)) );  // 0x1 - bottom row
+                indexArray.push_back( int(x % lastColumn + columns*y) );      // 0x0
+            }
+            geometry.EndStrip();
+        }
+        // caps: zig-zag between ring and center. The leading duplicate keeps the winding of the triangle version
+        indexArray.push_back( 0 );
+        for( int x = 0; x <= columns; ++x ) {
+            indexArray.push_back( x % lastColumn );
+            indexArray.push_back( bottomIdx );
+        }
+        indexArray.pop_back();
+        geometry.EndStrip();
+        indexArray.push_back( int(int(columns) % lastColumn + columns*lastRow) );
+        for( int x = columns; x >= 0; --x ) {
+            indexArray.push_back( int(x % lastColumn + columns*lastRow) );
+            indexArray.push_back( topIdx );
+        }
+        indexArray.pop_back();
+    }
     // close top and bottom
-    for( int x = 0; x < columns; ++x ) { //0-2PI
+    for( int x = 0; x < columns && !strips; ++x ) { //0-2PI
         // bottom
         int
-        idx = (x + 0) % lastColumn; m_IndexArray[ looper++ ] = idx;  // 0x0 - readability!
-        idx = (x + 1) % lastColumn; m_IndexArray[ looper++ ] = idx;  // 1x0
-        idx = bottomIdx;            m_IndexArray[ looper++ ] = idx;  // 1x1 - bottom row
+        idx = (x + 0) % lastColumn; indexArray[ looper++ ] = idx;  // 0x0 - readability!
+        idx = (x + 1) % lastColumn; indexArray[ looper++ ] = idx;  // 1x0
+        idx = bottomIdx;            indexArray[ looper++ ] = idx;  // 1x1 - bottom row
     }
     auto& vt = *vit; ++vit;
     vt = { 0, height/2, 0 };   // top - center
@@ -116,112 +153,68 @@ void Cylinder::MakeCylinder( float columns, float rows )
     nt = { 0, +1, 0 };       // point up
     auto& ct = *cit; ++cit;
     ct = { 0.0f, 1.0f, 1.0f, 1.0f };
-    int topIdx = bottomIdx+1;
-    for( int x = 0; x < columns; ++x ) { //0-2PI
+    for( int x = 0; x < columns && !strips; ++x ) { //0-2PI
         int
-        idx = (x + 1) % lastColumn + columns*lastRow; m_IndexArray[ looper++ ] = idx;  // 1x0
-        idx = (x + 0) % lastColumn + columns*lastRow; m_IndexArray[ looper++ ] = idx;  // 0x0 - readability!
-        idx = topIdx;               m_IndexArray[ looper++ ] = idx;  // 1x1 - bottom row
+        idx = (x + 1) % lastColumn + columns*lastRow; indexArray[ looper++ ] = idx;  // 1x0
+        idx = (x + 0) % lastColumn + columns*lastRow; indexArray[ looper++ ] = idx;  // 0x0 - readability!
+        idx = topIdx;               indexArray[ looper++ ] = idx;  // 1x1 - bottom row
     }
+    // center normals are unit length already, normalizing them is a no-op
+    batch::Normalize( normalBuffer );
+
+    geometry.Interleave( vertexBuffer, normalBuffer, colorBuffer );
 }
 
-bool Cylinder::Initialize()
+bool Cylinder::Prepare()
 {
-    bool hasVBO  = glewGetExtension("GL_ARB_vertex_buffer_object");
-    ASSERT( hasVBO, "VBOs not supported!" );
-
-    // we might just want to create this in DoInitialize - and throw away the data we don't need locally
-    MakeCylinder( _columns, _rows );
-
-    glGenBuffers( MAX_BUFFERS, (GLuint*)m_Buffers);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[ VERTEX_BUFFER ]);
-    int bufSize = sizeof(Vector)*m_VertexBuffer.size()
-                + sizeof(Vector)*m_NormalBuffer.size()
-                + sizeof(Vector)*m_ColorBuffer.size();
-    glBufferData(GL_ARRAY_BUFFER, bufSize, 0, GL_STATIC_DRAW);
-    std::size_t offset(0);
-    // Vertex buffer
-    float *vertices = (float*)&m_VertexBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_VertexBuffer.size(), vertices);
-    // Normal buffer
-    offset += sizeof(Vector)*m_VertexBuffer.size();
-    float *normals = (float*)&m_NormalBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_NormalBuffer.size(), normals);
-    // Color buffer
-    offset += sizeof(Vector)*m_NormalBuffer.size();
-    float *colors = (float*)&m_ColorBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_ColorBuffer.size(), colors);
-
-    // Index Buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[ INDEX_BUFFER ]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*m_IndexArray.size(), &m_IndexArray[0], GL_STATIC_DRAW);
-
-    // TODO: We can delete local storage here
+    int finest = int( m_Lod.GetLevelCount() ) - 1;
+    m_Lod.Prepare( m_Topology, [this, finest]( MeshBuilder& geometry, std::size_t level ) {
+        MakeGeometry( geometry, m_Radius, m_Columns >> ( finest - int( level ) ), _rows );
+        geometry.Optimize();
+    } );
+    return true;
+}
 
+bool Cylinder::Initialize()
+{
+    // first cylinder of its kind uploads, the local copy is dropped right after
+    m_Lod.Upload();
     return true;
 }
 
-void Cylinder::Render( long ticks )
+void Cylinder::GetDrawInfo( DrawInfo& info ) const
 {
-    // save the initial ModelView matrix before modifying ModelView matrix
-    glPushMatrix();
+    info.state       = m_Lod.GetMesh().GetStateId();
+    info.buffer      = m_Lod.GetMesh().GetBufferId();
+    info.hasPosition = true;
+    info.position    = m_Position;
+}
 
+bool Cylinder::UpdateTransform( long ticks, Matrix4& local )
+{
     m_Rotation[ Vector::X ] += 25.0f * float(ticks) / 1000.0f;
 
-    glTranslatef( m_Position[Vector::X], m_Position[Vector::Y], m_Position[Vector::Z] );
-    glScalef( m_Scale[Vector::X], m_Scale[Vector::Y], m_Scale[Vector::Z] );
-    glRotatef( m_Rotation[ Vector::X ], 1, 0, 0);
-    glRotatef( m_Rotation[ Vector::Y ], 0, 1, 0);
-    glRotatef( m_Rotation[ Vector::Z ], 0, 0, 1);
-
-    int vertexArrayEnabled;
-    glGetIntegerv( GL_VERTEX_ARRAY, &vertexArrayEnabled );
-    if (!vertexArrayEnabled) {
-        glEnableClientState(GL_VERTEX_ARRAY);
-    }
-    int normalArrayEnabled;
-    glGetIntegerv( GL_NORMAL_ARRAY, &normalArrayEnabled );
-    if ( !normalArrayEnabled )  {
-        glEnableClientState(GL_NORMAL_ARRAY);
-    }
-    int colorArrayEnabled;
-    glGetIntegerv( GL_COLOR_ARRAY, &colorArrayEnabled );
-    if ( !colorArrayEnabled) {
-        glEnableClientState(GL_COLOR_ARRAY);
-    }
-
-    int blend_enabled;
-    glGetIntegerv(GL_BLEND, &blend_enabled);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[ VERTEX_BUFFER ]);
-    // before draw, specify vertex and index arrays with their offsets
-    std::size_t offset(0);
-    glVertexPointer(4, GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
-
-    offset += sizeof(Vector)*m_VertexBuffer.size();
-    glNormalPointer(GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
-
-    offset += sizeof(Vector)*m_NormalBuffer.size();
-    glColorPointer(4, GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
+    local = Matrix4::Compose( m_Position, Quaternion::FromEuler( m_Rotation ), m_Scale );
+    return true;
+}
 
-    // use index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[ INDEX_BUFFER ]);
-    glDrawElements( GL_TRIANGLES, m_IndexArray.size(), GL_UNSIGNED_INT, (void*)0 );
+bool Cylinder::GetBounds( Bounds& bounds ) const
+{
+    // computed when the shared mesh was generated
+    bounds = m_Lod.GetBounds();
+    return true;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void Cylinder::Render( long ticks )
+{
+    m_Lod.GetMesh().Draw( GetModelView() );
+}
 
-    if (!vertexArrayEnabled)  {
-        glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
-    }
-    if ( !normalArrayEnabled )  {
-        glDisableClientState(GL_NORMAL_ARRAY);
-    }
-    if ( !colorArrayEnabled) {
-        glDisableClientState(GL_COLOR_ARRAY);
-    }
 
-    glPopMatrix();
+bool Cylinder::RenderInstanced( long ticks, Instancer& instancer )
+{
+    InstanceData instance = { {}, { 1, 1, 1, 1 } };
+    std::memcpy( instance.transform, (const float*)GetWorld(), sizeof( instance.transform ) );
+    instancer.Add( m_Lod.GetKey(), m_Lod.GetMesh(), instance );
+    return true;
 }
-
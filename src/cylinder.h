@@ -4,6 +4,7 @@
 #include "err.h"
 #include "entity.h"
 #include "vector.h"
+#include "lod.h"
 
 #include <vector>
 
@@ -11,42 +12,45 @@ class Cylinder : public Entity
 {
 public:
     enum {
-        VERTEX_BUFFER = 0,
-        INDEX_BUFFER,
-
-        MAX_BUFFERS
+        DEFAULT_COLUMNS = 32
     };
-
 private:
-    int m_Buffers[ MAX_BUFFERS ];
-
-    typedef std::vector<Vector> VertexArray;
-    typedef std::vector<Vector> ColorArray;
-    typedef std::vector<unsigned int> IndexArray;
-
-    int         m_Stride;
-    VertexArray m_VertexBuffer; // linear buffer
-    VertexArray m_NormalBuffer; // linear buffer
-    ColorArray  m_ColorBuffer;  // color buffer overlays Vertex Array
-    IndexArray  m_IndexArray;   // standard array to map vertices to tris
+    LodChain    m_Lod;          // meshes shared with all cylinders of the same topology and tessellation
+    MeshBuilder::Topology m_Topology;
 
     float       m_Radius;
+    int         m_Columns;      // of the finest level
     Vector      m_Position;
     Vector      m_Scale;
     Vector      m_Rotation;
 public:
-    Cylinder();
+    // levels: detail levels, each with half the columns of the next finer one, down from columns
+    Cylinder( MeshBuilder::Topology topology = MeshBuilder::TRIANGLES, int columns = DEFAULT_COLUMNS, int levels = 1 );
 
     virtual ~Cylinder();
 
-private:
-    void MakeCylinder( float meridians, float parallels );
+    // Generates the cylinder into geometry, using geometry's topology. Thread safe - no GL involved
+    static void MakeGeometry( MeshBuilder& geometry, float radius, float meridians, float parallels );
 
 protected:
+    virtual bool Prepare();
+
+    virtual std::size_t GetUploadSize() const { return m_Lod.GetUploadSize(); }
+
+    virtual void GetDrawInfo( DrawInfo& info ) const;
+
     virtual bool Initialize( );
 
+    virtual bool UpdateTransform( long ticks, Matrix4& local );
+
+    virtual bool GetBounds( Bounds& bounds ) const;
+
+    virtual bool SetScreenRadius( float pixels ) { return m_Lod.Select( pixels ); }
+
     virtual void Render( long ticks );
 
+    virtual bool RenderInstanced( long ticks, Instancer& instancer );
+
     virtual bool HandleEvent( const SDL_Event& event ) { return false; }
 
 };
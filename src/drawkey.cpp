@@ -0,0 +1,52 @@
+/*
+ * drawkey.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "drawkey.h"
+
+#include <algorithm>
+
+namespace DrawKey
+{
+
+static const int DEPTH_SHIFT    = 0;
+static const int BUFFER_SHIFT   = DEPTH_SHIFT + DEPTH_BITS;
+static const int STATE_SHIFT    = BUFFER_SHIFT + BUFFER_BITS;
+static const int PRIORITY_SHIFT = STATE_SHIFT + STATE_BITS;
+static const int LAYER_SHIFT    = PRIORITY_SHIFT + PRIORITY_BITS;
+
+static uint64_t mask( int bits )
+{
+    return ( uint64_t(1) << bits ) - 1;
+}
+
+uint64_t Make( DrawInfo::Layer layer, int priority, unsigned state, unsigned buffer, float depth )
+{
+    const int half = 1 << ( PRIORITY_BITS - 1 );
+    uint64_t p = uint64_t( std::min( std::max( priority, -half ), half - 1 ) + half );
+
+    uint64_t d = uint64_t( std::min( std::max( depth, 0.0f ), MAX_DEPTH ) / MAX_DEPTH * mask( DEPTH_BITS ) );
+    if ( layer == DrawInfo::LAYER_TRANSPARENT ) {
+        d = mask( DEPTH_BITS ) - d;
+    }
+
+    return ( uint64_t( layer ) & mask( LAYER_BITS ) ) << LAYER_SHIFT
+         | p << PRIORITY_SHIFT
+         | ( uint64_t( state ) & mask( STATE_BITS ) ) << STATE_SHIFT
+         | ( uint64_t( buffer ) & mask( BUFFER_BITS ) ) << BUFFER_SHIFT
+         | d << DEPTH_SHIFT;
+}
+
+DrawInfo::Layer GetLayer( uint64_t key )
+{
+    return DrawInfo::Layer( key >> LAYER_SHIFT );
+}
+
+int GetPriority( uint64_t key )
+{
+    return int( ( key >> PRIORITY_SHIFT ) & mask( PRIORITY_BITS ) ) - ( 1 << ( PRIORITY_BITS - 1 ) );
+}
+
+}
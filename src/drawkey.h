@@ -0,0 +1,72 @@
+/*
+ * drawkey.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef DRAWKEY_H_
+#define DRAWKEY_H_
+
+#include "vector.h"
+#include "matrix.h"
+
+#include <stdint.h>
+
+// What an entity tells the renderer about its next draw. Asked for every frame (Entity::GetDrawInfo)
+struct DrawInfo
+{
+    enum Layer {
+        LAYER_SETUP = 0,        // viewport, camera - before anything else
+        LAYER_OPAQUE,           // front to back
+        LAYER_TRANSPARENT,      // back to front
+        LAYER_OVERLAY,
+
+        MAX_LAYERS
+    };
+
+    Layer    layer;
+    unsigned state;         // GL state/vertex format the draw needs. Equal states are drawn back to back
+    unsigned buffer;        // VBO id
+    bool     hasPosition;   // position is valid - otherwise depth is 0
+    bool     viewer;        // position is the eye all depths are measured from
+    Vector   position;      // world space. Once the entity has a world matrix the renderer takes its translation instead
+    const Matrix4* projection;  // the projection everything is drawn with (the viewport's). Must outlive the frame
+
+    DrawInfo()
+        : layer( LAYER_OPAQUE )
+        , state(0)
+        , buffer(0)
+        , hasPosition(false)
+        , viewer(false)
+        , projection(nullptr)
+    {}
+};
+
+// 64 bit draw key, ascending order is draw order:
+//
+//   63..62  61..46    45..34  33..16  15..0
+//   layer   priority  state   buffer  depth
+//
+// Priority is clamped to a signed 16 bit range. State and buffer are truncated - equal keys
+// then just don't group perfectly. Depth is inverted for LAYER_TRANSPARENT.
+namespace DrawKey
+{
+    enum {
+        DEPTH_BITS    = 16,
+        BUFFER_BITS   = 18,
+        STATE_BITS    = 12,
+        PRIORITY_BITS = 16,
+        LAYER_BITS    = 2,
+    };
+
+    // Distances beyond this all get the largest depth. Same as the far clip plane in Viewport
+    const float MAX_DEPTH = 1000.0f;
+
+    uint64_t Make( DrawInfo::Layer layer, int priority, unsigned state, unsigned buffer, float depth );
+
+    DrawInfo::Layer GetLayer( uint64_t key );
+
+    int GetPriority( uint64_t key );
+}
+
+#endif /* DRAWKEY_H_ */
@@ -8,12 +8,26 @@
 #ifndef ENTITY_H_
 #define ENTITY_H_
 
+#include "drawkey.h"
+#include "bounds.h"
+#include "matrix.h"
+#include "scenegraph.h"
+
 #include <SDL/SDL_events.h>
 
+class Instancer;
+
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 
+#include <atomic>
 #include <list>
 
+// Index of an entity in the renderer's RenderList (see renderlist.h)
+typedef uint32_t RenderHandle;
+
+const RenderHandle INVALID_RENDER_HANDLE = ~0u;
+
 class Entity
 {
     enum enFLAG_BITS {
@@ -29,10 +43,16 @@ public:
         F_DELETE  = (1<<F_DELETE_B),
     };
 private:
-    uint32_t m_Flags;
+    std::atomic< uint32_t > m_Flags;   // set by the render thread, read by the app
     int      m_OrderNum;
+    RenderHandle m_RenderHandle;    // valid while the entity is in the render list
+    Matrix4  m_World;       // set by the renderer's transform stage
+    bool     m_WorldValid;  // m_World was set by the last transform stage
+    Matrix4  m_ModelView;   // view * m_World
+    SceneGraph::NodeId m_Node;      // valid while the entity is in the render list
+    boost::weak_ptr< Entity > m_ParentEntity;   // Renderer::SetParent. Render thread only
 public:
-    Entity() : m_Flags(F_ENABLE), m_OrderNum(0) {}
+    Entity() : m_Flags(F_ENABLE), m_OrderNum(0), m_RenderHandle(INVALID_RENDER_HANDLE), m_WorldValid(false), m_Node(SceneGraph::INVALID_NODE) {}
 
 	virtual ~Entity() {}
 
@@ -48,15 +68,54 @@ private:
 
     int GetOrder() const { return m_OrderNum; };
 
+    void SetRenderHandle( RenderHandle handle ) { m_RenderHandle = handle; }
+
+    RenderHandle GetRenderHandle() const { return m_RenderHandle; }
+
     void SetFlag( enFLAG flag ) { m_Flags |= flag; }
 
     void ClearFlag( enFLAG flag ) { m_Flags &= ~flag; }
 
 protected:
+    // CPU side preparation (mesh generation, packing...). Runs once on a pool thread before Initialize - no GL calls here!
+    virtual bool Prepare() { return true; }
+
+    // Bytes Initialize would upload if it ran now. Called right after a successful Prepare for the queue statistics,
+    // and on the render thread right before Initialize - the upload scheduler sizes frames with that. Shared data
+    // another entity uploaded in the meantime doesn't count
+    virtual std::size_t GetUploadSize() const { return 0; }
+
+    // Layer, GL state, buffer and position for the draw key. Called on the render thread every frame before sorting
+    virtual void GetDrawInfo( DrawInfo& info ) const {}
+
+    // GL side setup (buffer uploads). Runs on the render thread
     virtual bool Initialize() = 0;
 
+    // Advances the animation by ticks and sets local: model to parent entity (see Renderer::SetParent), model to
+    // world without one. False if the entity has no transform of its own. Called on the render thread every frame
+    // before rendering
+    virtual bool UpdateTransform( long ticks, Matrix4& local ) { return false; }
+
+    // Of this frame. Only valid if UpdateTransform returned true
+    const Matrix4& GetWorld() const { return m_World; }
+
+    // Of this frame - what Render hands to glLoadMatrixf. Only valid if UpdateTransform returned true
+    const Matrix4& GetModelView() const { return m_ModelView; }
+
+    // Model space bounds for frustum culling. False if the entity can't be culled (it always renders). Only asked
+    // for if UpdateTransform returned true
+    virtual bool GetBounds( Bounds& bounds ) const { return false; }
+
+    // Projected radius of the bounds in pixels, every frame the entity is visible. Entities with levels of detail pick
+    // one before they render. True if the level changed
+    virtual bool SetScreenRadius( float pixels ) { return false; }
+
 	virtual void Render( long ticks ) = 0;
 
+	// Like Render, but hands the world matrix to instancer instead of drawing. False if the entity can't be
+	// instanced - Render is called instead
+	virtual bool RenderInstanced( long ticks, Instancer& instancer ) { return false; }
+
 	friend class Renderer;
 };
 
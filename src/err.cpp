@@ -15,6 +15,7 @@
 #include <GL/glew.h>
 
 #include <cctype>
+#include <cstdio>
 #include <cstring>
 
 #include <iostream>
@@ -44,6 +45,10 @@ void ShowWindowsError( const char* msg, unsigned long err, const char* header /*
     }
 #endif
 #ifdef __linux__
+    if ( !gdk_display_get_default() ) {
+        fprintf( stderr, "%s\n%s\nError '%ld': %s\n", header, msg, err, g_strerror (err) );
+        return;
+    }
     GtkWidget *dialog = gtk_message_dialog_new(
     								nullptr,
     								GTK_DIALOG_MODAL,
@@ -62,6 +67,11 @@ void ShowError( const char* msg, const char* header /*= "Error!"*/ )
 	MessageBoxA(HWND_DESKTOP, msg, header, MB_OK);
 #endif
 #ifdef __linux__
+    if ( !gdk_display_get_default() ) {
+        // gtk failed to initialize - no display
+        fprintf( stderr, "%s\n%s\n", header, msg );
+        return;
+    }
     GtkWidget *dialog = gtk_message_dialog_new(
     								nullptr,
     								GTK_DIALOG_MODAL,
@@ -0,0 +1,193 @@
+/*
+ * frustum.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "frustum.h"
+#include "bvh.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+Frustum::Frustum()
+{
+    // everything is inside until Extract
+    for ( int plane = 0; plane < MAX_PLANES; ++plane ) {
+        m_X[ plane ] = m_Y[ plane ] = m_Z[ plane ] = 0;
+        m_D[ plane ] = 1;
+    }
+}
+
+void Frustum::Extract( const Matrix4& m )
+{
+    // Gribb/Hartmann: -w <= x,y,z <= w in clip space, row 3 +/- row 0..2
+    for ( int plane = 0; plane < MAX_PLANES; ++plane ) {
+        int row = plane / 2;
+        float sign = ( plane & 1 ) ? -1.0f : 1.0f;
+        float x = m( 3, 0 ) + sign * m( row, 0 );
+        float y = m( 3, 1 ) + sign * m( row, 1 );
+        float z = m( 3, 2 ) + sign * m( row, 2 );
+        float d = m( 3, 3 ) + sign * m( row, 3 );
+        float length = std::sqrt( x*x + y*y + z*z );
+        float s = length > 0 ? 1/length : 0;
+        m_X[ plane ] = x * s;
+        m_Y[ plane ] = y * s;
+        m_Z[ plane ] = z * s;
+        m_D[ plane ] = d * s;
+    }
+}
+
+bool Frustum::Intersects( const Vector& center, float radius ) const
+{
+    for ( int plane = 0; plane < MAX_PLANES; ++plane ) {
+        if ( GetDistance( Plane( plane ), center ) < -radius ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Frustum::Test Frustum::Classify( const Box& box ) const
+{
+    Test test = INSIDE;
+    for ( int plane = 0; plane < MAX_PLANES; ++plane ) {
+        // the corners farthest along and against the plane normal
+        float outer = m_D[ plane ], inner = m_D[ plane ];
+        const float normal[3] = { m_X[ plane ], m_Y[ plane ], m_Z[ plane ] };
+        for ( int axis = 0; axis < 3; ++axis ) {
+            float n = normal[ axis ];
+            outer += n * ( n > 0 ? box.max[ axis ] : box.min[ axis ] );
+            inner += n * ( n > 0 ? box.min[ axis ] : box.max[ axis ] );
+        }
+        if ( outer < 0 ) {
+            return OUTSIDE;
+        }
+        if ( inner < 0 ) {
+            test = INTERSECTS;
+        }
+    }
+    return test;
+}
+
+void Frustum::Intersects( const float* x, const float* y, const float* z, const float* radius, std::size_t count, char* visible ) const
+{
+    std::size_t i(0);
+#ifdef SIMD_ENABLED
+    simd::float4 nx[ MAX_PLANES ], ny[ MAX_PLANES ], nz[ MAX_PLANES ], nd[ MAX_PLANES ];
+    for ( int plane = 0; plane < MAX_PLANES; ++plane ) {
+        nx[ plane ] = simd::splat( m_X[ plane ] );
+        ny[ plane ] = simd::splat( m_Y[ plane ] );
+        nz[ plane ] = simd::splat( m_Z[ plane ] );
+        nd[ plane ] = simd::splat( m_D[ plane ] );
+    }
+    // the smallest distance + radius over all planes: negative for spheres outside of one of them
+    for ( ; i + 4 <= count; i += 4 ) {
+        simd::float4 px = simd::load( x + i );
+        simd::float4 py = simd::load( y + i );
+        simd::float4 pz = simd::load( z + i );
+        simd::float4 r  = simd::load( radius + i );
+        simd::float4 nearest = simd::add( r, nd[0] );
+        nearest = simd::add( nearest, simd::add( simd::mul( px, nx[0] ), simd::add( simd::mul( py, ny[0] ), simd::mul( pz, nz[0] ) ) ) );
+        for ( int plane = 1; plane < MAX_PLANES; ++plane ) {
+            simd::float4 d = simd::add( r, nd[ plane ] );
+            d = simd::add( d, simd::add( simd::mul( px, nx[ plane ] ), simd::add( simd::mul( py, ny[ plane ] ), simd::mul( pz, nz[ plane ] ) ) ) );
+            nearest = simd::min( nearest, d );
+        }
+        float SIMD_ALIGN(16) result[4];
+        simd::store( result, nearest );
+        visible[ i ]     = result[0] >= 0;
+        visible[ i + 1 ] = result[1] >= 0;
+        visible[ i + 2 ] = result[2] >= 0;
+        visible[ i + 3 ] = result[3] >= 0;
+    }
+#endif
+    for ( ; i < count; ++i ) {
+        visible[i] = Intersects( Vector( x[i], y[i], z[i] ), radius[i] );
+    }
+}
+
+Culler::Culler()
+    : m_Culled(0)
+    , m_Drawn(0)
+    , m_TotalCulled(0)
+    , m_TotalDrawn(0)
+    , m_Frames(0)
+{
+}
+
+void Culler::Begin( const Matrix4& viewProjection )
+{
+    m_Frustum.Extract( viewProjection );
+    m_X.clear();
+    m_Y.clear();
+    m_Z.clear();
+    m_Radius.clear();
+    m_Items.clear();
+}
+
+void Culler::Add( uint32_t item, const Vector& center, float radius )
+{
+    m_X.push_back( center[ Vector::X ] );
+    m_Y.push_back( center[ Vector::Y ] );
+    m_Z.push_back( center[ Vector::Z ] );
+    m_Radius.push_back( radius );
+    m_Items.push_back( item );
+}
+
+void Culler::Cull( std::vector< char >& culled, std::size_t enabled )
+{
+    m_Culled = 0;
+    m_Visible.resize( m_Items.size() );
+    if ( !m_Items.empty() ) {
+        m_Frustum.Intersects( &m_X[0], &m_Y[0], &m_Z[0], &m_Radius[0], m_Items.size(), &m_Visible[0] );
+    }
+    for ( std::size_t i = 0; i < m_Items.size(); ++i ) {
+        if ( !m_Visible[i] ) {
+            culled[ m_Items[i] ] = true;
+            ++m_Culled;
+        }
+    }
+    m_Drawn = enabled - m_Culled;
+    m_TotalCulled += m_Culled;
+    m_TotalDrawn  += m_Drawn;
+    ++m_Frames;
+}
+
+void Culler::Cull( const Bvh& bvh, std::vector< char >& culled, std::size_t enabled )
+{
+    // everything in the tree is out unless the query finds it. Empty boxes are disabled entities, not culled ones
+    std::size_t inTree(0);
+    for ( Bvh::ItemId item : bvh.GetItems() ) {
+        culled[ item ] = true;
+        inTree += !bvh.GetBounds( item ).IsEmpty();
+    }
+    m_Items.clear();
+    bvh.Query( m_Frustum, m_Items );
+    for ( Bvh::ItemId item : m_Items ) {
+        culled[ item ] = false;
+    }
+    m_Culled = inTree - m_Items.size();
+    m_Drawn = enabled - m_Culled;
+    m_TotalCulled += m_Culled;
+    m_TotalDrawn  += m_Drawn;
+    ++m_Frames;
+}
+
+void Culler::Skip( std::size_t enabled )
+{
+    m_Culled = 0;
+    m_Drawn  = enabled;
+    m_TotalDrawn += m_Drawn;
+    ++m_Frames;
+}
+
+void Culler::Report( FILE* out ) const
+{
+    if ( !m_Frames ) {
+        return;
+    }
+    fprintf( out, "Culling: %.1f entities drawn, %.1f culled per frame\n", double( m_TotalDrawn ) / m_Frames,
+            double( m_TotalCulled ) / m_Frames );
+}
@@ -0,0 +1,113 @@
+/*
+ * frustum.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include "matrix.h"
+#include "vector.h"
+#include "bounds.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+// The six planes of a view volume in world space, normals pointing inwards. Kept as SoA so that one plane
+// coefficient is one SIMD splat
+class Frustum
+{
+public:
+    enum Test {
+        OUTSIDE = 0,
+        INTERSECTS,
+        INSIDE,
+    };
+
+    enum Plane {
+        PLANE_LEFT = 0,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        MAX_PLANES
+    };
+private:
+    float m_X[ MAX_PLANES ];
+    float m_Y[ MAX_PLANES ];
+    float m_Z[ MAX_PLANES ];
+    float m_D[ MAX_PLANES ];
+public:
+    Frustum();
+
+    // Planes of projection * view (world to clip space), normalized
+    void Extract( const Matrix4& viewProjection );
+
+    // Signed distance of point to plane. Positive inside
+    float GetDistance( Plane plane, const Vector& point ) const
+    {
+        return m_X[ plane ] * point[ Vector::X ] + m_Y[ plane ] * point[ Vector::Y ] + m_Z[ plane ] * point[ Vector::Z ] + m_D[ plane ];
+    }
+
+    // False if the sphere is completely outside. Conservative: spheres near a corner might pass
+    bool Intersects( const Vector& center, float radius ) const;
+
+    // OUTSIDE if box is completely outside one plane, INSIDE if it is inside all of them. Conservative like above
+    Test Classify( const Box& box ) const;
+
+    // Intersects for count spheres in SoA layout, 4 per iteration. visible[i] is 0 or 1
+    void Intersects( const float* x, const float* y, const float* z, const float* radius, std::size_t count, char* visible ) const;
+};
+
+class Bvh;
+
+// Per frame frustum culling of the render list: entities hand in their world space bounding spheres, Cull tests them
+// all at once. Render thread only
+class Culler : boost::noncopyable
+{
+    Frustum m_Frustum;
+    std::vector< float >    m_X;
+    std::vector< float >    m_Y;
+    std::vector< float >    m_Z;
+    std::vector< float >    m_Radius;
+    std::vector< uint32_t > m_Items;    // render list slot of each sphere
+    std::vector< char >     m_Visible;
+
+    std::size_t m_Culled;       // last frame
+    std::size_t m_Drawn;
+    std::size_t m_TotalCulled;
+    std::size_t m_TotalDrawn;
+    unsigned    m_Frames;
+public:
+    Culler();
+
+    // Starts a frame with the planes of viewProjection
+    void Begin( const Matrix4& viewProjection );
+
+    void Add( uint32_t item, const Vector& center, float radius );
+
+    // Sets culled[item] for every sphere outside the frustum. enabled: entities that would draw without culling
+    void Cull( std::vector< char >& culled, std::size_t enabled );
+
+    // Culls the items of bvh instead of the added spheres: sets culled[item] for every item outside the frustum
+    void Cull( const Bvh& bvh, std::vector< char >& culled, std::size_t enabled );
+
+    // Frames without a frustum draw everything
+    void Skip( std::size_t enabled );
+
+    const Frustum& GetFrustum() const { return m_Frustum; }
+
+    std::size_t GetCulled() const { return m_Culled; }
+
+    std::size_t GetDrawn() const { return m_Drawn; }
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* FRUSTUM_H_ */
@@ -0,0 +1,175 @@
+/*
+ * glstate.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "glstate.h"
+
+#include <boost/assert.hpp>
+
+GLStateCache *GLStateCache::sCurrent = nullptr;
+
+static const GLenum sArrays[ GLStateCache::MAX_ARRAYS ] = {
+    GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY, GL_PRIMITIVE_RESTART_NV
+};
+
+static const GLenum sCapabilities[ GLStateCache::MAX_CAPABILITIES ] = {
+    GL_NORMALIZE, GL_PRIMITIVE_RESTART, GL_BLEND, GL_CULL_FACE
+};
+
+static const GLenum sBuffers[ GLStateCache::MAX_BUFFERS ] = {
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER
+};
+
+GLStateCache::GLStateCache()
+    : m_Issued(0)
+    , m_Skipped(0)
+    , m_Frames(0)
+    , m_TotalIssued(0)
+    , m_TotalSkipped(0)
+{
+    Invalidate();
+}
+
+void GLStateCache::Invalidate()
+{
+    for ( auto& array : m_Arrays ) {
+        array = UNKNOWN;
+    }
+    for ( auto& cap : m_Capabilities ) {
+        cap = UNKNOWN;
+    }
+    for ( auto& buffer : m_Buffers ) {
+        buffer = UNKNOWN;
+    }
+    m_VertexPointer.valid = false;
+    m_NormalPointer.valid = false;
+    m_ColorPointer.valid  = false;
+    m_RestartIndex = UNKNOWN;
+}
+
+void GLStateCache::EnableClientState( Array array, bool enable /*= true*/ )
+{
+    if ( Changed( m_Arrays[ array ] != int( enable ) ) ) {
+        if ( enable ) {
+            glEnableClientState( sArrays[ array ] );
+        } else {
+            glDisableClientState( sArrays[ array ] );
+        }
+        m_Arrays[ array ] = enable;
+    }
+}
+
+void GLStateCache::Enable( Capability cap, bool enable /*= true*/ )
+{
+    if ( Changed( m_Capabilities[ cap ] != int( enable ) ) ) {
+        if ( enable ) {
+            glEnable( sCapabilities[ cap ] );
+        } else {
+            glDisable( sCapabilities[ cap ] );
+        }
+        m_Capabilities[ cap ] = enable;
+    }
+}
+
+void GLStateCache::BindBuffer( Buffer target, GLuint buffer )
+{
+    if ( Changed( m_Buffers[ target ] != GLint64( buffer ) ) ) {
+        glBindBuffer( sBuffers[ target ], buffer );
+        m_Buffers[ target ] = buffer;
+    }
+}
+
+void GLStateCache::DeleteBuffer( GLuint buffer )
+{
+    for ( auto& bound : m_Buffers ) {
+        if ( bound == GLint64( buffer ) ) {
+            bound = 0;
+        }
+    }
+    Pointer* pointers[] = { &m_VertexPointer, &m_NormalPointer, &m_ColorPointer };
+    for ( auto pointer : pointers ) {
+        if ( pointer->valid && pointer->buffer == buffer ) {
+            pointer->valid = false;
+        }
+    }
+}
+
+bool GLStateCache::SetPointer( Pointer& cached, GLint size, GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    // pointers into client memory (buffer 0) can't be compared - the memory behind them might have changed
+    GLint64 buffer = m_Buffers[ BUFFER_ARRAY ];
+    bool same = cached.valid && buffer > 0 && cached.buffer == GLuint( buffer ) && cached.size == size &&
+            cached.type == type && cached.stride == stride && cached.pointer == pointer;
+    if ( !Changed( !same ) ) {
+        return false;
+    }
+    Pointer p = { GLuint( buffer ), size, type, stride, pointer, buffer != UNKNOWN };
+    cached = p;
+    return true;
+}
+
+void GLStateCache::VertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    if ( SetPointer( m_VertexPointer, size, type, stride, pointer ) ) {
+        glVertexPointer( size, type, stride, pointer );
+    }
+}
+
+void GLStateCache::NormalPointer( GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    if ( SetPointer( m_NormalPointer, 3, type, stride, pointer ) ) {
+        glNormalPointer( type, stride, pointer );
+    }
+}
+
+void GLStateCache::ColorPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer )
+{
+    if ( SetPointer( m_ColorPointer, size, type, stride, pointer ) ) {
+        glColorPointer( size, type, stride, pointer );
+    }
+}
+
+void GLStateCache::PrimitiveRestartIndex( GLuint index )
+{
+    if ( Changed( m_RestartIndex != GLint64( index ) ) ) {
+        if ( GLEW_VERSION_3_1 ) {
+            glPrimitiveRestartIndex( index );
+        } else {
+            glPrimitiveRestartIndexNV( index );
+        }
+        m_RestartIndex = index;
+    }
+}
+
+void GLStateCache::EndFrame()
+{
+    ++m_Frames;
+    m_TotalIssued  += m_Issued;
+    m_TotalSkipped += m_Skipped;
+    m_Issued  = 0;
+    m_Skipped = 0;
+}
+
+void GLStateCache::Report( FILE* out ) const
+{
+    double frames = m_Frames > 0 ? double( m_Frames ) : 1.0;
+    fprintf( out, "GL state: %.1f calls issued, %.1f skipped per frame\n", m_TotalIssued / frames, m_TotalSkipped / frames );
+}
+
+GLStateCache& GLStateCache::GetCurrent()
+{
+    BOOST_ASSERT( sCurrent );
+    return *sCurrent;
+}
+
+void GLStateCache::DeleteBuffers( GLsizei n, const GLuint* buffers )
+{
+    glDeleteBuffers( n, buffers );
+    if ( sCurrent ) {
+        for ( GLsizei i = 0; i < n; ++i ) {
+            sCurrent->DeleteBuffer( buffers[i] );
+        }
+    }
+}
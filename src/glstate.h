@@ -0,0 +1,125 @@
+/*
+ * glstate.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef GLSTATE_H_
+#define GLSTATE_H_
+
+#include <GL/glew.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdio>
+
+// Shadow copy of the GL state the entities change while drawing: client arrays, capabilities, buffer bindings and
+// array pointers. Calls that wouldn't change anything are skipped - no glGet round trips to find out.
+// Entities set what they need and don't restore anything. Render thread only.
+class GLStateCache : boost::noncopyable
+{
+public:
+    enum Array {
+        ARRAY_VERTEX = 0,
+        ARRAY_NORMAL,
+        ARRAY_COLOR,
+        ARRAY_PRIMITIVE_RESTART_NV,     // GL_NV_primitive_restart is a client state
+
+        MAX_ARRAYS
+    };
+    enum Capability {
+        CAP_NORMALIZE = 0,
+        CAP_PRIMITIVE_RESTART,
+        CAP_BLEND,
+        CAP_CULL_FACE,
+
+        MAX_CAPABILITIES
+    };
+    enum Buffer {
+        BUFFER_ARRAY = 0,
+        BUFFER_ELEMENT_ARRAY,
+
+        MAX_BUFFERS
+    };
+private:
+    enum { UNKNOWN = -1 };
+
+    struct Pointer
+    {
+        GLuint        buffer;   // pointers are relative to the array buffer bound at the time
+        GLint         size;
+        GLenum        type;
+        GLsizei       stride;
+        const GLvoid *pointer;
+        bool          valid;
+    };
+
+    int     m_Arrays[ MAX_ARRAYS ];         // 0, 1 or UNKNOWN
+    int     m_Capabilities[ MAX_CAPABILITIES ];
+    GLint64 m_Buffers[ MAX_BUFFERS ];       // id or UNKNOWN
+    Pointer m_VertexPointer;
+    Pointer m_NormalPointer;
+    Pointer m_ColorPointer;
+    GLint64 m_RestartIndex;
+
+    // calls per frame
+    unsigned    m_Issued;
+    unsigned    m_Skipped;
+    // totals of the finished frames
+    std::size_t m_Frames;
+    std::size_t m_TotalIssued;
+    std::size_t m_TotalSkipped;
+
+    static GLStateCache *sCurrent;
+
+    bool Changed( bool changed ) { changed ? ++m_Issued : ++m_Skipped; return changed; }
+
+    bool SetPointer( Pointer& cached, GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+public:
+    GLStateCache();
+
+    // Forget everything - the next call of each kind is issued. Call after GL state changed behind our back
+    void Invalidate();
+
+    void EnableClientState( Array array, bool enable = true );
+
+    void DisableClientState( Array array ) { EnableClientState( array, false ); }
+
+    void Enable( Capability cap, bool enable = true );
+
+    void Disable( Capability cap ) { Enable( cap, false ); }
+
+    void BindBuffer( Buffer target, GLuint buffer );
+
+    // Buffer must be deleted through here - GL resets bindings and pointers of deleted buffers to 0
+    void DeleteBuffer( GLuint buffer );
+
+    // Relative to the bound BUFFER_ARRAY, like the gl* calls
+    void VertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+
+    void NormalPointer( GLenum type, GLsizei stride, const GLvoid* pointer );
+
+    void ColorPointer( GLint size, GLenum type, GLsizei stride, const GLvoid* pointer );
+
+    // glPrimitiveRestartIndex (GL 3.1) or glPrimitiveRestartIndexNV
+    void PrimitiveRestartIndex( GLuint index );
+
+    // Starts counting the calls of the next frame
+    void EndFrame();
+
+    unsigned GetIssued() const { return m_Issued; }
+
+    unsigned GetSkipped() const { return m_Skipped; }
+
+    void Report( FILE* out ) const;
+
+    // Cache of the render thread. Render thread only, set from the moment the context is current
+    static GLStateCache& GetCurrent();
+
+    static void SetCurrent( GLStateCache* state ) { sCurrent = state; }
+
+    // glDeleteBuffers that keeps the current cache (if any) in sync
+    static void DeleteBuffers( GLsizei n, const GLuint* buffers );
+};
+
+#endif /* GLSTATE_H_ */
@@ -0,0 +1,61 @@
+/*
+ * indexbuffer.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "indexbuffer.h"
+
+GLenum SelectIndexType( std::size_t numVertices, bool allowByte /*= false*/ )
+{
+    if ( allowByte && numVertices <= IndexTraits< GLubyte >::GetMaxVertices() ) {
+        return GL_UNSIGNED_BYTE;
+    }
+    if ( numVertices <= IndexTraits< GLushort >::GetMaxVertices() ) {
+        return GL_UNSIGNED_SHORT;
+    }
+    return GL_UNSIGNED_INT;
+}
+
+std::size_t GetIndexSize( GLenum type )
+{
+    switch ( type ) {
+    case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+    case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+    default:                return sizeof(GLuint);
+    }
+}
+
+GLuint GetRestartIndex( GLenum type )
+{
+    switch ( type ) {
+    case GL_UNSIGNED_BYTE:  return IndexTraits< GLubyte >::GetRestartIndex();
+    case GL_UNSIGNED_SHORT: return IndexTraits< GLushort >::GetRestartIndex();
+    default:                return IndexTraits< GLuint >::GetRestartIndex();
+    }
+}
+
+void StitchStrips( IndexArray& indices )
+{
+    IndexArray output;
+    output.reserve( indices.size() + indices.size()/4 );
+    bool restart(false);
+    for ( auto index : indices ) {
+        if ( index == RESTART_INDEX ) {
+            restart = !output.empty();
+            continue;
+        }
+        if ( restart ) {
+            // repeat the last vertex of the previous and the first of the next strip. The next strip must start on an
+            // even position, otherwise its winding flips
+            output.push_back( output.back() );
+            if ( output.size() % 2 == 0 ) {
+                output.push_back( index );
+            }
+            output.push_back( index );
+            restart = false;
+        }
+        output.push_back( index );
+    }
+    indices.swap( output );
+}
@@ -0,0 +1,83 @@
+/*
+ * indexbuffer.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef INDEXBUFFER_H_
+#define INDEXBUFFER_H_
+
+#include "vertexformat.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// Index storage templated on width. Meshes generate 32 bit indices (IndexArray) and get narrowed to the
+// smallest type that can address all vertices before upload.
+template< typename T > struct IndexTraits;
+
+template<> struct IndexTraits< GLubyte >
+{
+    static GLenum GetType() { return GL_UNSIGNED_BYTE; }
+    static std::size_t GetMaxVertices() { return 0xff; }    // the highest index is reserved for primitive restart
+    static GLubyte GetRestartIndex() { return 0xff; }
+};
+
+template<> struct IndexTraits< GLushort >
+{
+    static GLenum GetType() { return GL_UNSIGNED_SHORT; }
+    static std::size_t GetMaxVertices() { return 0xffff; }
+    static GLushort GetRestartIndex() { return 0xffff; }
+};
+
+template<> struct IndexTraits< GLuint >
+{
+    static GLenum GetType() { return GL_UNSIGNED_INT; }
+    static std::size_t GetMaxVertices() { return 0xffffffff; }
+    static GLuint GetRestartIndex() { return 0xffffffff; }
+};
+
+template< typename T >
+class IndexStorage
+{
+    std::vector< T > m_Indices;
+public:
+    typedef IndexTraits< T > Traits;
+
+    IndexStorage() {}
+
+    // Caller guarantees every index fits into T (see SelectIndexType). RESTART_INDEX maps to the restart index of T
+    explicit IndexStorage( const IndexArray& indices )
+        : m_Indices( indices.size() )
+    {
+        for ( std::size_t i = 0; i < indices.size(); ++i ) {
+            m_Indices[i] = indices[i] == RESTART_INDEX ? Traits::GetRestartIndex() : T( indices[i] );
+        }
+    }
+
+    std::size_t size() const { return m_Indices.size(); }
+
+    std::size_t GetSizeInBytes() const { return m_Indices.size() * sizeof(T); }
+
+    const T* GetData() const { return m_Indices.empty() ? nullptr : &m_Indices[0]; }
+
+    T& operator[]( std::size_t i ) { return m_Indices[i]; }
+
+    const T& operator[]( std::size_t i ) const { return m_Indices[i]; }
+
+    static GLenum GetType() { return Traits::GetType(); }
+};
+
+// Narrowest index type able to address numVertices vertices. GL_UNSIGNED_BYTE only if allowed -
+// a lot of hardware doesn't support it natively and the driver converts it on every draw.
+GLenum SelectIndexType( std::size_t numVertices, bool allowByte = false );
+
+std::size_t GetIndexSize( GLenum type );
+
+GLuint GetRestartIndex( GLenum type );
+
+// Joins the strips of a RESTART_INDEX separated strip list with degenerate triangles - for GLs without primitive restart
+void StitchStrips( IndexArray& indices );
+
+#endif /* INDEXBUFFER_H_ */
@@ -0,0 +1,348 @@
+/*
+ * instancer.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "instancer.h"
+#include "mesh.h"
+#include "glstate.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// Fixed function GL_LIGHT0 with GL_COLOR_MATERIAL (ambient and diffuse) and the global ambient, per vertex.
+// Normals go through the cofactor of the model matrix - the inverse transpose up to a scale, normalized anyway
+static const char* sVertexShader =
+    "#version 120\n"
+    "attribute mat4 instanceTransform;\n"
+    "attribute vec4 instanceColor;\n"
+    "uniform float decodeScale;\n"
+    "varying vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 position = gl_ModelViewMatrix * ( instanceTransform * vec4( gl_Vertex.xyz * decodeScale, 1.0 ) );\n"
+    "    mat3 model = mat3( instanceTransform );\n"
+    "    mat3 cofactor = mat3( cross( model[1], model[2] ), cross( model[2], model[0] ), cross( model[0], model[1] ) );\n"
+    "    vec3 normal = normalize( gl_NormalMatrix * ( cofactor * gl_Normal ) );\n"
+    "    vec3 light = normalize( gl_LightSource[0].position.xyz - position.xyz * gl_LightSource[0].position.w );\n"
+    "    vec4 base = gl_Color * instanceColor;\n"
+    "    vec4 lit = gl_LightModel.ambient + gl_LightSource[0].ambient + gl_LightSource[0].diffuse * max( dot( normal, light ), 0.0 );\n"
+    "    color = vec4( base.rgb * lit.rgb, base.a );\n"
+    "    gl_Position = gl_ProjectionMatrix * position;\n"
+    "}\n";
+
+static const char* sFragmentShader =
+    "#version 120\n"
+    "varying vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+static GLuint CompileShader( GLenum type, const char* source )
+{
+    GLuint shader = glCreateShader( type );
+    glShaderSource( shader, 1, &source, nullptr );
+    glCompileShader( shader );
+    GLint compiled(0);
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+    if ( !compiled ) {
+        char log[ 512 ] = "";
+        glGetShaderInfoLog( shader, sizeof(log), nullptr, log );
+        fprintf( stderr, "Instancer: shader compile failed: %s\n", log );
+        glDeleteShader( shader );
+        return 0;
+    }
+    return shader;
+}
+
+Instancer::Instancer()
+    : m_Layer(DrawInfo::LAYER_OPAQUE)
+    , m_NextSubmission(0)
+    , m_Enabled(false)
+    , m_Indirect(false)
+    , m_Program(0)
+    , m_InstanceBuffer(0)
+    , m_IndirectBuffer(0)
+    , m_DecodeScaleLocation(-1)
+    , m_DrawCalls(0)
+    , m_InstanceCount(0)
+    , m_Frames(0)
+    , m_TotalDrawCalls(0)
+    , m_TotalInstances(0)
+{
+    m_Shaders[0] = m_Shaders[1] = 0;
+}
+
+Instancer::~Instancer()
+{
+    // GL objects are gone with the context if Release wasn't called
+}
+
+bool Instancer::Init( bool indirect )
+{
+    Release();
+
+    bool divisor = GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+    bool draw    = GLEW_VERSION_3_1 || GLEW_ARB_draw_instanced;
+    if ( !GLEW_VERSION_2_1 || !divisor || !draw ) {
+        return false;
+    }
+    GLint maxAttribs(0);
+    glGetIntegerv( GL_MAX_VERTEX_ATTRIBS, &maxAttribs );
+    if ( maxAttribs <= ATTRIB_COLOR ) {
+        return false;
+    }
+
+    m_Shaders[0] = CompileShader( GL_VERTEX_SHADER, sVertexShader );
+    m_Shaders[1] = CompileShader( GL_FRAGMENT_SHADER, sFragmentShader );
+    if ( !m_Shaders[0] || !m_Shaders[1] ) {
+        Release();
+        return false;
+    }
+    m_Program = glCreateProgram();
+    glAttachShader( m_Program, m_Shaders[0] );
+    glAttachShader( m_Program, m_Shaders[1] );
+    glBindAttribLocation( m_Program, ATTRIB_TRANSFORM, "instanceTransform" );
+    glBindAttribLocation( m_Program, ATTRIB_COLOR, "instanceColor" );
+    glLinkProgram( m_Program );
+    GLint linked(0);
+    glGetProgramiv( m_Program, GL_LINK_STATUS, &linked );
+    if ( !linked ) {
+        char log[ 512 ] = "";
+        glGetProgramInfoLog( m_Program, sizeof(log), nullptr, log );
+        fprintf( stderr, "Instancer: program link failed: %s\n", log );
+        Release();
+        return false;
+    }
+    m_DecodeScaleLocation = glGetUniformLocation( m_Program, "decodeScale" );
+
+    glGenBuffers( 1, &m_InstanceBuffer );
+
+    // the commands pick their instances through the base instance
+    m_Indirect = indirect && ( GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect ) && ( GLEW_VERSION_4_2 || GLEW_ARB_base_instance );
+    if ( m_Indirect ) {
+        glGenBuffers( 1, &m_IndirectBuffer );
+    }
+    m_Enabled = true;
+    return true;
+}
+
+void Instancer::Release()
+{
+    if ( m_InstanceBuffer > 0 ) {
+        GLStateCache::DeleteBuffers( 1, &m_InstanceBuffer );
+        m_InstanceBuffer = 0;
+    }
+    if ( m_IndirectBuffer > 0 ) {
+        GLStateCache::DeleteBuffers( 1, &m_IndirectBuffer );
+        m_IndirectBuffer = 0;
+    }
+    if ( m_Program > 0 ) {
+        glDeleteProgram( m_Program );
+        m_Program = 0;
+    }
+    for ( auto& shader : m_Shaders ) {
+        if ( shader > 0 ) {
+            glDeleteShader( shader );
+            shader = 0;
+        }
+    }
+    m_Groups.clear();
+    m_GroupIndex.clear();
+    m_Submissions.clear();
+    m_NextSubmission = 0;
+    m_Enabled  = false;
+    m_Indirect = false;
+}
+
+void Instancer::Add( uint64_t shape, const Mesh& mesh, const InstanceData& instance )
+{
+    GroupKey key = { shape, mesh.GetStateId(), m_Layer };
+    auto found = m_GroupIndex.find( key );
+    if ( found == m_GroupIndex.end() ) {
+        found = m_GroupIndex.insert( std::make_pair( key, unsigned( m_Groups.size() ) ) ).first;
+        m_Groups.push_back( Group() );
+        m_Groups.back().layer = m_Layer;
+    }
+    Group& group = m_Groups[ found->second ];
+    if ( group.instances.empty() ) {
+        // last frame's mesh might be gone by now
+        group.mesh = &mesh;
+    }
+    group.instances.push_back( instance );
+}
+
+// Same buffers, same GL state and same uniforms - can be one indirect draw
+static bool IsCompatible( const Mesh& a, const Mesh& b )
+{
+    return a.GetStateId() == b.GetStateId() && a.GetBufferId() == b.GetBufferId() &&
+            a.GetIndexBufferId() == b.GetIndexBufferId() && a.GetDecodeScale() == b.GetDecodeScale();
+}
+
+static bool IsBefore( const Mesh& a, const Mesh& b )
+{
+    if ( a.GetStateId() != b.GetStateId() ) {
+        return a.GetStateId() < b.GetStateId();
+    }
+    if ( a.GetBufferId() != b.GetBufferId() ) {
+        return a.GetBufferId() < b.GetBufferId();
+    }
+    if ( a.GetIndexBufferId() != b.GetIndexBufferId() ) {
+        return a.GetIndexBufferId() < b.GetIndexBufferId();
+    }
+    return a.GetDecodeScale() < b.GetDecodeScale();
+}
+
+void Instancer::Build()
+{
+    m_Instances.clear();
+    m_Commands.clear();
+    m_Submissions.clear();
+    m_NextSubmission = 0;
+
+    // by layer, then compatible groups next to each other
+    std::vector< unsigned > order;
+    for ( unsigned i = 0; i < m_Groups.size(); ++i ) {
+        if ( !m_Groups[i].instances.empty() ) {
+            order.push_back( i );
+        }
+    }
+    std::sort( order.begin(), order.end(), [this]( unsigned a, unsigned b ) {
+        const Group& ga = m_Groups[a];
+        const Group& gb = m_Groups[b];
+        return ga.layer != gb.layer ? ga.layer < gb.layer : IsBefore( *ga.mesh, *gb.mesh );
+    } );
+
+    for ( unsigned index : order ) {
+        Group& group = m_Groups[ index ];
+        group.first = m_Instances.size();
+        m_Instances.insert( m_Instances.end(), group.instances.begin(), group.instances.end() );
+        GLsizei count = group.instances.size();
+        group.instances.clear();
+
+        if ( !m_Indirect ) {
+            Submission submission = { group.layer, group.mesh, group.first, count };
+            m_Submissions.push_back( submission );
+            continue;
+        }
+        DrawElementsIndirectCommand command;
+        group.mesh->GetIndirectCommand( command );
+        command.instanceCount = count;
+        command.baseInstance  = group.first;
+        if ( !m_Submissions.empty() && m_Submissions.back().layer == group.layer &&
+                IsCompatible( *m_Submissions.back().mesh, *group.mesh ) ) {
+            ++m_Submissions.back().count;
+        } else {
+            Submission submission = { group.layer, group.mesh, GLuint( m_Commands.size() ), 1 };
+            m_Submissions.push_back( submission );
+        }
+        m_Commands.push_back( command );
+    }
+    m_InstanceCount = m_Instances.size();
+    if ( m_Instances.empty() ) {
+        return;
+    }
+
+    // orphan and refill - last frame's draws might still read the old contents
+    GLStateCache::GetCurrent().BindBuffer( GLStateCache::BUFFER_ARRAY, m_InstanceBuffer );
+    glBufferData( GL_ARRAY_BUFFER, m_Instances.size() * sizeof( InstanceData ), nullptr, GL_STREAM_DRAW );
+    glBufferSubData( GL_ARRAY_BUFFER, 0, m_Instances.size() * sizeof( InstanceData ), &m_Instances[0] );
+    if ( m_Indirect ) {
+        glBindBuffer( GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer );
+        glBufferData( GL_DRAW_INDIRECT_BUFFER, m_Commands.size() * sizeof( DrawElementsIndirectCommand ), nullptr, GL_STREAM_DRAW );
+        glBufferSubData( GL_DRAW_INDIRECT_BUFFER, 0, m_Commands.size() * sizeof( DrawElementsIndirectCommand ), &m_Commands[0] );
+        glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+    }
+}
+
+void Instancer::VertexAttribDivisor( GLuint index, GLuint divisor )
+{
+    if ( GLEW_VERSION_3_3 ) {
+        glVertexAttribDivisor( index, divisor );
+    } else {
+        glVertexAttribDivisorARB( index, divisor );
+    }
+}
+
+void Instancer::SetInstanceArrays( bool enable )
+{
+    for ( GLuint index = ATTRIB_TRANSFORM; index <= ATTRIB_COLOR; ++index ) {
+        if ( enable ) {
+            glEnableVertexAttribArray( index );
+            VertexAttribDivisor( index, 1 );
+        } else {
+            VertexAttribDivisor( index, 0 );
+            glDisableVertexAttribArray( index );
+        }
+    }
+}
+
+void Instancer::SetInstancePointers( GLuint first )
+{
+    const GLsizei stride = sizeof( InstanceData );
+    const std::size_t base = first * sizeof( InstanceData );
+    GLStateCache::GetCurrent().BindBuffer( GLStateCache::BUFFER_ARRAY, m_InstanceBuffer );
+    for ( GLuint column = 0; column < 4; ++column ) {
+        glVertexAttribPointer( ATTRIB_TRANSFORM + column, 4, GL_FLOAT, GL_FALSE, stride,
+                               (void*)( base + offsetof( InstanceData, transform ) + column * 4 * sizeof(float) ) );
+    }
+    glVertexAttribPointer( ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, stride, (void*)( base + offsetof( InstanceData, color ) ) );
+}
+
+void Instancer::Draw( DrawInfo::Layer layer, const Matrix4& view )
+{
+    if ( m_NextSubmission == m_Submissions.size() || m_Submissions[ m_NextSubmission ].layer > layer ) {
+        return;
+    }
+    // entities before us left their own modelview
+    glLoadMatrixf( view );
+    glUseProgram( m_Program );
+    SetInstanceArrays( true );
+    if ( m_Indirect ) {
+        // the base instance of each command picks its rows
+        SetInstancePointers( 0 );
+        glBindBuffer( GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer );
+    }
+
+    for ( ; m_NextSubmission < m_Submissions.size() && m_Submissions[ m_NextSubmission ].layer <= layer; ++m_NextSubmission ) {
+        const Submission& submission = m_Submissions[ m_NextSubmission ];
+        glUniform1f( m_DecodeScaleLocation, submission.mesh->GetDecodeScale() );
+        if ( m_Indirect ) {
+            submission.mesh->DrawIndirect( submission.first * sizeof( DrawElementsIndirectCommand ), submission.count );
+        } else {
+            // the mesh binds its own vertex buffer - point at the instances first
+            SetInstancePointers( submission.first );
+            submission.mesh->DrawInstanced( submission.count );
+        }
+        ++m_DrawCalls;
+    }
+
+    if ( m_Indirect ) {
+        glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+    }
+    SetInstanceArrays( false );
+    glUseProgram( 0 );
+}
+
+void Instancer::EndFrame()
+{
+    ++m_Frames;
+    m_TotalDrawCalls += m_DrawCalls;
+    m_TotalInstances += m_InstanceCount;
+    m_DrawCalls = 0;
+    m_InstanceCount = 0;
+    m_Submissions.clear();
+    m_NextSubmission = 0;
+}
+
+void Instancer::Report( FILE* out ) const
+{
+    if ( !m_Frames ) {
+        return;
+    }
+    double frames = double( m_Frames );
+    fprintf( out, "Instancing (%s): %.1f draw calls, %.1f instances per frame\n", m_Indirect ? "indirect" : "instanced",
+            m_TotalDrawCalls / frames, m_TotalInstances / frames );
+}
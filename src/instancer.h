@@ -0,0 +1,147 @@
+/*
+ * instancer.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef INSTANCER_H_
+#define INSTANCER_H_
+
+#include "matrix.h"
+#include "drawkey.h"
+#include "mesh.h"
+
+#include <GL/glew.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+// Per instance attributes, streamed every frame
+struct InstanceData
+{
+    float transform[16];    // model matrix, column major
+    float color[4];         // multiplies the vertex color
+};
+
+// Collects the instances of a frame, grouped by layer and shape (see MakeShapeKey), uploads them at once and draws
+// every group with one glDrawElementsInstanced. With indirect drawing (GL 4.3 or GL_ARB_multi_draw_indirect +
+// GL_ARB_base_instance) all groups of a layer that share buffers and GL state go into one
+// glMultiDrawElementsIndirect - one command per shape. Lighting is done in a small GLSL 1.20 program that mirrors
+// the fixed function setup of Renderer::InitGL (GL_LIGHT0, color material ambient and diffuse). Render thread only.
+class Instancer : boost::noncopyable
+{
+    struct Group
+    {
+        const Mesh*                 mesh;       // shared by the shape (MeshCache)
+        DrawInfo::Layer             layer;
+        std::vector< InstanceData > instances;
+        GLuint                      first;      // first instance in m_InstanceBuffer after Build
+    };
+
+    // Meshes with the same shape but a different encoding can't share a draw, layers draw at different times
+    struct GroupKey
+    {
+        uint64_t        shape;
+        unsigned        state;      // Mesh::GetStateId
+        DrawInfo::Layer layer;
+
+        bool operator==( const GroupKey& other ) const
+        {
+            return shape == other.shape && state == other.state && layer == other.layer;
+        }
+    };
+
+    struct GroupKeyHash
+    {
+        std::size_t operator()( const GroupKey& key ) const
+        {
+            return std::size_t( key.shape ^ ( uint64_t( key.state ) * 0x9e3779b97f4a7c15ull ) ^ ( uint64_t( key.layer ) << 61 ) );
+        }
+    };
+
+    // One draw call: a group, or a run of indirect commands
+    struct Submission
+    {
+        DrawInfo::Layer layer;
+        const Mesh*     mesh;           // binds the buffers - the same for all commands of the submission
+        GLuint          first;          // instance (instanced) or command (indirect)
+        GLsizei         count;          // instances (instanced) or commands (indirect)
+    };
+
+    std::vector< Group >                      m_Groups;
+    std::unordered_map< GroupKey, unsigned, GroupKeyHash > m_GroupIndex;  // -> m_Groups
+    DrawInfo::Layer                           m_Layer;         // of the entities being added
+
+    // built per frame
+    std::vector< InstanceData >                m_Instances;
+    std::vector< DrawElementsIndirectCommand > m_Commands;
+    std::vector< Submission >                  m_Submissions;  // by layer
+    std::size_t                                m_NextSubmission;
+
+    bool     m_Enabled;
+    bool     m_Indirect;
+    GLuint   m_Program;
+    GLuint   m_Shaders[2];
+    GLuint   m_InstanceBuffer;
+    GLuint   m_IndirectBuffer;
+    GLint    m_DecodeScaleLocation;
+
+    // per frame
+    unsigned m_DrawCalls;
+    unsigned m_InstanceCount;
+    // totals of the finished frames
+    std::size_t m_Frames;
+    std::size_t m_TotalDrawCalls;
+    std::size_t m_TotalInstances;
+
+    void VertexAttribDivisor( GLuint index, GLuint divisor );
+
+    void SetInstanceArrays( bool enable );
+
+    void SetInstancePointers( GLuint first );
+public:
+    // First generic attribute of the instance transform (4 consecutive columns), then color. Above the
+    // conventional arrays NVIDIA aliases to generic attributes
+    enum {
+        ATTRIB_TRANSFORM = 10,
+        ATTRIB_COLOR     = ATTRIB_TRANSFORM + 4,
+    };
+
+    Instancer();
+
+    ~Instancer();
+
+    // Compiles the program. False if the GL can't do GLSL and instanced arrays - entities draw one by one then.
+    // indirect falls back to instanced draws per shape if the GL can't draw indirect
+    bool Init( bool indirect );
+
+    void Release();
+
+    bool IsEnabled() const { return m_Enabled; }
+
+    bool IsIndirect() const { return m_Indirect; }
+
+    // Layer of the instances added next
+    void SetLayer( DrawInfo::Layer layer ) { m_Layer = layer; }
+
+    void Add( uint64_t shape, const Mesh& mesh, const InstanceData& instance );
+
+    // Uploads the instances (and commands) of all groups. After the last Add of the frame
+    void Build();
+
+    // Draws the groups of all layers up to layer that haven't been drawn this frame. After Build. Loads view into the
+    // modelview matrix
+    void Draw( DrawInfo::Layer layer, const Matrix4& view );
+
+    // Clears the groups and starts counting the draws of the next frame
+    void EndFrame();
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* INSTANCER_H_ */
@@ -0,0 +1,126 @@
+/*
+ * lod.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Farthest a silhouette edge may be from the true outline, in pixels
+static const float MAX_ERROR_PIXELS = 0.5f;
+
+// A level is left for the coarser one once the size is this fraction below the coarser level's limit
+static const float DEFAULT_HYSTERESIS = 0.2f;
+
+LodChain::LodChain()
+    : m_Current(0)
+    , m_Hysteresis( DEFAULT_HYSTERESIS )
+{
+}
+
+void LodChain::AddLevel( uint64_t key, int segments )
+{
+    Level level = { key, GetMaxRadius( segments ), SharedMeshPtr() };
+    m_Levels.push_back( level );
+    m_Current = m_Levels.size() - 1;
+}
+
+bool LodChain::Prepare( MeshBuilder::Topology topology, const Generator& generate )
+{
+    bool generated(false);
+    for ( std::size_t i = 0; i < m_Levels.size(); ++i ) {
+        Level& level = m_Levels[i];
+        level.mesh = MeshCache::GetDefault().Acquire( level.key, topology );
+        if ( level.mesh->Prepare( [&generate, i]( MeshBuilder& geometry ) { generate( geometry, i ); } ) ) {
+            generated = true;
+        }
+    }
+    return generated;
+}
+
+std::size_t LodChain::GetUploadSize() const
+{
+    std::size_t bytes(0);
+    for ( auto& level : m_Levels ) {
+        bytes += level.mesh->GetUploadSize();
+    }
+    return bytes;
+}
+
+void LodChain::Upload()
+{
+    for ( auto& level : m_Levels ) {
+        level.mesh->Upload();
+    }
+}
+
+bool LodChain::Select( float pixels )
+{
+    std::size_t current = m_Current;
+    while ( m_Current + 1 < m_Levels.size() && pixels > m_Levels[ m_Current ].maxRadius ) {
+        ++m_Current;
+    }
+    while ( m_Current > 0 && pixels < m_Levels[ m_Current - 1 ].maxRadius * ( 1 - m_Hysteresis ) ) {
+        --m_Current;
+    }
+    return m_Current != current;
+}
+
+float LodChain::GetMaxRadius( int segments )
+{
+    // an edge of a regular polygon is r * ( 1 - cos( pi/segments ) ) inside the circle
+    return MAX_ERROR_PIXELS / float( 1 - std::cos( M_PI / std::max( segments, 3 ) ) );
+}
+
+LodSelector::LodSelector()
+    : m_PixelsPerUnit(0)
+    , m_Selected(0)
+    , m_Switches(0)
+    , m_TotalSelected(0)
+    , m_TotalSwitches(0)
+    , m_Frames(0)
+{
+}
+
+void LodSelector::Begin( const Matrix4& projection, const Matrix4& view, int height )
+{
+    // projection(1,1) is cot( fov/2 ): half the viewport height covers 1/cot units at distance 1
+    m_View = view;
+    m_PixelsPerUnit = projection( 1, 1 ) * 0.5f * float( height );
+    m_Selected = 0;
+    m_Switches = 0;
+}
+
+float LodSelector::GetScreenRadius( const Vector& center, float radius ) const
+{
+    // distance along the view direction - spheres around or behind the eye get the finest level
+    float depth = -( m_View * center )[ Vector::Z ];
+    if ( depth <= radius ) {
+        return std::numeric_limits< float >::max();
+    }
+    return radius * m_PixelsPerUnit / depth;
+}
+
+void LodSelector::End()
+{
+    m_TotalSelected += m_Selected;
+    m_TotalSwitches += m_Switches;
+    ++m_Frames;
+}
+
+void LodSelector::Report( FILE* out ) const
+{
+    if ( !m_Frames ) {
+        return;
+    }
+    fprintf( out, "Detail levels: %.1f entities selected, %.2f level switches per frame\n",
+            double( m_TotalSelected ) / m_Frames, double( m_TotalSwitches ) / m_Frames );
+}
@@ -0,0 +1,114 @@
+/*
+ * lod.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef LOD_H_
+#define LOD_H_
+
+#include "meshcache.h"
+#include "matrix.h"
+#include "vector.h"
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+// Meshes of one shape at increasing tessellation, coarsest first. Each level is good up to a projected radius in
+// pixels; Select moves between levels with hysteresis so that entities near a threshold don't pop back and forth.
+// Starts at the finest level. A chain of one level never switches
+class LodChain : boost::noncopyable
+{
+public:
+    // Generates level (0 is the coarsest) into geometry
+    typedef boost::function< void( MeshBuilder& geometry, std::size_t level ) > Generator;
+private:
+    struct Level
+    {
+        uint64_t      key;          // shape key in the MeshCache
+        float         maxRadius;    // largest projected radius in pixels the level is fine for
+        SharedMeshPtr mesh;
+    };
+
+    std::vector< Level > m_Levels;
+    std::size_t m_Current;
+    float       m_Hysteresis;
+public:
+    LodChain();
+
+    // Appends a finer level with segments around its silhouette - that decides up to which size it holds up
+    void AddLevel( uint64_t key, int segments );
+
+    // Acquires every level from the MeshCache and prepares it. True if this chain generated any of them. Thread safe
+    bool Prepare( MeshBuilder::Topology topology, const Generator& generate );
+
+    // Of the levels nobody uploaded yet. After Prepare
+    std::size_t GetUploadSize() const;
+
+    // Uploads the levels nobody uploaded yet. Render thread only
+    void Upload();
+
+    // Picks the level for a projected radius in pixels: finer as soon as the current one is too coarse, coarser
+    // only once the size is the hysteresis fraction below the coarser level's limit. True if the level changed
+    bool Select( float pixels );
+
+    // 0 switches down exactly at the limits
+    void SetHysteresis( float hysteresis ) { m_Hysteresis = hysteresis; }
+
+    std::size_t GetLevelCount() const { return m_Levels.size(); }
+
+    std::size_t GetLevel() const { return m_Current; }
+
+    // Shape key of the current level - instances of the same level batch
+    uint64_t GetKey() const { return m_Levels[ m_Current ].key; }
+
+    const Mesh& GetMesh() const { return m_Levels[ m_Current ].mesh->GetMesh(); }
+
+    // Of the finest level - the coarser ones are inscribed. After Prepare
+    const Bounds& GetBounds() const { return m_Levels.back().mesh->GetBounds(); }
+
+    // Projected radius up to which a circle of segments stays within the error tolerance
+    static float GetMaxRadius( int segments );
+};
+
+// Per frame level of detail selection for the render list: projects world space bounding spheres to a radius in
+// pixels with the viewport's projection, the renderer hands that to the entities. Render thread only
+class LodSelector : boost::noncopyable
+{
+    Matrix4     m_View;
+    float       m_PixelsPerUnit;    // projected radius of a unit sphere at distance 1
+
+    std::size_t m_Selected;         // last frame
+    std::size_t m_Switches;
+    std::size_t m_TotalSelected;
+    std::size_t m_TotalSwitches;
+    unsigned    m_Frames;
+public:
+    LodSelector();
+
+    // Starts a frame. height: of the viewport in pixels
+    void Begin( const Matrix4& projection, const Matrix4& view, int height );
+
+    // Projected radius in pixels of a world space sphere
+    float GetScreenRadius( const Vector& center, float radius ) const;
+
+    // An entity was given its size. switched: it changed its level
+    void Selected( bool switched )
+    {
+        ++m_Selected;
+        m_Switches += switched;
+    }
+
+    void End();
+
+    std::size_t GetSwitches() const { return m_Switches; }
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* LOD_H_ */
@@ -23,7 +23,8 @@ extern "C" int SDL_main( int argc, char* argv[] )
     std::set_unexpected( HandleUnexpected );
 	try {
 #ifdef __linux__
-		gtk_init(&argc,&argv);
+		// Don't bail out without a display (e.g. headless). Errors go to stderr instead
+		gtk_init_check(&argc,&argv);
 #endif
 		App app;
 		app.Init( argc, argv );
@@ -0,0 +1,229 @@
+/*
+ * matrix.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef MATRIX_H_
+#define MATRIX_H_
+
+#include "vector.h"
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+
+// Unit quaternion for rotations. Composes like the matrices it stands for: ( a * b ) rotates by b first, then by a
+class Quaternion
+{
+public:
+    float x, y, z, w;
+
+    Quaternion() : x(0), y(0), z(0), w(1) {}
+
+    Quaternion( float x_, float y_, float z_, float w_ ) : x(x_), y(y_), z(z_), w(w_) {}
+
+    // axis must be normalized
+    static Quaternion FromAxisAngle( const Vector& axis, float degrees )
+    {
+        float half = degrees * float( 3.14159265358979323846 / 360.0 );
+        float s = std::sin( half );
+        return Quaternion( axis[ Vector::X ] * s, axis[ Vector::Y ] * s, axis[ Vector::Z ] * s, std::cos( half ) );
+    }
+
+    // Same rotation as glRotatef( x, 1,0,0 ); glRotatef( y, 0,1,0 ); glRotatef( z, 0,0,1 )
+    static Quaternion FromEuler( const Vector& degrees )
+    {
+        return FromAxisAngle( Vector( 1, 0, 0 ), degrees[ Vector::X ] ) *
+               FromAxisAngle( Vector( 0, 1, 0 ), degrees[ Vector::Y ] ) *
+               FromAxisAngle( Vector( 0, 0, 1 ), degrees[ Vector::Z ] );
+    }
+
+    Quaternion operator*( const Quaternion& q ) const
+    {
+        return Quaternion( w*q.x + x*q.w + y*q.z - z*q.y,
+                           w*q.y - x*q.z + y*q.w + z*q.x,
+                           w*q.z + x*q.y - y*q.x + z*q.w,
+                           w*q.w - x*q.x - y*q.y - z*q.z );
+    }
+
+    // Repeated products drift away from unit length
+    Quaternion& Normalize()
+    {
+        float length = std::sqrt( x*x + y*y + z*z + w*w );
+        if ( length > 0 ) {
+            float s = 1/length;
+            x *= s; y *= s; z *= s; w *= s;
+        }
+        return *this;
+    }
+};
+
+// 4x4 float matrix, column major like GL - hand it to glLoadMatrixf as is. Columns are one SIMD register each
+class SIMD_ALIGN(16) Matrix4
+{
+    float m[16];
+
+#ifdef SIMD_ENABLED
+    simd::float4 Column( int col ) const { return simd::load( m + col*4 ); }
+
+    // this * v for the 4 floats at v
+    simd::float4 Transform( const float* v ) const
+    {
+        simd::float4 r = simd::mul( Column( 0 ), simd::splat( v[0] ) );
+        r = simd::add( r, simd::mul( Column( 1 ), simd::splat( v[1] ) ) );
+        r = simd::add( r, simd::mul( Column( 2 ), simd::splat( v[2] ) ) );
+        return simd::add( r, simd::mul( Column( 3 ), simd::splat( v[3] ) ) );
+    }
+#endif
+public:
+    // identity
+    Matrix4()
+    {
+        SetIdentity();
+    }
+
+    Matrix4( const float matrix[16] )
+    {
+        std::memcpy( m, matrix, sizeof( m ) );
+    }
+
+    operator const float* () const { return m; }
+
+    float operator()( int row, int col ) const { return m[ col*4 + row ]; }
+
+    float& operator()( int row, int col ) { return m[ col*4 + row ]; }
+
+    Matrix4& SetIdentity()
+    {
+        static const float sIdentity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        std::memcpy( m, sIdentity, sizeof( m ) );
+        return *this;
+    }
+
+    // Where the origin ends up
+    Vector GetTranslation() const { return Vector( m[12], m[13], m[14] ); }
+
+    static Matrix4 Translation( const Vector& t )
+    {
+        Matrix4 r;
+        r.m[12] = t[ Vector::X ]; r.m[13] = t[ Vector::Y ]; r.m[14] = t[ Vector::Z ];
+        return r;
+    }
+
+    static Matrix4 Scale( const Vector& s )
+    {
+        Matrix4 r;
+        r.m[0] = s[ Vector::X ]; r.m[5] = s[ Vector::Y ]; r.m[10] = s[ Vector::Z ];
+        return r;
+    }
+
+    static Matrix4 Rotation( const Quaternion& q )
+    {
+        return Compose( Vector( 0, 0, 0 ), q, Vector( 1, 1, 1 ) );
+    }
+
+    // Translation * Scale * Rotation in one go - the order of glTranslatef, glScalef, glRotatef the entities used.
+    // Non-uniform scales stretch along the parent's axes, not the rotated ones
+    static Matrix4 Compose( const Vector& position, const Quaternion& q, const Vector& scale )
+    {
+        float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+        float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+        float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+        float sx = scale[ Vector::X ], sy = scale[ Vector::Y ], sz = scale[ Vector::Z ];
+
+        Matrix4 r;
+        r.m[0]  = ( 1 - 2*(yy + zz) ) * sx; r.m[1]  = 2*(xy + wz) * sy;         r.m[2]  = 2*(xz - wy) * sz;         r.m[3]  = 0;
+        r.m[4]  = 2*(xy - wz) * sx;         r.m[5]  = ( 1 - 2*(xx + zz) ) * sy; r.m[6]  = 2*(yz + wx) * sz;         r.m[7]  = 0;
+        r.m[8]  = 2*(xz + wy) * sx;         r.m[9]  = 2*(yz - wx) * sy;         r.m[10] = ( 1 - 2*(xx + yy) ) * sz; r.m[11] = 0;
+        r.m[12] = position[ Vector::X ];    r.m[13] = position[ Vector::Y ];    r.m[14] = position[ Vector::Z ];    r.m[15] = 1;
+        return r;
+    }
+
+    // Same as gluPerspective
+    static Matrix4 Perspective( float fovyDegrees, float aspect, float zNear, float zFar )
+    {
+        float f = 1.0f / std::tan( fovyDegrees * float( 3.14159265358979323846 / 360.0 ) );
+        Matrix4 r;
+        r.m[0]  = f / aspect;
+        r.m[5]  = f;
+        r.m[10] = ( zFar + zNear ) / ( zNear - zFar );
+        r.m[11] = -1;
+        r.m[14] = 2 * zFar * zNear / ( zNear - zFar );
+        r.m[15] = 0;
+        return r;
+    }
+
+    // this * b: b is applied first
+    Matrix4 operator*( const Matrix4& b ) const
+    {
+        Matrix4 r;
+        Multiply( *this, b, r );
+        return r;
+    }
+
+    // r = a * b. r must not be a or b
+    static void Multiply( const Matrix4& a, const Matrix4& b, Matrix4& r )
+    {
+#ifdef SIMD_ENABLED
+        for ( int col = 0; col < 4; ++col ) {
+            simd::store( r.m + col*4, a.Transform( b.m + col*4 ) );
+        }
+#else
+        for ( int col = 0; col < 4; ++col ) {
+            for ( int row = 0; row < 4; ++row ) {
+                r.m[ col*4 + row ] = a.m[ row ] * b.m[ col*4 ] + a.m[ 4 + row ] * b.m[ col*4 + 1 ] +
+                                     a.m[ 8 + row ] * b.m[ col*4 + 2 ] + a.m[ 12 + row ] * b.m[ col*4 + 3 ];
+            }
+        }
+#endif
+    }
+
+    // this * v, all four components
+    Vector operator*( const Vector& v ) const
+    {
+        Vector r;
+#ifdef SIMD_ENABLED
+        simd::store( r, Transform( v ) );
+#else
+        for ( int row = 0; row < 4; ++row ) {
+            r[ Vector::Coord( row ) ] = m[ row ] * v[ Vector::X ] + m[ 4 + row ] * v[ Vector::Y ] + m[ 8 + row ] * v[ Vector::Z ] + m[ 12 + row ] * v[ Vector::W ];
+        }
+#endif
+        return r;
+    }
+
+    // Full inverse by cofactors. False (and inverse untouched) if the matrix is singular
+    bool Inverse( Matrix4& inverse ) const
+    {
+        float inv[16];
+        inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+        inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+        inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+        inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+        inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+        inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+        inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+        inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+        inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+        inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+        inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+        inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+        inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+        inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+        inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+        inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+        float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+        if ( det == 0 ) {
+            return false;
+        }
+        float s = 1/det;
+        for ( int i = 0; i < 16; ++i ) {
+            inverse.m[i] = inv[i] * s;
+        }
+        return true;
+    }
+};
+
+#endif /* MATRIX_H_ */
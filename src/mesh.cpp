@@ -0,0 +1,328 @@
+/*
+ * mesh.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "mesh.h"
+#include "meshoptimizer.h"
+#include "stagingbuffer.h"
+#include "glstate.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MeshBuilder::Clear()
+{
+    m_Vertices.clear();
+    m_Indices.clear();
+}
+
+void MeshBuilder::Interleave( const VectorArray& positions, const VectorArray& normals, const VectorArray& colors )
+{
+    BOOST_ASSERT( positions.size() == normals.size() && positions.size() == colors.size() );
+
+    m_Vertices.resize( positions.size() );
+    for ( std::size_t i = 0; i < positions.size(); ++i ) {
+        Vertex& vertex = m_Vertices[i];
+        vertex.position = positions[i];
+        vertex.normal   = normals[i];
+        vertex.color    = colors[i];
+    }
+}
+
+unsigned int MeshBuilder::AddVertex( const Vector& position, const Vector& normal, const Vector& color )
+{
+    Vertex vertex;
+    vertex.position = position;
+    vertex.normal   = normal;
+    vertex.color    = color;
+    m_Vertices.push_back( vertex );
+    return m_Vertices.size() - 1;
+}
+
+void MeshBuilder::AddTriangle( unsigned int a, unsigned int b, unsigned int c )
+{
+    m_Indices.push_back( a );
+    m_Indices.push_back( b );
+    m_Indices.push_back( c );
+}
+
+void MeshBuilder::Optimize()
+{
+    if ( m_Topology == TRIANGLES ) {
+        // strips are in grid order already
+        OptimizeVertexCache( m_Indices, m_Vertices.size() );
+        OptimizeOverdraw( m_Indices, m_Vertices );
+    }
+    OptimizeVertexFetch( m_Vertices, m_Indices );
+}
+
+Bounds MeshBuilder::ComputeBounds() const
+{
+    if ( m_Vertices.empty() ) {
+        return Bounds();
+    }
+    Vector min = m_Vertices[0].position, max = min;
+    for ( const Vertex& vertex : m_Vertices ) {
+        for ( int c = Vector::X; c <= Vector::Z; ++c ) {
+            Vector::Coord coord = Vector::Coord( c );
+            min[ coord ] = std::min( min[ coord ], vertex.position[ coord ] );
+            max[ coord ] = std::max( max[ coord ], vertex.position[ coord ] );
+        }
+    }
+    Bounds bounds = Bounds::FromBox( min, max );
+    // the farthest vertex from the box center - a sphere's sphere is the sphere itself, not the box's
+    float radiusSq(0);
+    for ( const Vertex& vertex : m_Vertices ) {
+        Vector d = vertex.position - bounds.center;
+        radiusSq = std::max( radiusSq, d.Dot( d ) );
+    }
+    bounds.radius = std::sqrt( radiusSq );
+    return bounds;
+}
+
+Mesh::Mesh( const VertexFormat& format /*= VertexFormat::GetDefault()*/ )
+    : m_VboID(0)
+    , m_IdxBufferID(0)
+    , m_VertexBlock(BufferArena::INVALID_BLOCK)
+    , m_IndexBlock(BufferArena::INVALID_BLOCK)
+    , m_NumIndices(0)
+    , m_IndexType(GL_UNSIGNED_INT)
+    , m_Mode(GL_TRIANGLES)
+    , m_PrimitiveRestart(false)
+    , m_AllowByteIndices(false)
+    , m_Format(format)
+    , m_PositionScale(1.0f)
+{
+}
+
+Mesh::~Mesh()
+{
+    // shouldn't be done in d'tor...might be weakly linked to e.g. event handler...but vbo must be released from render thread
+    if ( m_VboID > 0 ) {
+        GLStateCache::DeleteBuffers(1, &m_VboID);
+    }
+    if ( m_IdxBufferID > 0 ) {
+        GLStateCache::DeleteBuffers(1, &m_IdxBufferID);
+    }
+    // no arena anymore - its pages are gone already
+    BufferArena* arena = BufferArena::GetCurrent();
+    if ( arena && m_VertexBlock != BufferArena::INVALID_BLOCK ) {
+        arena->Free( m_VertexBlock );
+    }
+    if ( arena && m_IndexBlock != BufferArena::INVALID_BLOCK ) {
+        arena->Free( m_IndexBlock );
+    }
+}
+
+std::size_t Mesh::GetUploadSize( const MeshBuilder& builder ) const
+{
+    std::size_t numVertices = builder.GetVertices().size();
+    std::size_t numIndices  = builder.GetIndices().size();
+    // strips without primitive restart get a few more indices stitched in. Close enough
+    return numVertices * m_Format.stride + numIndices * GetIndexSize( SelectIndexType( numVertices, m_AllowByteIndices ) );
+}
+
+void Mesh::Upload( const MeshBuilder& builder )
+{
+    bool hasVBO  = glewGetExtension("GL_ARB_vertex_buffer_object");
+    ASSERT( hasVBO, "VBOs not supported!" );
+
+    const VertexArray& vertices = builder.GetVertices();
+    const IndexArray&  indices  = builder.GetIndices();
+    ASSERT( !vertices.empty() && !indices.empty(), "Can't upload an empty mesh!" );
+
+    IndexArray stitched;
+    if ( builder.GetTopology() == MeshBuilder::TRIANGLE_STRIP ) {
+        m_Mode = GL_TRIANGLE_STRIP;
+        m_PrimitiveRestart = GLEW_VERSION_3_1 || GLEW_NV_primitive_restart;
+        if ( !m_PrimitiveRestart ) {
+            stitched = indices;
+            StitchStrips( stitched );
+        }
+    } else {
+        m_Mode = GL_TRIANGLES;
+        m_PrimitiveRestart = false;
+    }
+    const IndexArray& uploadIndices = stitched.empty() ? indices : stitched;
+
+    m_Format = m_Format.Supported();
+
+    // Vertex buffer - one interleaved block, one upload
+    if ( m_Format.IsFloat() ) {
+        UploadBuffer(BufferArena::VERTICES, m_Format.stride, sizeof(Vertex)*vertices.size(), &vertices[0], m_VboID, m_VertexBlock);
+    } else {
+        if ( m_Format.position == VertexFormat::POSITION_SNORM16 ) {
+            // map the bounds onto -1..1
+            float extent(0);
+            for ( auto& vertex : vertices ) {
+                extent = std::max( extent, std::fabs( vertex.position[ Vector::X ] ) );
+                extent = std::max( extent, std::fabs( vertex.position[ Vector::Y ] ) );
+                extent = std::max( extent, std::fabs( vertex.position[ Vector::Z ] ) );
+            }
+            m_PositionScale = extent > 0 ? 1.0f/extent : 1.0f;
+        }
+        std::vector< unsigned char > encoded;
+        m_Format.Encode( vertices, m_PositionScale, encoded );
+        UploadBuffer(BufferArena::VERTICES, m_Format.stride, encoded.size(), &encoded[0], m_VboID, m_VertexBlock);
+    }
+
+    // Index Buffer - as narrow as the vertex count allows
+    switch ( SelectIndexType( vertices.size(), m_AllowByteIndices ) ) {
+    case GL_UNSIGNED_BYTE:  UploadIndices< GLubyte >( uploadIndices ); break;
+    case GL_UNSIGNED_SHORT: UploadIndices< GLushort >( uploadIndices ); break;
+    default:                UploadIndices< GLuint >( uploadIndices ); break;
+    }
+    m_NumIndices = uploadIndices.size();
+}
+
+unsigned Mesh::GetStateId() const
+{
+    // 0 is left for non-mesh entities
+    return 1 + ( m_Format.position | m_Format.normal << 2 | m_Format.color << 4
+            | ( m_Mode == GL_TRIANGLE_STRIP ) << 5 | m_PrimitiveRestart << 6 | ( GetIndexSize( m_IndexType ) - 1 ) << 7 );
+}
+
+template< typename T >
+void Mesh::UploadIndices( const IndexArray& indices )
+{
+    IndexStorage< T > storage( indices );
+    // one alignment for all index types - they share the index pages
+    UploadBuffer(BufferArena::INDICES, 4, storage.GetSizeInBytes(), storage.GetData(), m_IdxBufferID, m_IndexBlock);
+    m_IndexType = storage.GetType();
+}
+
+void Mesh::UploadBuffer( BufferArena::Kind kind, GLsizei alignment, GLsizeiptr size, const GLvoid* data,
+                         GLuint& buffer, BufferArena::BlockId& block )
+{
+    BufferArena* arena = BufferArena::GetCurrent();
+    if ( arena && arena->IsEnabled() ) {
+        block = arena->Allocate( kind, alignment, size );
+        arena->Upload( block, size, data );
+        return;
+    }
+    glGenBuffers(1, &buffer);
+    if ( kind == BufferArena::VERTICES ) {
+        GLStateCache::GetCurrent().BindBuffer(GLStateCache::BUFFER_ARRAY, buffer);
+        StagedBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+    } else {
+        GLStateCache::GetCurrent().BindBuffer(GLStateCache::BUFFER_ELEMENT_ARRAY, buffer);
+        StagedBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+    }
+}
+
+GLuint Mesh::GetBufferId() const
+{
+    return m_VertexBlock != BufferArena::INVALID_BLOCK ? BufferArena::GetCurrent()->GetBuffer( m_VertexBlock ) : m_VboID;
+}
+
+GLuint Mesh::GetIndexBufferId() const
+{
+    return m_IndexBlock != BufferArena::INVALID_BLOCK ? BufferArena::GetCurrent()->GetBuffer( m_IndexBlock ) : m_IdxBufferID;
+}
+
+void Mesh::GetDrawOffsets( const GLvoid*& indices, GLint& baseVertex ) const
+{
+    indices    = nullptr;
+    baseVertex = 0;
+    if ( m_VertexBlock != BufferArena::INVALID_BLOCK ) {
+        const BufferArena& arena = *BufferArena::GetCurrent();
+        indices    = (const GLvoid*)arena.GetOffset( m_IndexBlock );
+        baseVertex = GLint( arena.GetOffset( m_VertexBlock ) / m_Format.stride );
+    }
+}
+
+void Mesh::Bind() const
+{
+    GLStateCache& state = GLStateCache::GetCurrent();
+    state.EnableClientState( GLStateCache::ARRAY_VERTEX );
+    state.EnableClientState( GLStateCache::ARRAY_NORMAL );
+    state.EnableClientState( GLStateCache::ARRAY_COLOR );
+
+    const GLsizei stride = m_Format.stride;
+    state.BindBuffer( GLStateCache::BUFFER_ARRAY, GetBufferId() );
+    // before draw, specify vertex and index arrays with their offsets. Arena meshes: relative to the page, the base
+    // vertex moves them to the block - same pointers for every mesh in the page
+    state.VertexPointer(m_Format.GetPositionSize(), m_Format.GetPositionType(), stride, (void*)(std::size_t)m_Format.positionOffset);
+    state.NormalPointer(m_Format.GetNormalType(), stride, (void*)(std::size_t)m_Format.normalOffset);
+    state.ColorPointer(4, m_Format.GetColorType(), stride, (void*)(std::size_t)m_Format.colorOffset);
+
+    // core since 3.1, NV extension before that
+    if ( GLEW_VERSION_3_1 ) {
+        state.Enable( GLStateCache::CAP_PRIMITIVE_RESTART, m_PrimitiveRestart );
+    } else if ( GLEW_NV_primitive_restart ) {
+        state.EnableClientState( GLStateCache::ARRAY_PRIMITIVE_RESTART_NV, m_PrimitiveRestart );
+    }
+    if ( m_PrimitiveRestart ) {
+        state.PrimitiveRestartIndex( GetRestartIndex( m_IndexType ) );
+    }
+
+    // use index array
+    state.BindBuffer( GLStateCache::BUFFER_ELEMENT_ARRAY, GetIndexBufferId() );
+}
+
+float Mesh::GetDecodeScale() const
+{
+    // snorm16 positions are not normalized by GL - this scales them back into model space
+    return m_Format.position == VertexFormat::POSITION_SNORM16 ? 1.0f / ( m_PositionScale * 32767.0f ) : 1.0f;
+}
+
+void Mesh::Draw( const Matrix4& modelView ) const
+{
+    Bind();
+
+    bool scaled = m_Format.position == VertexFormat::POSITION_SNORM16;
+    if ( scaled ) {
+        float s = GetDecodeScale();
+        glLoadMatrixf( modelView * Matrix4::Scale( Vector( s, s, s ) ) );
+    } else {
+        glLoadMatrixf( modelView );
+    }
+    // the scale ends up in the normal matrix as well
+    GLStateCache::GetCurrent().Enable( GLStateCache::CAP_NORMALIZE, scaled );
+
+    const GLvoid* indices;
+    GLint baseVertex;
+    GetDrawOffsets( indices, baseVertex );
+    if ( m_VertexBlock != BufferArena::INVALID_BLOCK ) {
+        glDrawElementsBaseVertex( m_Mode, m_NumIndices, m_IndexType, indices, baseVertex );
+    } else {
+        glDrawElements( m_Mode, m_NumIndices, m_IndexType, indices );
+    }
+}
+
+void Mesh::DrawInstanced( GLsizei count ) const
+{
+    Bind();
+
+    const GLvoid* indices;
+    GLint baseVertex;
+    GetDrawOffsets( indices, baseVertex );
+    if ( m_VertexBlock != BufferArena::INVALID_BLOCK ) {
+        glDrawElementsInstancedBaseVertex( m_Mode, m_NumIndices, m_IndexType, indices, count, baseVertex );
+    } else if ( GLEW_VERSION_3_1 ) {
+        glDrawElementsInstanced( m_Mode, m_NumIndices, m_IndexType, indices, count );
+    } else {
+        glDrawElementsInstancedARB( m_Mode, m_NumIndices, m_IndexType, indices, count );
+    }
+}
+
+void Mesh::GetIndirectCommand( DrawElementsIndirectCommand& command ) const
+{
+    const GLvoid* indices;
+    GLint baseVertex;
+    GetDrawOffsets( indices, baseVertex );
+    command.count         = m_NumIndices;
+    command.instanceCount = 1;
+    command.firstIndex    = GLuint( (std::size_t)indices / GetIndexSize( m_IndexType ) );
+    command.baseVertex    = baseVertex;
+    command.baseInstance  = 0;
+}
+
+void Mesh::DrawIndirect( GLintptr offset, GLsizei count ) const
+{
+    Bind();
+
+    glMultiDrawElementsIndirect( m_Mode, m_IndexType, (const GLvoid*)offset, count, 0 );
+}
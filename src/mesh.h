@@ -0,0 +1,157 @@
+/*
+ * mesh.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef MESH_H_
+#define MESH_H_
+
+#include "err.h"
+#include "vector.h"
+#include "matrix.h"
+#include "vertexformat.h"
+#include "indexbuffer.h"
+#include "bufferarena.h"
+#include "bounds.h"
+
+#include <GL/glew.h>
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+
+// CPU side geometry. Primitives generate into this, Mesh uploads it.
+class MeshBuilder
+{
+public:
+    enum Topology {
+        TRIANGLES = 0,      // 3 indices per triangle
+        TRIANGLE_STRIP,     // strips separated by RESTART_INDEX
+    };
+private:
+    VertexArray m_Vertices;
+    IndexArray  m_Indices;   // standard array to map vertices to tris
+    Topology    m_Topology;
+public:
+    MeshBuilder( Topology topology = TRIANGLES ) : m_Topology( topology ) {}
+
+    // Keeps the topology
+    void Clear();
+
+    Topology GetTopology() const { return m_Topology; }
+
+    // Packs planar position/normal/color arrays (all the same size) into interleaved vertices
+    void Interleave( const VectorArray& positions, const VectorArray& normals, const VectorArray& colors );
+
+    unsigned int AddVertex( const Vector& position, const Vector& normal, const Vector& color );
+
+    void AddTriangle( unsigned int a, unsigned int b, unsigned int c );
+
+    // TRIANGLE_STRIP only: the next index starts a new strip
+    void EndStrip() { m_Indices.push_back( RESTART_INDEX ); }
+
+    // Vertex cache, overdraw and vertex fetch reorder. Run once before upload - doesn't change the rendered result
+    void Optimize();
+
+    VertexArray& GetVertices() { return m_Vertices; }
+
+    const VertexArray& GetVertices() const { return m_Vertices; }
+
+    IndexArray& GetIndices() { return m_Indices; }
+
+    const IndexArray& GetIndices() const { return m_Indices; }
+
+    // Box and sphere around all vertex positions
+    Bounds ComputeBounds() const;
+};
+
+// Layout of glDrawElementsIndirect / glMultiDrawElementsIndirect commands
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// GPU side geometry: interleaved vertices + indices, suballocated from the current BufferArena (drawn with a base
+// vertex) or in buffers of its own if there is none. Must be used from the render thread only
+class Mesh : boost::noncopyable
+{
+    GLuint  m_VboID;            // own buffers - 0 if the mesh lives in the arena
+    GLuint  m_IdxBufferID;
+    BufferArena::BlockId m_VertexBlock;     // arena blocks - INVALID_BLOCK if the mesh has its own buffers
+    BufferArena::BlockId m_IndexBlock;
+    GLsizei m_NumIndices;
+    GLenum  m_IndexType;        // GL_UNSIGNED_BYTE/SHORT/INT - picked in Upload from the vertex count
+    GLenum  m_Mode;             // GL_TRIANGLES or GL_TRIANGLE_STRIP
+    bool    m_PrimitiveRestart; // strips are separated by the restart index - otherwise stitched with degenerate triangles
+    bool    m_AllowByteIndices;
+
+    VertexFormat m_Format;
+    float        m_PositionScale;   // POSITION_SNORM16 only: positions are stored as position * m_PositionScale
+
+    template< typename T >
+    void UploadIndices( const IndexArray& indices );
+
+    // Into an arena block if there is an arena, a new buffer otherwise
+    void UploadBuffer( BufferArena::Kind kind, GLsizei alignment, GLsizeiptr size, const GLvoid* data,
+                       GLuint& buffer, BufferArena::BlockId& block );
+
+    // Index pointer and base vertex for glDrawElements*BaseVertex. 0, 0 for own buffers
+    void GetDrawOffsets( const GLvoid*& indices, GLint& baseVertex ) const;
+
+    // Arrays, pointers, restart index and index buffer for a draw
+    void Bind() const;
+public:
+    Mesh( const VertexFormat& format = VertexFormat::GetDefault() );
+
+    ~Mesh();
+
+    // Must be called before Upload
+    void SetFormat( const VertexFormat& format ) { m_Format = format; }
+
+    // Format actually used after Upload - might fall back to a different encoding if the GL can't handle it
+    const VertexFormat& GetFormat() const { return m_Format; }
+
+    // Must be called before Upload. Off by default, see SelectIndexType
+    void SetAllowByteIndices( bool allow ) { m_AllowByteIndices = allow; }
+
+    GLenum GetIndexType() const { return m_IndexType; }
+
+    // The arena page or the own VBO. Meshes in the same page share it - it changes if the arena compacts the page
+    GLuint GetBufferId() const;
+
+    GLuint GetIndexBufferId() const;
+
+    // Format, index type and primitive as one small number. Meshes with the same id draw with the same GL state
+    unsigned GetStateId() const;
+
+    // Bytes Upload will transfer for builder. Estimate - the format might still fall back in Upload. Thread safe
+    std::size_t GetUploadSize( const MeshBuilder& builder ) const;
+
+    // Encodes the vertices into m_Format and uploads them with a single (staged) glBufferData
+    void Upload( const MeshBuilder& builder );
+
+    // Loads modelView (with the position decode scale folded in), enables the arrays, sets the vertex/normal/color
+    // pointers and draws - all through the GLStateCache
+    void Draw( const Matrix4& modelView ) const;
+
+    // Draws count instances. The caller binds the program and the per-instance attributes (see Instancer)
+    void DrawInstanced( GLsizei count ) const;
+
+    // Count, first index and base vertex of a command drawing this mesh. One instance from instance 0
+    void GetIndirectCommand( DrawElementsIndirectCommand& command ) const;
+
+    // glMultiDrawElementsIndirect of count commands at offset in the bound GL_DRAW_INDIRECT_BUFFER. The commands
+    // must draw from this mesh's buffers, with its state (GetStateId)
+    void DrawIndirect( GLintptr offset, GLsizei count ) const;
+
+    // Model space = stored position * decode scale. Not 1 for POSITION_SNORM16 only
+    float GetDecodeScale() const;
+};
+
+#endif /* MESH_H_ */
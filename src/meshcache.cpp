@@ -0,0 +1,106 @@
+/*
+ * meshcache.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "meshcache.h"
+
+#include <cstring>
+
+uint64_t MakeShapeKey( const char* primitive, std::initializer_list< float > params )
+{
+    // FNV-1a over the name and the raw parameter bits
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash]( unsigned char byte ) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    for ( const char* c = primitive; *c; ++c ) {
+        add( *c );
+    }
+    for ( float param : params ) {
+        unsigned char bytes[ sizeof( float ) ];
+        memcpy( bytes, &param, sizeof( float ) );
+        for ( unsigned char byte : bytes ) {
+            add( byte );
+        }
+    }
+    return hash;
+}
+
+SharedMesh::SharedMesh( MeshBuilder::Topology topology )
+    : m_Geometry( topology )
+    , m_Prepared( false )
+    , m_UploadSize( 0 )
+    , m_Uploaded( false )
+{
+}
+
+bool SharedMesh::Prepare( const Generator& generate )
+{
+    boost::lock_guard< boost::mutex > lock( m_Mutex );
+    if ( m_Prepared ) {
+        return false;
+    }
+    generate( m_Geometry );
+    m_Bounds     = m_Geometry.ComputeBounds();
+    m_UploadSize = m_Mesh.GetUploadSize( m_Geometry );
+    m_Prepared = true;
+    return true;
+}
+
+void SharedMesh::Upload()
+{
+    if ( m_Uploaded ) {
+        return;
+    }
+    m_Mesh.Upload( m_Geometry );
+    // the GL has its copy - nobody needs ours anymore
+    m_Geometry = MeshBuilder( m_Geometry.GetTopology() );
+    m_Uploaded = true;
+}
+
+MeshCache::MeshCache()
+    : m_Hits(0)
+    , m_Misses(0)
+{
+}
+
+SharedMeshPtr MeshCache::Acquire( uint64_t key, MeshBuilder::Topology topology )
+{
+    boost::lock_guard< boost::mutex > lock( m_Mutex );
+    boost::weak_ptr< SharedMesh >& entry = m_Meshes[ key ];
+    SharedMeshPtr mesh = entry.lock();
+    if ( mesh ) {
+        ++m_Hits;
+        return mesh;
+    }
+    // new or expired - the last user of the old one is gone
+    ++m_Misses;
+    mesh.reset( new SharedMesh( topology ) );
+    entry = mesh;
+    return mesh;
+}
+
+std::size_t MeshCache::GetSize() const
+{
+    boost::lock_guard< boost::mutex > lock( m_Mutex );
+    std::size_t size(0);
+    for ( auto& entry : m_Meshes ) {
+        size += !entry.second.expired();
+    }
+    return size;
+}
+
+void MeshCache::Report( FILE* out ) const
+{
+    boost::lock_guard< boost::mutex > lock( m_Mutex );
+    fprintf( out, "Mesh cache: %u meshes generated for %u entities\n", unsigned( m_Misses ), unsigned( m_Hits + m_Misses ) );
+}
+
+MeshCache& MeshCache::GetDefault()
+{
+    static MeshCache sCache;
+    return sCache;
+}
@@ -0,0 +1,89 @@
+/*
+ * meshcache.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef MESHCACHE_H_
+#define MESHCACHE_H_
+
+#include "mesh.h"
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstdio>
+#include <initializer_list>
+#include <unordered_map>
+
+// Identifies generated geometry by primitive name and parameters. Entities with the same key have identical meshes
+uint64_t MakeShapeKey( const char* primitive, std::initializer_list< float > params );
+
+// Geometry shared by all entities of one shape: generated once, uploaded once. The CPU copy is dropped after upload.
+// Deleted with the last entity that references it - GL buffers go with it, so that must be the render thread
+class SharedMesh : boost::noncopyable
+{
+public:
+    typedef boost::function< void( MeshBuilder& ) > Generator;
+private:
+    boost::mutex      m_Mutex;          // Prepare
+    MeshBuilder       m_Geometry;       // empty after Upload
+    Mesh              m_Mesh;
+    Bounds            m_Bounds;         // of m_Geometry, kept after Upload
+    bool              m_Prepared;
+    std::size_t       m_UploadSize;
+    std::atomic< bool > m_Uploaded;
+public:
+    SharedMesh( MeshBuilder::Topology topology );
+
+    // Runs generate on the first call, later calls wait for it. True for the call that generated. Thread safe.
+    // A generator that throws leaves the mesh unprepared for the next caller
+    bool Prepare( const Generator& generate );
+
+    // Mesh::GetUploadSize of the generated geometry, 0 once uploaded - whoever calls Upload first pays. After Prepare
+    std::size_t GetUploadSize() const { return m_Uploaded ? 0 : m_UploadSize; }
+
+    // Uploads on the first call and frees the geometry. Render thread only
+    void Upload();
+
+    bool IsUploaded() const { return m_Uploaded; }
+
+    // Model space bounds of the generated geometry. After Prepare
+    const Bounds& GetBounds() const { return m_Bounds; }
+
+    const Mesh& GetMesh() const { return m_Mesh; }
+};
+
+typedef boost::shared_ptr< SharedMesh > SharedMeshPtr;
+
+// Refcounted meshes by shape key. The cache only holds weak references - a shape nobody uses anymore is gone
+class MeshCache : boost::noncopyable
+{
+    typedef std::unordered_map< uint64_t, boost::weak_ptr< SharedMesh > > MeshMap;
+
+    mutable boost::mutex m_Mutex;
+    MeshMap      m_Meshes;
+    std::size_t  m_Hits;
+    std::size_t  m_Misses;
+public:
+    MeshCache();
+
+    // The mesh of shape key, a new empty one if there is none. Thread safe
+    SharedMeshPtr Acquire( uint64_t key, MeshBuilder::Topology topology );
+
+    // Meshes still referenced by an entity. Thread safe
+    std::size_t GetSize() const;
+
+    void Report( FILE* out ) const;
+
+    static MeshCache& GetDefault();
+};
+
+#endif /* MESHCACHE_H_ */
@@ -0,0 +1,276 @@
+/*
+ * meshoptimizer.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "meshoptimizer.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+VertexCacheStats AnalyzeVertexCache( const IndexArray& indices, std::size_t numVertices, unsigned int cacheSize /*= 16*/ )
+{
+    VertexCacheStats stats = { 0, indices.size() / 3, 0, 0, 0 };
+
+    // FIFO: a vertex is in the cache if it was inserted less than cacheSize misses ago
+    std::vector< std::size_t > insertedAt( numVertices, 0 );
+    std::vector< bool > used( numVertices, false );
+    for ( auto index : indices ) {
+        BOOST_ASSERT( index < numVertices );
+        if ( !used[index] ) {
+            used[index] = true;
+            ++stats.vertices;
+        }
+        if ( insertedAt[index] == 0 || stats.transformed - insertedAt[index] >= cacheSize ) {
+            // 1 based, 0 = never seen
+            insertedAt[index] = ++stats.transformed;
+        }
+    }
+    if ( stats.triangles > 0 ) {
+        stats.acmr = float(stats.transformed) / stats.triangles;
+    }
+    if ( stats.vertices > 0 ) {
+        stats.atvr = float(stats.transformed) / stats.vertices;
+    }
+    return stats;
+}
+
+// Forsyth's tuning values
+static const int   sCacheSize       = 32;
+static const float sCacheDecayPower = 1.5f;
+static const float sLastTriScore    = 0.75f;
+static const float sValenceScale    = 2.0f;
+static const float sValencePower    = 0.5f;
+
+static float vertexScore( int cachePosition, unsigned int remaining )
+{
+    if ( remaining == 0 ) {
+        // no triangle left that needs it
+        return -1.0f;
+    }
+    float score(0);
+    if ( cachePosition >= 0 ) {
+        if ( cachePosition < 3 ) {
+            // used by the last triangle - fixed score so we don't favour one of its edges
+            score = sLastTriScore;
+        } else {
+            const float scaler = 1.0f / ( sCacheSize - 3 );
+            score = std::pow( 1.0f - ( cachePosition - 3 ) * scaler, sCacheDecayPower );
+        }
+    }
+    // boost vertices with few triangles left so we don't leave lonely triangles behind
+    score += sValenceScale * std::pow( float(remaining), -sValencePower );
+    return score;
+}
+
+void OptimizeVertexCache( IndexArray& indices, std::size_t numVertices )
+{
+    const std::size_t numTriangles = indices.size() / 3;
+    if ( numTriangles == 0 ) {
+        return;
+    }
+
+    // vertex -> triangle adjacency as one flat array
+    std::vector< unsigned int > offsets( numVertices + 1, 0 );
+    for ( auto index : indices ) {
+        BOOST_ASSERT( index < numVertices );
+        ++offsets[ index + 1 ];
+    }
+    for ( std::size_t v = 0; v < numVertices; ++v ) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector< unsigned int > remaining( numVertices, 0 );
+    std::vector< unsigned int > adjacency( indices.size() );
+    for ( std::size_t i = 0; i < indices.size(); ++i ) {
+        unsigned int v = indices[i];
+        adjacency[ offsets[v] + remaining[v]++ ] = i / 3;
+    }
+
+    std::vector< int >   cachePosition( numVertices, -1 );
+    std::vector< float > score( numVertices );
+    for ( std::size_t v = 0; v < numVertices; ++v ) {
+        score[v] = vertexScore( -1, remaining[v] );
+    }
+    std::vector< float > triangleScore( numTriangles );
+    for ( std::size_t t = 0; t < numTriangles; ++t ) {
+        triangleScore[t] = score[ indices[t*3] ] + score[ indices[t*3+1] ] + score[ indices[t*3+2] ];
+    }
+    std::vector< bool > emitted( numTriangles, false );
+
+    IndexArray output;
+    output.reserve( indices.size() );
+
+    // LRU cache, 3 extra slots for the vertices of the triangle just added
+    std::vector< unsigned int > cache, nextCache;
+    cache.reserve( sCacheSize + 3 );
+    nextCache.reserve( sCacheSize + 3 );
+
+    std::size_t scan(0);    // fallback: next triangle in input order that might not be emitted yet
+    std::size_t best(0);
+    for ( ;; ) {
+        emitted[best] = true;
+        const unsigned int* tri = &indices[ best*3 ];
+        output.insert( output.end(), tri, tri + 3 );
+
+        // the triangle's vertices move to the front of the cache, everything else shifts back
+        nextCache.assign( tri, tri + 3 );
+        for ( auto v : cache ) {
+            if ( v != tri[0] && v != tri[1] && v != tri[2] ) {
+                nextCache.push_back( v );
+            }
+        }
+        for ( int k = 0; k < 3; ++k ) {
+            // unlink the triangle from its vertices
+            unsigned int v = tri[k];
+            unsigned int* first = &adjacency[ offsets[v] ];
+            unsigned int* last  = first + remaining[v];
+            unsigned int* it    = std::find( first, last, (unsigned int)best );
+            if ( it != last ) {
+                *it = *(last - 1);
+                --remaining[v];
+            }
+        }
+
+        // rescore everything that was or is in the cache...
+        for ( std::size_t i = 0; i < nextCache.size(); ++i ) {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < (std::size_t)sCacheSize ? int(i) : -1;
+            float newScore = vertexScore( cachePosition[v], remaining[v] );
+            float delta = newScore - score[v];
+            score[v] = newScore;
+            for ( unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; ++a ) {
+                triangleScore[ adjacency[a] ] += delta;
+            }
+        }
+        if ( nextCache.size() > (std::size_t)sCacheSize ) {
+            nextCache.resize( sCacheSize );
+        }
+        cache.swap( nextCache );
+
+        // ...and pick the best triangle touching the cache
+        float bestScore(-1);
+        std::size_t next = numTriangles;
+        for ( auto v : cache ) {
+            for ( unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; ++a ) {
+                unsigned int t = adjacency[a];
+                if ( triangleScore[t] > bestScore ) {
+                    bestScore = triangleScore[t];
+                    next = t;
+                }
+            }
+        }
+
+        if ( next == numTriangles ) {
+            // dead end - continue with the next triangle in input order
+            while ( scan < numTriangles && emitted[scan] ) {
+                ++scan;
+            }
+            if ( scan == numTriangles ) {
+                break;
+            }
+            next = scan;
+        }
+        best = next;
+    }
+    indices.swap( output );
+}
+
+void OptimizeOverdraw( IndexArray& indices, const VertexArray& vertices, unsigned int cacheSize /*= 16*/ )
+{
+    const std::size_t numTriangles = indices.size() / 3;
+    if ( numTriangles == 0 ) {
+        return;
+    }
+
+    // cluster boundaries: triangles where all 3 vertices miss the FIFO cache
+    std::vector< std::size_t > clusters;
+    std::vector< std::size_t > insertedAt( vertices.size(), 0 );
+    std::size_t transformed(0);
+    for ( std::size_t t = 0; t < numTriangles; ++t ) {
+        int misses(0);
+        for ( int k = 0; k < 3; ++k ) {
+            unsigned int v = indices[ t*3 + k ];
+            BOOST_ASSERT( v < vertices.size() );
+            if ( insertedAt[v] == 0 || transformed - insertedAt[v] >= cacheSize ) {
+                insertedAt[v] = ++transformed;
+                ++misses;
+            }
+        }
+        if ( misses == 3 || t == 0 ) {
+            clusters.push_back( t );
+        }
+    }
+    clusters.push_back( numTriangles );
+
+    Vector center( 0, 0, 0 );
+    float totalArea(0);
+    std::vector< Vector > clusterCenter( clusters.size() - 1, Vector( 0, 0, 0 ) );
+    std::vector< Vector > clusterNormal( clusters.size() - 1, Vector( 0, 0, 0 ) );
+    for ( std::size_t c = 0; c + 1 < clusters.size(); ++c ) {
+        float clusterArea(0);
+        for ( std::size_t t = clusters[c]; t < clusters[c + 1]; ++t ) {
+            const Vector& a = vertices[ indices[t*3 + 0] ].position;
+            const Vector& b = vertices[ indices[t*3 + 1] ].position;
+            const Vector& d = vertices[ indices[t*3 + 2] ].position;
+            // area weighted: |normal| = 2 * area
+            Vector normal = b - a;
+            normal.Cross( d - a );
+            float area = normal.Magnitude();
+            Vector centroid = ( a + b + d ) * ( 1.0f/3 );
+            centroid[ Vector::W ] = 0;
+            clusterCenter[c] += centroid * area;
+            clusterNormal[c] += normal;
+            clusterArea += area;
+        }
+        center += clusterCenter[c];
+        totalArea += clusterArea;
+        if ( clusterArea > 0 ) {
+            clusterCenter[c] *= 1.0f / clusterArea;
+        }
+    }
+    if ( totalArea > 0 ) {
+        center *= 1.0f / totalArea;
+    }
+
+    // occlusion potential: the further out a cluster sits along its normal, the more likely it occludes others
+    std::vector< std::pair< float, std::size_t > > order( clusters.size() - 1 );
+    for ( std::size_t c = 0; c < order.size(); ++c ) {
+        Vector offset = clusterCenter[c] - center;
+        order[c] = std::make_pair( -offset.Dot( clusterNormal[c].Normalized() ), c );
+    }
+    // stable for a deterministic result on symmetric meshes
+    std::stable_sort( order.begin(), order.end(),
+        []( const std::pair< float, std::size_t >& a, const std::pair< float, std::size_t >& b ) { return a.first < b.first; } );
+
+    IndexArray output;
+    output.reserve( indices.size() );
+    for ( auto& entry : order ) {
+        std::size_t c = entry.second;
+        output.insert( output.end(), indices.begin() + clusters[c]*3, indices.begin() + clusters[c + 1]*3 );
+    }
+    indices.swap( output );
+}
+
+std::size_t OptimizeVertexFetch( VertexArray& vertices, IndexArray& indices )
+{
+    const unsigned int unused = ~0u;
+    std::vector< unsigned int > remap( vertices.size(), unused );
+    VertexArray output;
+    output.reserve( vertices.size() );
+    for ( auto& index : indices ) {
+        if ( index == RESTART_INDEX ) {
+            continue;
+        }
+        BOOST_ASSERT( index < vertices.size() );
+        if ( remap[index] == unused ) {
+            remap[index] = output.size();
+            output.push_back( vertices[index] );
+        }
+        index = remap[index];
+    }
+    vertices.swap( output );
+    return vertices.size();
+}
@@ -0,0 +1,38 @@
+/*
+ * meshoptimizer.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include "vertexformat.h"
+
+// Post-transform cache simulation results
+struct VertexCacheStats
+{
+    std::size_t transformed;    // cache misses = vertex shader invocations
+    std::size_t triangles;
+    std::size_t vertices;       // vertices referenced by the index array
+
+    float acmr;                 // average cache miss ratio: transformed / triangles. 0.5 is the best possible, 3 the worst
+    float atvr;                 // average transformed vertex ratio: transformed / vertices. 1 is optimal
+};
+
+// Replays the index array (triangle list) through a FIFO cache of cacheSize entries
+VertexCacheStats AnalyzeVertexCache( const IndexArray& indices, std::size_t numVertices, unsigned int cacheSize = 16 );
+
+// Reorders triangle lists for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void OptimizeVertexCache( IndexArray& indices, std::size_t numVertices );
+
+// Reorders the clusters OptimizeVertexCache produced so triangles facing away from the mesh center get drawn first
+// (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). Clusters start at cache misses,
+// so the cache hit rate stays about the same.
+void OptimizeOverdraw( IndexArray& indices, const VertexArray& vertices, unsigned int cacheSize = 16 );
+
+// Sorts vertices by first use in the index array and drops unreferenced vertices. Works on triangle lists and strips.
+// Returns the new vertex count
+std::size_t OptimizeVertexFetch( VertexArray& vertices, IndexArray& indices );
+
+#endif /* MESHOPTIMIZER_H_ */
@@ -0,0 +1,73 @@
+/*
+ * profiler.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+
+double Percentile( std::vector< double > samples, double p )
+{
+    if ( samples.empty() ) {
+        return 0;
+    }
+    // nearest rank - we sort a copy, this is only called for the report
+    std::size_t rank = std::size_t( p / 100.0 * ( samples.size() - 1 ) + 0.5 );
+    std::nth_element( samples.begin(), samples.begin() + rank, samples.end() );
+    return samples[ rank ];
+}
+
+FrameProfiler::FrameProfiler()
+    : m_Enabled(false)
+{
+}
+
+void FrameProfiler::Enable( bool enable, std::size_t expectedFrames /*= 0*/ )
+{
+    m_Enabled = enable;
+    // avoid re-allocations while measuring
+    for ( auto& samples : m_Samples ) {
+        samples.reserve( expectedFrames );
+    }
+    m_FrameSamples.reserve( expectedFrames );
+}
+
+double FrameProfiler::GetPercentile( Phase phase, double p ) const
+{
+    return Percentile( m_Samples[ phase ], p );
+}
+
+double FrameProfiler::GetFramePercentile( double p ) const
+{
+    return Percentile( m_FrameSamples, p );
+}
+
+const char* FrameProfiler::GetPhaseName( Phase phase )
+{
+    switch ( phase )
+    {
+    case PHASE_INIT:      return "init";
+    case PHASE_SORT:      return "sort";
+    case PHASE_TRANSFORM: return "transform";
+    case PHASE_CULL:      return "cull";
+    case PHASE_BATCH:     return "batch";
+    case PHASE_RENDER:    return "render";
+    case PHASE_SWAP:      return "swap";
+    case PHASE_DELETE:    return "delete";
+    default:              return "unknown";
+    }
+}
+
+void FrameProfiler::Report( FILE* out ) const
+{
+    fprintf( out, "Frames: %u\n", (unsigned)GetFrameCount() );
+    fprintf( out, "%-10s %12s %12s %12s\n", "phase", "p50 (us)", "p95 (us)", "p99 (us)" );
+    for ( int phase = 0; phase < MAX_PHASES; ++phase ) {
+        fprintf( out, "%-10s %12.2f %12.2f %12.2f\n", GetPhaseName( Phase(phase) ),
+                GetPercentile( Phase(phase), 50 ), GetPercentile( Phase(phase), 95 ), GetPercentile( Phase(phase), 99 ) );
+    }
+    fprintf( out, "%-10s %12.2f %12.2f %12.2f\n", "frame",
+            GetFramePercentile( 50 ), GetFramePercentile( 95 ), GetFramePercentile( 99 ) );
+}
@@ -0,0 +1,86 @@
+/*
+ * profiler.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Nearest rank percentile, p in [0..100]. 0 if there are no samples
+double Percentile( std::vector< double > samples, double p );
+
+// Collects per-frame timings of the render loop phases with sub-ms resolution.
+// Renderer::Run calls Mark() after each phase; the time since the previous mark is booked on that phase.
+class FrameProfiler
+{
+public:
+    enum Phase {
+        PHASE_INIT = 0,     // m_InitList drain
+        PHASE_SORT,         // render list re-sort
+        PHASE_TRANSFORM,    // animation, world and modelview matrices
+        PHASE_CULL,         // view frustum culling
+        PHASE_BATCH,        // instance collection and upload
+        PHASE_RENDER,       // render list traversal
+        PHASE_SWAP,         // SDL_GL_SwapBuffers (glFinish when headless)
+        PHASE_DELETE,       // F_DELETE sweep
+
+        MAX_PHASES
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+private:
+    bool               m_Enabled;
+    Clock::time_point  m_FrameStart;
+    Clock::time_point  m_LastMark;
+
+    // microseconds, one entry per frame
+    std::vector< double > m_Samples[ MAX_PHASES ];
+    std::vector< double > m_FrameSamples;
+public:
+    FrameProfiler();
+
+    void Enable( bool enable, std::size_t expectedFrames = 0 );
+
+    bool IsEnabled() const { return m_Enabled; }
+
+    void BeginFrame()
+    {
+        if ( m_Enabled ) {
+            m_FrameStart = m_LastMark = Clock::now();
+        }
+    }
+
+    void Mark( Phase phase )
+    {
+        if ( m_Enabled ) {
+            Clock::time_point now = Clock::now();
+            m_Samples[ phase ].push_back( std::chrono::duration< double, std::micro >( now - m_LastMark ).count() );
+            m_LastMark = now;
+        }
+    }
+
+    void EndFrame()
+    {
+        if ( m_Enabled ) {
+            m_FrameSamples.push_back( std::chrono::duration< double, std::micro >( m_LastMark - m_FrameStart ).count() );
+        }
+    }
+
+    std::size_t GetFrameCount() const { return m_FrameSamples.size(); }
+
+    // p in [0..100]. Returns microseconds
+    double GetPercentile( Phase phase, double p ) const;
+
+    double GetFramePercentile( double p ) const;
+
+    void Report( FILE* out ) const;
+
+    static const char* GetPhaseName( Phase phase );
+};
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,58 @@
+/*
+ * radixsort.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef RADIXSORT_H_
+#define RADIXSORT_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+// LSD radix sort on 64 bit keys, 8 bits per pass - O(n), stable. One scan builds all histograms up front, passes in
+// which every key has the same byte are skipped (draw keys have lots of those). scratch is resized to items.size()
+template< typename T, typename KeyFn >
+void RadixSort( std::vector< T >& items, std::vector< T >& scratch, KeyFn key )
+{
+    const std::size_t count = items.size();
+    if ( count < 2 ) {
+        return;
+    }
+    scratch.resize( count );
+
+    std::size_t histogram[ 8 ][ 256 ] = {};
+    for ( auto& item : items ) {
+        uint64_t k = key( item );
+        for ( int pass = 0; pass < 8; ++pass ) {
+            ++histogram[ pass ][ ( k >> ( pass * 8 ) ) & 0xff ];
+        }
+    }
+
+    T* src = &items[0];
+    T* dst = &scratch[0];
+    for ( int pass = 0; pass < 8; ++pass ) {
+        const int shift = pass * 8;
+        std::size_t* offsets = histogram[ pass ];
+        if ( offsets[ ( key( *src ) >> shift ) & 0xff ] == count ) {
+            continue;
+        }
+        std::size_t sum(0);
+        for ( int bucket = 0; bucket < 256; ++bucket ) {
+            std::size_t c = offsets[ bucket ];
+            offsets[ bucket ] = sum;
+            sum += c;
+        }
+        for ( std::size_t i = 0; i < count; ++i ) {
+            dst[ offsets[ ( key( src[i] ) >> shift ) & 0xff ]++ ] = src[i];
+        }
+        std::swap( src, dst );
+    }
+    if ( src != &items[0] ) {
+        items.swap( scratch );
+    }
+}
+
+#endif /* RADIXSORT_H_ */
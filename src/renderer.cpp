@@ -6,19 +6,41 @@
  */
 
 #include "renderer.h"
+#include "threadpool.h"
 #include "err.h"
 
 #include <SDL/SDL.h>
 
-#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+// Refits until the tree is this much looser than a fresh build
+static const float MAX_BVH_DEGRADATION = 2.0f;
 
 static bool compareEntityPtr( const EntityPtr& a, const EntityPtr& b )
 {
 	return a.get() == b.get();
 }
 
-Renderer::Renderer()
+Renderer::Renderer( Backend backend /*= BACKEND_WINDOW*/ )
 	: m_Terminate(false)
+	, m_Backend(backend)
+	, m_Width(0)
+	, m_Height(0)
+	, m_FrameLimit(0)
+	, m_Commands( boost::make_shared< CommandChannel >() )
+	, m_StagingSize(8*1024*1024)
+	, m_ArenaPageSize(4*1024*1024)
+	, m_Instancing(false)
+	, m_Indirect(false)
+	, m_Viewer(nullptr)
+	, m_Projection(nullptr)
+	, m_Culling(true)
+	, m_SpatialIndex(false)
+	, m_SpatialIndexStale(true)
+	, m_DetailLevels(false)
 #ifdef _WIN32
     , m_CurrentContext( nullptr )
     , m_CurrentDC( nullptr )
@@ -26,15 +48,32 @@ Renderer::Renderer()
 #ifdef __linux__
 	, m_CurrentContext( nullptr )
 #endif
+#ifdef HAVE_OSMESA
+	, m_OffscreenContext( nullptr )
+#endif
 {
 }
 
 Renderer::~Renderer()
 {
+    // prepare jobs still running must not wait for us
+    m_Commands->closed = true;
+#ifdef HAVE_OSMESA
+    if ( m_OffscreenContext ) {
+        OSMesaDestroyContext( m_OffscreenContext );
+    }
+#endif
 }
 
-void Renderer::Init()
+void Renderer::Init( int width, int height )
 {
+    m_Width  = width;
+    m_Height = height;
+
+    if ( m_Backend == BACKEND_HEADLESS ) {
+        // There is no window context to hand over. The offscreen context is created in InitGL from the render thread
+        return;
+    }
 #ifdef _WIN32
     m_CurrentContext = wglGetCurrentContext();
     m_CurrentDC      = wglGetCurrentDC();
@@ -60,17 +99,65 @@ void Renderer::Init()
 #endif
 }
 
-void Renderer::AddEntity( EntityPtr entity, int priority /*= 0*/  )
+void Renderer::Post( const CommandChannelPtr& channel, const Command& command )
 {
+    while ( !channel->queue.TryPush( command ) ) {
+        if ( channel->closed ) {
+            return;
+        }
+        boost::this_thread::yield();
+    }
+}
+
+void Renderer::AddEntity( EntityPtr entity, int priority /*= 0*/, const InitCallback& done /*= InitCallback()*/ )
+{
+    // set here rather than with CMD_ADD - a SetEntityOrder posted while the entity is being prepared must win.
+    // The render thread only reads it once the entity is in the render list
     entity->SetOrder( priority );
-    m_InitList.push_back( entity );
+    CommandChannelPtr channel = m_Commands;
+    UploadScheduler::Clock::time_point queued = UploadScheduler::Clock::now();
+    ThreadPool::GetDefault().Submit( [channel, entity, done, queued]() {
+        Command command = { Command::CMD_ADD, { entity, done, false, 0, queued } };
+        PendingEntity& pending = command.pending;
+        try {
+            pending.prepared = entity->Prepare();
+            if ( pending.prepared ) {
+                pending.bytes = entity->GetUploadSize();
+            }
+        }
+        catch ( std::exception &ex ) {
+            ShowError( ex.what(), "Exception in Entity::Prepare" );
+        }
+        catch ( ... ) {
+            ShowError( "Entity::Prepare failed with unknown error!", "Unknown Exception in Entity::Prepare" );
+        }
+        // failures are reported from the render thread as well - callers only need to deal with one thread
+        Post( channel, command );
+    } );
 }
 
 void Renderer::RemoveEntity( EntityPtr entity )
 {
-    entity->SetFlag( Entity::F_DELETE );
+    Command command = { Command::CMD_REMOVE, { entity }, 0 };
+    Post( m_Commands, command );
+}
+
+void Renderer::SetEntityOrder( EntityPtr entity, int priority )
+{
+    Command command = { Command::CMD_SET_ORDER, { entity }, priority };
+    Post( m_Commands, command );
+}
 
-//	m_DestroyList.push_back( entity );
+void Renderer::SetParent( EntityPtr child, EntityPtr parent )
+{
+    Command command = { Command::CMD_SET_PARENT, { child }, 0, parent };
+    Post( m_Commands, command );
+}
+
+void Renderer::Pick( int x, int y, const PickCallback& done )
+{
+    Command command = { Command::CMD_PICK, PendingEntity(), 0, EntityPtr(), x, y, done };
+    Post( m_Commands, command );
 }
 
 void Renderer::Terminate()
@@ -78,27 +165,65 @@ void Renderer::Terminate()
 	m_Terminate = true;
 }
 
+void Renderer::InitOffscreenContext()
+{
+#ifdef HAVE_OSMESA
+    // RGBA color buffer, 24 bit depth, 8 bit stencil - same as the window setup in App::Init
+    m_OffscreenContext = OSMesaCreateContextExt( OSMESA_RGBA, 24, 8, 0, nullptr );
+    ASSERT( m_OffscreenContext, "Error! Failed to create offscreen OSMesa context!" );
+
+    m_OffscreenBuffer.resize( m_Width * m_Height * 4 );
+    bool current = OSMesaMakeCurrent( m_OffscreenContext, &m_OffscreenBuffer[0], GL_UNSIGNED_BYTE, m_Width, m_Height );
+    ASSERT( current, "Error! Failed to bind %dx%d offscreen buffer!", m_Width, m_Height );
+#else
+    THROW( "Headless rendering not available. Build with -DHAVE_OSMESA and link against OSMesa." );
+#endif
+}
+
+void Renderer::SwapBuffers()
+{
+    if ( m_Backend == BACKEND_HEADLESS ) {
+        // Nothing to present. Wait for the frame to complete so frame times cover the actual GL work
+        glFinish();
+        return;
+    }
+    SDL_GL_SwapBuffers();
+}
+
 void Renderer::InitGL()
 {
     // This is important! Our renderer runs its own render thread
     // All
+    if ( m_Backend == BACKEND_HEADLESS ) {
+        InitOffscreenContext();
+    } else {
 #ifdef _WIN32
-    wglMakeCurrent(m_CurrentDC,m_CurrentContext);
+        wglMakeCurrent(m_CurrentDC,m_CurrentContext);
 #endif
 #ifdef __linux__
-    SDL_SysWMinfo wm_info;
-    SDL_VERSION( &wm_info.version );
-    if ( SDL_GetWMInfo( &wm_info ) ) {
-        // TODO: drag-n-drop for non win32
-        Display *display = wm_info.info.x11.gfxdisplay;
-        Window   window  = wm_info.info.x11.window;
-        glXMakeCurrent( display, window, m_CurrentContext );
-        XSync( display, false );
-    }
+        SDL_SysWMinfo wm_info;
+        SDL_VERSION( &wm_info.version );
+        if ( SDL_GetWMInfo( &wm_info ) ) {
+            // TODO: drag-n-drop for non win32
+            Display *display = wm_info.info.x11.gfxdisplay;
+            Window   window  = wm_info.info.x11.window;
+            glXMakeCurrent( display, window, m_CurrentContext );
+            XSync( display, false );
+        }
 #endif
+    }
     // Init GLEW - we need this to use OGL extensions (e.g. for VBOs)
-    GLenum err = glewInit();
+    GLenum err;
+    if ( m_Backend == BACKEND_HEADLESS ) {
+        // glewInit also loads the GLX extensions and fails without an X display. Resolve the GL ones only,
+        // against the offscreen context that is current now
+        err = glewContextInit();
+    } else {
+        err = glewInit();
+    }
     ASSERT( GLEW_OK == err, "Error: %s\n", glewGetErrorString(err) );
+    ASSERT( glGenBuffers && glBindBuffer && glBufferData,
+            "Error! GL entry points not resolved. Headless rendering needs GLEW built with GLEW_OSMESA." );
 
     glShadeModel(GL_SMOOTH);                    // shading mathod: GL_SMOOTH or GL_FLAT
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);      // 4-byte pixel alignment
@@ -134,10 +259,318 @@ void Renderer::InitGL()
 
     glEnable(GL_LIGHT0);                        // MUST enable each light source after configuration
 
+    // from here on client arrays, buffer bindings and array pointers go through the state cache
+    m_State.Invalidate();
+    GLStateCache::SetCurrent( &m_State );
+
+    // static geometry is streamed through a mapped ring buffer if the GL supports it
+    m_Staging.Init( m_StagingSize );
+    StagingBuffer::SetCurrent( &m_Staging );
+
+    // meshes share a few big buffers and draw with base vertex offsets
+    m_Arena.Init( m_ArenaPageSize );
+    BufferArena::SetCurrent( &m_Arena );
+
+    if ( m_Instancing && !m_Instancer.Init( m_Indirect ) ) {
+        fprintf( stderr, "Instancing not supported by this GL - drawing entities one by one\n" );
+        m_Instancing = false;
+    }
+}
+
+uint64_t Renderer::MakeSortKey( const Entity& entity )
+{
+    DrawInfo info;
+    entity.GetDrawInfo( info );
+    if ( info.projection ) {
+        m_Projection = info.projection;
+    }
+    float depth(0);
+    if ( info.hasPosition ) {
+        // keys are made before this frame's transforms - last frame's world position. Parents move their children,
+        // the entity's own position is only good until it has a world matrix
+        Vector position = entity.m_WorldValid ? entity.m_World.GetTranslation() : info.position;
+        if ( info.viewer ) {
+            // everybody else measures from here - from the next frame on, the list is in no particular order yet
+            m_Eye = position;
+            m_Viewer = &entity;
+        } else {
+            depth = ( position - m_Eye ).Magnitude();
+        }
+    }
+    return DrawKey::Make( info.layer, entity.GetOrder(), info.state, info.buffer, depth );
+}
+
+void Renderer::UpdateTransforms( long ticks )
+{
+    m_Transformed.clear();
+    m_WorldToggled.clear();
+    m_HasWorld.assign( m_RenderList.size(), false );
+    bool viewer(false);
+    Matrix4 local;
+    std::size_t index(0);
+    for( auto& item : m_RenderList ) {
+        Entity* entity = item.entity;
+        bool wasValid = entity->m_WorldValid;
+        entity->m_WorldValid = entity->AreFlagsSet( Entity::F_ENABLE ) && entity->UpdateTransform( ticks, local );
+        if ( entity->m_WorldValid != wasValid ) {
+            m_WorldToggled.push_back( entity );
+        }
+        if ( entity->m_WorldValid ) {
+            m_Scene.SetLocal( entity->m_Node, local );
+            m_Transformed.push_back( entity );
+            m_HasWorld[ index ] = true;
+            viewer |= entity == m_Viewer;
+        }
+        ++index;
+    }
+    // only subtrees with a changed local matrix
+    m_Scene.Update();
+
+    for ( Entity* entity : m_Transformed ) {
+        entity->m_World = m_Scene.GetWorld( entity->m_Node );
+    }
+    // the view undoes where the viewer sits
+    m_View.SetIdentity();
+    if ( viewer && !m_Viewer->GetWorld().Inverse( m_View ) ) {
+        m_View.SetIdentity();
+    }
+    for ( Entity* entity : m_Transformed ) {
+        Matrix4::Multiply( m_View, entity->m_World, entity->m_ModelView );
+    }
+}
+
+void Renderer::CullEntities()
+{
+    m_Culled.assign( m_RenderList.GetSlotCount(), false );
+    std::size_t enabled(0);
+    for( auto& item : m_RenderList ) {
+        enabled += item.entity->AreFlagsSet( Entity::F_ENABLE );
+    }
+    if ( m_SpatialIndex ) {
+        UpdateSpatialIndex();
+    }
+    if ( !m_Culling || !m_Projection ) {
+        m_Culler.Skip( enabled );
+        return;
+    }
+
+    // world space spheres - the planes come from the same view the modelview matrices were built with
+    m_Culler.Begin( *m_Projection * m_View );
+    if ( m_SpatialIndex ) {
+        m_Culler.Cull( m_Bvh, m_Culled, enabled );
+        return;
+    }
+    Bounds bounds;
+    Vector center;
+    float radius;
+    std::size_t index(0);
+    for( auto& item : m_RenderList ) {
+        if ( m_HasWorld[ index ] && item.entity->GetBounds( bounds ) ) {
+            bounds.GetWorldSphere( item.entity->GetWorld(), center, radius );
+            m_Culler.Add( RenderList::GetSlot( item.handle ), center, radius );
+        }
+        ++index;
+    }
+    m_Culler.Cull( m_Culled, enabled );
+}
+
+void Renderer::UpdateSpatialIndex()
+{
+    if ( m_SpatialIndexStale || m_Bvh.GetDegradation() > MAX_BVH_DEGRADATION ) {
+        // the only pass over the whole list - entities came or went, or the tree got too loose
+        m_WorldBoxes.assign( m_RenderList.GetSlotCount(), Box() );
+        Bounds bounds;
+        for( auto& item : m_RenderList ) {
+            if ( item.entity->m_WorldValid && item.entity->GetBounds( bounds ) ) {
+                m_WorldBoxes[ RenderList::GetSlot( item.handle ) ] = bounds.GetWorldBox( item.entity->GetWorld() );
+            }
+        }
+        m_Bvh.Build( m_WorldBoxes );
+        m_SpatialIndexStale = false;
+        return;
+    }
+
+    // only what the scene graph moved this frame - static entities cost nothing
+    Bounds bounds;
+    m_Scene.ForEachUpdated( [&]( SceneGraph::NodeId node ) {
+        uint32_t slot = m_NodeSlots[ node ];
+        const EntityPtr& entity = m_RenderList.GetSlotEntity( slot );
+        if ( !entity || !entity->m_WorldValid || !entity->GetBounds( bounds ) ) {
+            return;
+        }
+        if ( !m_Bvh.Contains( slot ) ) {
+            // had no world matrix at the last build
+            m_SpatialIndexStale = true;
+            return;
+        }
+        m_WorldBoxes[ slot ] = bounds.GetWorldBox( entity->GetWorld() );
+        m_Bvh.SetBounds( slot, m_WorldBoxes[ slot ] );
+    } );
+    // disabled entities keep their leaf with an empty box - out of all queries until they come back
+    for ( Entity* entity : m_WorldToggled ) {
+        uint32_t slot = RenderList::GetSlot( entity->GetRenderHandle() );
+        if ( !m_Bvh.Contains( slot ) ) {
+            m_SpatialIndexStale |= entity->m_WorldValid;
+            continue;
+        }
+        m_WorldBoxes[ slot ] = entity->m_WorldValid && entity->GetBounds( bounds ) ? bounds.GetWorldBox( entity->GetWorld() ) : Box();
+        m_Bvh.SetBounds( slot, m_WorldBoxes[ slot ] );
+    }
+    m_Bvh.Refit();
+}
+
+void Renderer::ProcessPicks()
+{
+    for ( const Command& pick : m_Picks ) {
+        EntityPtr hit;
+        float distance(0);
+        Matrix4 inverse;
+        if ( m_SpatialIndex && m_Projection && ( *m_Projection * m_View ).Inverse( inverse ) ) {
+            // window -> normalized device coordinates -> back through projection and view, on the near and far plane
+            float x = 2.0f * ( pick.x + 0.5f ) / m_Width - 1;
+            float y = 1 - 2.0f * ( pick.y + 0.5f ) / m_Height;
+            Vector nearPoint = inverse * Vector( x, y, -1 );
+            Vector farPoint  = inverse * Vector( x, y, 1 );
+            nearPoint *= 1 / nearPoint[ Vector::W ];
+            farPoint  *= 1 / farPoint[ Vector::W ];
+            Vector direction = farPoint - nearPoint;
+            float length = direction.Magnitude();
+            direction *= 1 / length;
+            Bvh::ItemId slot = m_Bvh.Raycast( nearPoint, direction, length, distance );
+            if ( slot != Bvh::INVALID_ITEM ) {
+                hit = m_RenderList.GetSlotEntity( slot );
+            }
+        }
+        if ( pick.picked ) {
+            pick.picked( hit, distance );
+        }
+    }
+    m_Picks.clear();
+}
+
+void Renderer::SelectDetail()
+{
+    if ( !m_DetailLevels || !m_Projection ) {
+        return;
+    }
+    m_Lod.Begin( *m_Projection, m_View, m_Height );
+    Bounds bounds;
+    Vector center;
+    float radius;
+    std::size_t index(0);
+    for( auto& item : m_RenderList ) {
+        Entity& entity = *item.entity;
+        if ( m_HasWorld[ index++ ] && !m_Culled[ RenderList::GetSlot( item.handle ) ] &&
+             entity.AreFlagsSet( Entity::F_ENABLE ) && entity.GetBounds( bounds ) ) {
+            bounds.GetWorldSphere( entity.GetWorld(), center, radius );
+            m_Lod.Selected( entity.SetScreenRadius( m_Lod.GetScreenRadius( center, radius ) ) );
+        }
+    }
+    m_Lod.End();
 }
 
-bool Renderer::CompareEntityPriorities( const EntityPtr& a, const EntityPtr& b ) {
-    return a->GetOrder() < b->GetOrder();
+void Renderer::ProcessCommands()
+{
+    m_Commands->queue.Drain( [this]( const Command& command ) {
+        const EntityPtr& entity = command.pending.entity;
+        switch ( command.type )
+        {
+        case Command::CMD_ADD:
+            m_Uploads.Queue( command.pending.bytes );
+            m_InitList.push_back( command.pending );
+            break;
+        case Command::CMD_REMOVE:
+            // removed after the next render - or dropped from the init list if it didn't make it that far
+            entity->SetFlag( Entity::F_DELETE );
+            if ( m_RenderList.IsValid( entity->GetRenderHandle() ) ) {
+                m_RemoveList.push_back( entity->GetRenderHandle() );
+            }
+            break;
+        case Command::CMD_SET_ORDER:
+            // the key follows with the next UpdateKeys
+            entity->SetOrder( command.order );
+            break;
+        case Command::CMD_SET_PARENT:
+            // remembered until both are in the render list
+            entity->m_ParentEntity = command.parent;
+            if ( entity->m_Node != SceneGraph::INVALID_NODE ) {
+                Attach( *entity );
+            }
+            break;
+        case Command::CMD_PICK:
+            m_Picks.push_back( command );
+            break;
+        }
+    } );
+}
+
+int Renderer::InitEntities()
+{
+    typedef UploadScheduler::Clock Clock;
+
+    int added(0);
+    m_Uploads.BeginFrame();
+    while ( !m_InitList.empty() ) {
+        PendingEntity& pending = m_InitList.front();
+        // first come first served - a big upload waits for a frame of its own instead of being overtaken forever.
+        // Asked again: a mesh this entity shares might have been uploaded by another one since it was prepared
+        std::size_t bytes = pending.prepared ? pending.entity->GetUploadSize() : 0;
+        if ( !m_Uploads.Admit( bytes ) ) {
+            break;
+        }
+        // only uploads that ran train the cost model - failed and removed entities took no time for their bytes
+        bool initialized(false);
+        if ( pending.prepared && !pending.entity->AreFlagsSet( Entity::F_DELETE ) ) {
+            Clock::time_point start = Clock::now();
+            initialized = pending.entity->Initialize();
+            if ( initialized ) {
+                m_Uploads.Uploaded( bytes, Clock::now() - start, pending.queued );
+            } else {
+                m_Uploads.Failed( Clock::now() - start );
+            }
+        }
+        m_Uploads.Dequeue( pending.bytes );
+        if ( initialized ) {
+            pending.entity->SetRenderHandle( m_RenderList.Add( pending.entity, MakeSortKey( *pending.entity ) ) );
+            pending.entity->m_Node = m_Scene.Add();
+            if ( pending.entity->m_Node >= m_NodeSlots.size() ) {
+                m_NodeSlots.resize( pending.entity->m_Node + 1 );
+            }
+            m_NodeSlots[ pending.entity->m_Node ] = RenderList::GetSlot( pending.entity->GetRenderHandle() );
+            Attach( *pending.entity );
+            m_SpatialIndexStale = true;
+            ++added;
+        }
+        // removed before its upload: neither added nor failed - the caller asked for it to go away
+        if ( pending.done && !pending.entity->AreFlagsSet( Entity::F_DELETE ) ) {
+            pending.done( pending.entity, initialized );
+        }
+        m_InitList.pop_front();
+    }
+    if ( added > 0 && !m_Unattached.empty() ) {
+        // some of the parents might have arrived
+        std::vector< Entity* > waiting;
+        waiting.swap( m_Unattached );
+        for ( Entity* entity : waiting ) {
+            Attach( *entity );
+        }
+    }
+    return added;
+}
+
+void Renderer::Attach( Entity& entity )
+{
+    EntityPtr parent = entity.m_ParentEntity.lock();
+    SceneGraph::NodeId node = parent ? parent->m_Node : SceneGraph::INVALID_NODE;
+    if ( parent && node == SceneGraph::INVALID_NODE && !parent->AreFlagsSet( Entity::F_DELETE ) ) {
+        if ( std::find( m_Unattached.begin(), m_Unattached.end(), &entity ) == m_Unattached.end() ) {
+            m_Unattached.push_back( &entity );
+        }
+        return;
+    }
+    if ( !m_Scene.SetParent( entity.m_Node, node ) ) {
+        fprintf( stderr, "Renderer: SetParent ignored - the parent is attached to the child\n" );
+    }
 }
 
 static void SendTerminate()
@@ -162,76 +595,150 @@ void Renderer::Run()
         InitGL();
 
         long ticks = SDL_GetTicks();
+        int frame(0);
         do {
-            // first step: iterate through a list of newly added entities and initialize them properly
-            //             Must be done in the context of the render thread.
-            //             Limit the number of initializations to 5 to not stall the render loop
-
-            int resort(0);
-            // max init 5 entities at one time to not stall the render loop forever
-            for ( int initLimit = 5; (m_InitList.size() > 0) && initLimit > 0; ++resort, --initLimit ) {
-                auto& entity = m_InitList.front();
-                entity->Initialize();
-                m_RenderList.push_back(entity);
-                m_InitList.pop_front();
-            }
+            m_Profiler.BeginFrame();
+            UploadScheduler::Clock::time_point frameStart = UploadScheduler::Clock::now();
 
-            // second step: If we added more than 1 entity, resort the render list
-
-            // only resort if we added more than one entity
-            if ( resort > 0 ) {
-                m_RenderList.sort( boost::bind( &Renderer::CompareEntityPriorities, this, _1, _2) );
+            // first step: apply what other threads queued (add/remove/order), then initialize
+            //             entities the thread pool has prepared (GL uploads)
+            //             Must be done in the context of the render thread.
+            //             Limited by the init budget to not stall the render loop. The upload scheduler
+            //             predicts each upload from its size
+
+            ProcessCommands();
+            InitEntities();
+            m_Profiler.Mark( FrameProfiler::PHASE_INIT );
+
+            // second step: rebuild the draw keys (layer, priority, state, buffer, depth) and resort.
+            //              Radix sort - O(n), and just a check if nothing moved
+            m_Viewer = nullptr;
+            m_Projection = nullptr;
+            m_RenderList.UpdateKeys( [this]( const Entity& entity ) { return MakeSortKey( entity ); } );
+            m_RenderList.Sort();
+            m_Profiler.Mark( FrameProfiler::PHASE_SORT );
+
+            // third step: animate, update the world matrices of the scene graph subtrees that moved, then
+            //             view * world for all of them in one pass. GL only gets the final modelview of each entity
+            long timeStamp = SDL_GetTicks();
+            UpdateTransforms( timeStamp - ticks );
+            m_Profiler.Mark( FrameProfiler::PHASE_TRANSFORM );
+
+            // fourth step: drop everything whose bounding sphere is outside the view frustum. Bounds are gathered
+            //              into SoA arrays and tested 4 at a time - or kept in a BVH that is refit and queried.
+            //              Picks need this frame's bounds as well
+            CullEntities();
+            ProcessPicks();
+            //              What is left picks its level of detail from its projected size. The draw keys follow
+            //              with the next sort
+            SelectDetail();
+            m_Profiler.Mark( FrameProfiler::PHASE_CULL );
+
+            // fifth step: render all entities
+
+            // Instanced entities are collected up front and uploaded in one go. Their draws go out when the
+            // traversal leaves their layer - layers still draw in order
+            if ( m_Instancing ) {
+                m_Batched.assign( m_RenderList.size(), false );
+                std::size_t index(0);
+                for( auto& item : m_RenderList ) {
+                    if ( item.entity->AreFlagsSet( Entity::F_ENABLE ) && !m_Culled[ RenderList::GetSlot( item.handle ) ] ) {
+                        m_Instancer.SetLayer( DrawKey::GetLayer( item.key ) );
+                        m_Batched[ index ] = item.entity->RenderInstanced( timeStamp - ticks, m_Instancer );
+                    }
+                    ++index;
+                }
+                m_Instancer.Build();
             }
-
-            // third step: render all entities
-
-            // No Scene graph, no nested objects, no tree...must unroll in reverse order (see below)
-            // DONT DO THIS. Just to keep it simple! Use a scene graph instead!
+            m_Profiler.Mark( FrameProfiler::PHASE_BATCH );
 
             // run list
-            long timeStamp = SDL_GetTicks();
-            for( auto& entity : m_RenderList ) {
-                if ( entity->AreFlagsSet( Entity::F_ENABLE ) ) {
-                    entity->Render( timeStamp - ticks );
+            DrawInfo::Layer layer = DrawInfo::LAYER_SETUP;
+            std::size_t index(0);
+            for( auto& item : m_RenderList ) {
+                bool batched = m_Instancing && m_Batched[ index++ ];
+                bool culled  = m_Culled[ RenderList::GetSlot( item.handle ) ];
+                if ( batched || culled || !item.entity->AreFlagsSet( Entity::F_ENABLE ) ) {
+                    continue;
+                }
+                if ( m_Instancing ) {
+                    DrawInfo::Layer itemLayer = DrawKey::GetLayer( item.key );
+                    if ( itemLayer != layer ) {
+                        // everything batched below this layer, also layers without per entity draws
+                        m_Instancer.Draw( DrawInfo::Layer( itemLayer - 1 ), m_View );
+                        layer = itemLayer;
+                    }
                 }
+                item.entity->Render( timeStamp - ticks );
+            }
+            if ( m_Instancing ) {
+                m_Instancer.Draw( DrawInfo::LAYER_OVERLAY, m_View );
+                m_Instancer.EndFrame();
             }
-            // fourth: swap the buffers
+            m_State.EndFrame();
+            m_Profiler.Mark( FrameProfiler::PHASE_RENDER );
+            m_Uploads.EndFrame( std::chrono::duration< double, std::micro >( UploadScheduler::Clock::now() - frameStart ).count() );
+            // sixth: swap the buffers
             // Swap the buffer
-            SDL_GL_SwapBuffers();
+            SwapBuffers();
+            m_Uploads.Presented();
             ticks = timeStamp;
+            m_Profiler.Mark( FrameProfiler::PHASE_SWAP );
 
             // remove after we are done with the rendering. Can't remove in first list since this would mess up PostRender
-            for( auto entity = m_RenderList.begin(); entity != m_RenderList.end(); ) {
-                // does this mess up my iterator?? - maybe not in reverse order
-                if ( (*entity)->AreFlagsSet( Entity::F_DELETE ) ) {
-                    entity = m_RenderList.erase( entity );
-                    continue;
+            // Only the entities we got a remove command for - no sweep over the whole list
+            for( auto handle : m_RemoveList ) {
+                Entity* entity = m_RenderList.Get( handle );
+                if ( entity ) {
+                    entity->SetRenderHandle( INVALID_RENDER_HANDLE );
+                    m_RenderList.Remove( handle );
+                    m_Scene.Remove( entity->m_Node );
+                    entity->m_Node = SceneGraph::INVALID_NODE;
+                    m_SpatialIndexStale = true;
+                    m_Unattached.erase( std::remove( m_Unattached.begin(), m_Unattached.end(), entity ), m_Unattached.end() );
                 }
-                ++entity;
             }
-
+            m_RemoveList.clear();
+            m_RenderList.Compact();
+            m_Profiler.Mark( FrameProfiler::PHASE_DELETE );
+            m_Profiler.EndFrame();
+
+            if ( m_FrameLimit > 0 && ++frame >= m_FrameLimit ) {
+                // tell the main thread we are done
+                m_Terminate = true;
+                SendTerminate();
+            }
         } while (!m_Terminate);
 
-        m_RenderList.clear();
+        m_InitList.clear();
+        m_RenderList.Clear();
+        m_Instancer.Release();
+        m_Arena.Release();
+        m_Staging.Release();
     }
     catch ( std::bad_alloc & ex ) {
         ShowError( ex.what(), "Memory Exception in Renderer" );
-        m_RenderList.clear();
+        m_RenderList.Clear();
         m_Terminate = true;
         SendTerminate();
     }
     catch ( std::exception &ex ) {
         ShowError( ex.what(), "Exception in Renderer" );
-        m_RenderList.clear();
+        m_RenderList.Clear();
         m_Terminate = true;
         SendTerminate();
     }
     catch ( ... ) {
         ShowError( "Renderer failed with unknown error!", "Unknown Exception inn Renderer" );
-        m_RenderList.clear();
+        m_RenderList.Clear();
         m_Terminate = true;
         SendTerminate();
     }
+    // nobody drains the queue from here on. Drop what's left, producers stop waiting
+    m_Commands->closed = true;
+    m_Commands->queue.Drain( []( const Command& ) {} );
+    BufferArena::SetCurrent( nullptr );
+    GLStateCache::SetCurrent( nullptr );
 }
 
 
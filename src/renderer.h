@@ -10,23 +10,132 @@
 
 #include "worker.h"
 #include "entity.h"
+#include "profiler.h"
+#include "uploadscheduler.h"
+#include "stagingbuffer.h"
+#include "bufferarena.h"
+#include "commandqueue.h"
+#include "renderlist.h"
+#include "glstate.h"
+#include "instancer.h"
+#include "scenegraph.h"
+#include "frustum.h"
+#include "bvh.h"
+#include "lod.h"
 
 #include <list>
 
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <GL/glew.h>
 #ifdef __linux__
 #include <GL/glx.h>
 #endif
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
 #include <SDL/SDL_syswm.h>
 
+#include <atomic>
+#include <vector>
+
 class Renderer : public Worker
 {
-	bool m_Terminate;
+public:
+    enum Backend {
+        BACKEND_WINDOW = 0,     // render into the SDL window via the WGL/GLX context created by SDL_SetVideoMode
+        BACKEND_HEADLESS        // render into an offscreen software context (OSMesa/llvmpipe) - no X server or GPU needed
+    };
+
+    // Reports the outcome of AddEntity: true once the entity is initialized and renders, false if Prepare or
+    // Initialize failed (the entity is dropped). Called on the render thread - keep it short
+    typedef boost::function< void( const EntityPtr&, bool ) > InitCallback;
+
+    // Reports the outcome of Pick: the nearest entity under the cursor and its distance from the near plane, an
+    // empty pointer if nothing was hit. Called on the render thread - keep it short
+    typedef boost::function< void( const EntityPtr&, float ) > PickCallback;
+private:
+    struct PendingEntity
+    {
+        EntityPtr    entity;
+        InitCallback done;
+        bool         prepared;
+        std::size_t  bytes;     // Entity::GetUploadSize after Prepare
+        UploadScheduler::Clock::time_point queued;  // AddEntity
+    };
+    typedef std::list< PendingEntity > PendingList;
+
+    // Everything other threads want from the render thread. Applied at the start of the next frame
+    struct Command
+    {
+        enum Type {
+            CMD_ADD = 0,        // entity is prepared - initialize it
+            CMD_REMOVE,         // flag entity F_DELETE
+            CMD_SET_ORDER,      // change the priority of entity
+            CMD_SET_PARENT,     // attach entity to parent's transform
+            CMD_PICK,           // ray cast from the eye through window coordinates x, y
+        };
+        Type          type;
+        PendingEntity pending;  // entity is set for all types but CMD_PICK, the rest for CMD_ADD only
+        int           order;    // CMD_SET_ORDER
+        EntityPtr     parent;   // CMD_SET_PARENT. Empty detaches
+        int           x, y;     // CMD_PICK
+        PickCallback  picked;   // CMD_PICK
+    };
+
+    // Shared with the prepare jobs, which might finish after the renderer is gone
+    struct CommandChannel
+    {
+        CommandQueue< Command > queue;
+        std::atomic< bool >     closed;     // nobody drains anymore - Post drops commands instead of waiting
+
+        CommandChannel() : queue( 4096 ), closed( false ) {}
+    };
+    typedef boost::shared_ptr< CommandChannel > CommandChannelPtr;
+
+	std::atomic< bool > m_Terminate;
+
+	Backend m_Backend;
+	int     m_Width;
+	int     m_Height;
+
+	int           m_FrameLimit;   // terminate after this many frames. 0 runs until Terminate()
+	FrameProfiler m_Profiler;
 
-    EntityList m_InitList;
-	EntityList m_RenderList;
-	EntityList m_DestroyList;
+	CommandChannelPtr m_Commands;
+	PendingList m_InitList;       // prepared, waiting for Initialize. Render thread only
+	UploadScheduler m_Uploads;    // how many Initialize calls fit into a frame
+	StagingBuffer   m_Staging;    // Mesh uploads go through this
+	GLStateCache    m_State;      // entities change GL state through this
+	GLsizeiptr      m_StagingSize;
+	BufferArena     m_Arena;      // static geometry is suballocated from this
+	GLsizeiptr      m_ArenaPageSize;
+	Instancer       m_Instancer;  // draws entities that support it in groups
+	bool            m_Instancing;
+	bool            m_Indirect;
+	std::vector< char > m_Batched;   // render list items the instancer draws this frame
+	RenderList m_RenderList;
+	std::vector< RenderHandle > m_RemoveList;    // removed after this frame is rendered
+	Vector     m_Eye;             // position of the DrawInfo::viewer entity, for the depth in the draw keys
+	const Entity* m_Viewer;       // the DrawInfo::viewer entity of this frame, nullptr if there is none
+	Matrix4    m_View;            // inverse world matrix of m_Viewer
+	std::vector< Entity* > m_Transformed;   // entities with a world matrix this frame
+	std::vector< char > m_HasWorld;  // the same by render list item
+	std::vector< Entity* > m_WorldToggled;  // gained or lost their world matrix this frame (enabled, disabled)
+	const Matrix4* m_Projection;  // the DrawInfo::projection of this frame, nullptr if there is none
+	Culler     m_Culler;
+	bool       m_Culling;
+	std::vector< char > m_Culled;    // render list slots outside the view frustum this frame
+	Bvh        m_Bvh;             // world boxes of the render list slots, for culling and picking
+	bool       m_SpatialIndex;
+	bool       m_SpatialIndexStale;  // entities came or went since the last build
+	std::vector< Box > m_WorldBoxes; // by render list slot, empty for entities without bounds
+	std::vector< uint32_t > m_NodeSlots;  // render list slot by scene graph node
+	std::vector< Command > m_Picks;  // CMD_PICK, answered once the frame's bounds are known
+	LodSelector m_Lod;
+	bool       m_DetailLevels;
+	SceneGraph m_Scene;           // a node per entity in the render list
+	std::vector< Entity* > m_Unattached;    // in the render list, waiting for their parent to get there
 
 #ifdef _WIN32
 	HGLRC       m_CurrentContext;
@@ -35,28 +144,151 @@ class Renderer : public Worker
 #ifdef __linux__
 	GLXContext   m_CurrentContext;
 #endif
+#ifdef HAVE_OSMESA
+	OSMesaContext m_OffscreenContext;
+#endif
+	std::vector< unsigned char > m_OffscreenBuffer;
 
 public:
-	Renderer();
+	Renderer( Backend backend = BACKEND_WINDOW );
 
 	virtual ~Renderer();
 
-	void Init();
+	void Init( int width, int height );
+
+	Backend GetBackend() const { return m_Backend; }
+
+	// Must be set before the render thread starts
+	void SetFrameLimit( int frames ) { m_FrameLimit = frames; }
+
+	// Time per frame the render thread spends on Initialize (GL uploads). At least one entity is initialized per frame
+	// regardless. Must be set before the render thread starts
+	void SetInitBudget( unsigned microseconds ) { m_Uploads.SetBudget( microseconds ); }
+
+	// Shrinks the init budget to what the previous frame left of this frame time. 0 (default) always uses the full
+	// budget. Must be set before the render thread starts
+	void SetTargetFrameTime( unsigned microseconds ) { m_Uploads.SetTargetFrameTime( microseconds ); }
+
+	// Size of the ring Mesh uploads are staged through. 0 uploads directly. Must be set before the render thread starts
+	void SetStagingSize( GLsizeiptr bytes ) { m_StagingSize = bytes; }
+
+	// Size of the buffers static geometry is suballocated from. 0 gives every mesh buffers of its own. Must be set
+	// before the render thread starts
+	void SetArenaPageSize( GLsizeiptr bytes ) { m_ArenaPageSize = bytes; }
+
+	// Draw Sphere/Cylinder entities of the same shape with one instanced draw call. Falls back to a draw per entity
+	// if the GL can't. Must be set before the render thread starts
+	void SetInstancing( bool enable ) { m_Instancing = enable; }
+
+	// Submit the instanced groups with multi-draw indirect: one call per layer and compatible buffers instead of one
+	// per shape. Needs GL 4.3 or GL_ARB_multi_draw_indirect + GL_ARB_base_instance, falls back to instanced draws.
+	// Only with instancing. Must be set before the render thread starts
+	void SetIndirect( bool enable ) { m_Indirect = enable; }
+
+	// Skip entities whose bounding sphere is outside the view frustum (on by default). Needs an entity with a
+	// DrawInfo::projection (the viewport). Must be set before the render thread starts
+	void SetCulling( bool enable ) { m_Culling = enable; }
+
+	// Keep the world boxes of all entities with bounds in a BVH: culling queries the tree instead of testing every
+	// entity, and Pick works. Must be set before the render thread starts
+	void SetSpatialIndex( bool enable ) { m_SpatialIndex = enable; }
+
+	// Hand every visible entity with bounds its projected size, so that entities with levels of detail can pick
+	// one. Needs the viewport like culling. Must be set before the render thread starts
+	void SetDetailLevels( bool enable ) { m_DetailLevels = enable; }
 
-	void AddEntity( EntityPtr entity, int priority = 0 );
+	// Only read after the render thread has been joined
+	FrameProfiler& GetProfiler() { return m_Profiler; }
+
+	// Only read after the render thread has been joined
+	const UploadScheduler& GetUploads() const { return m_Uploads; }
+
+	// Only read after the render thread has been joined
+	const StagingBuffer& GetStaging() const { return m_Staging; }
+
+	// Only read after the render thread has been joined
+	const GLStateCache& GetState() const { return m_State; }
+
+	// Only read after the render thread has been joined
+	const BufferArena& GetArena() const { return m_Arena; }
+
+	// Only read after the render thread has been joined
+	const Instancer& GetInstancer() const { return m_Instancer; }
+
+	// Only read after the render thread has been joined
+	const SceneGraph& GetScene() const { return m_Scene; }
+
+	// Only read after the render thread has been joined
+	const Culler& GetCuller() const { return m_Culler; }
+
+	// Only read after the render thread has been joined
+	const Bvh& GetSpatialIndex() const { return m_Bvh; }
+
+	// Only read after the render thread has been joined
+	const LodSelector& GetLodSelector() const { return m_Lod; }
+
+	// Prepare runs on the thread pool, Initialize on the render thread within the init budget. done reports the outcome:
+	// false if Prepare or Initialize failed. It isn't called for entities removed before they were initialized.
+	// AddEntity, RemoveEntity, SetEntityOrder and SetParent can be called from any thread. They take effect with the next frame
+	void AddEntity( EntityPtr entity, int priority = 0, const InitCallback& done = InitCallback() );
 
 	void RemoveEntity( EntityPtr entity );
+
+	void SetEntityOrder( EntityPtr entity, int priority );
+
+	// child's transform becomes relative to parent's (empty parent: to the world). Either may still be on its way into
+	// the render list. Ignored if parent is attached to child. Removing a parent hands its children to its own parent
+	void SetParent( EntityPtr child, EntityPtr parent );
+
+	// Finds the entity under window coordinates x, y (origin top left) with the next frame. Needs the spatial index
+	// and a viewport - done gets an empty pointer otherwise. Can be called from any thread
+	void Pick( int x, int y, const PickCallback& done );
 private:
 	void InitGL();
 
+	void InitOffscreenContext();
+
+	void SwapBuffers();
+
+	// Blocks only while the queue is full and the render thread still drains it
+	static void Post( const CommandChannelPtr& channel, const Command& command );
+
+	// Applies the queued commands
+	void ProcessCommands();
+
+	// Initializes entities from the init list as long as the upload scheduler
+	// predicts they fit into the init budget.
+	// Returns the number of entities added to the render list
+	int InitEntities();
+
 	// No direct access
 	virtual void Terminate();
 
 	virtual void Run();
 
 private:
-	// Need this in scope of class to have access to Entity::GetPriority() method
-	bool CompareEntityPriorities( const EntityPtr& a, const EntityPtr& b );
+	// Need this in scope of class to have access to Entity::GetOrder() method. Picks up the eye position from the viewer
+	uint64_t MakeSortKey( const Entity& entity );
+
+	// Entity::UpdateTransform for all enabled entities, the scene graph update, then the view and the modelview
+	// matrices
+	void UpdateTransforms( long ticks );
+
+	// Tests the bounds of all transformed entities against the frustum of the projection and the view. Fills m_Culled
+	void CullEntities();
+
+	// Keeps m_Bvh up to date: rebuilt over all entities if some came or went or the refits made the tree too
+	// loose, otherwise only the entities whose world matrix the scene graph recomputed are refit
+	void UpdateSpatialIndex();
+
+	// Answers m_Picks with a ray cast into m_Bvh
+	void ProcessPicks();
+
+	// Projected radius of every visible entity with bounds, from the projection and the view
+	void SelectDetail();
+
+	// Moves entity's node under its wanted parent, or onto m_Unattached if the parent isn't in the render list yet
+	void Attach( Entity& entity );
 
 };
 
@@ -0,0 +1,121 @@
+/*
+ * renderlist.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "renderlist.h"
+#include "err.h"
+#include "radixsort.h"
+
+#include <algorithm>
+
+RenderList::RenderList()
+    : m_FreeSlot( END_OF_LIST )
+    , m_Removed( 0 )
+    , m_Sorted( true )
+{
+}
+
+void RenderList::Reserve( std::size_t count )
+{
+    m_Items.reserve( count );
+    m_Slots.reserve( count );
+}
+
+RenderList::Handle RenderList::Add( const EntityPtr& entity, uint64_t key )
+{
+    uint32_t index = m_FreeSlot;
+    if ( index != END_OF_LIST ) {
+        m_FreeSlot = m_Slots[ index ].dense;
+    } else {
+        index = m_Slots.size();
+        ASSERT( index < END_OF_LIST, "Render list is full (%u entities)!", index );
+        Slot slot = { EntityPtr(), 0, 0 };
+        m_Slots.push_back( slot );
+    }
+    Slot& slot = m_Slots[ index ];
+    slot.entity = entity;
+    slot.dense  = m_Items.size();
+
+    Handle handle = index | ( slot.generation << INDEX_BITS );
+    Item item = { key, entity.get(), handle };
+    m_Items.push_back( item );
+    m_Sorted = m_Items.size() < 2 || ( m_Sorted && m_Items[ m_Items.size() - 2 ].key <= key );
+    return handle;
+}
+
+bool RenderList::IsValid( Handle handle ) const
+{
+    uint32_t index = GetIndex( handle );
+    return index < m_Slots.size() && m_Slots[ index ].entity && m_Slots[ index ].generation == GetGeneration( handle );
+}
+
+bool RenderList::Remove( Handle handle )
+{
+    if ( !IsValid( handle ) ) {
+        return false;
+    }
+    uint32_t index = GetIndex( handle );
+    Slot& slot = m_Slots[ index ];
+
+    // a gap until Compact - swapping the last item in would reorder entities with equal keys
+    m_Items[ slot.dense ].entity = nullptr;
+    ++m_Removed;
+
+    slot.entity.reset();
+    slot.generation = ( slot.generation + 1 ) & ( 0xffffffffu >> INDEX_BITS );
+    slot.dense = m_FreeSlot;
+    m_FreeSlot = index;
+    return true;
+}
+
+void RenderList::Compact()
+{
+    if ( !m_Removed ) {
+        return;
+    }
+    std::size_t dense(0);
+    for ( std::size_t i = 0; i < m_Items.size(); ++i ) {
+        if ( m_Items[i].entity ) {
+            m_Items[ dense ] = m_Items[i];
+            m_Slots[ GetIndex( m_Items[ dense ].handle ) ].dense = dense;
+            ++dense;
+        }
+    }
+    m_Items.resize( dense );
+    m_Removed = 0;
+}
+
+void RenderList::SetKey( Handle handle, uint64_t key )
+{
+    if ( IsValid( handle ) ) {
+        m_Items[ m_Slots[ GetIndex( handle ) ].dense ].key = key;
+        m_Sorted = false;
+    }
+}
+
+void RenderList::Sort()
+{
+    Compact();
+    // static scenes rebuild the same keys every frame
+    bool sorted = std::is_sorted( m_Items.begin(), m_Items.end(), []( const Item& a, const Item& b ) { return a.key < b.key; } );
+    if ( sorted ) {
+        m_Sorted = true;
+        return;
+    }
+    RadixSort( m_Items, m_Scratch, []( const Item& item ) { return item.key; } );
+    for ( std::size_t i = 0; i < m_Items.size(); ++i ) {
+        m_Slots[ GetIndex( m_Items[i].handle ) ].dense = i;
+    }
+    m_Sorted = true;
+}
+
+void RenderList::Clear()
+{
+    m_Items.clear();
+    m_Slots.clear();
+    m_FreeSlot = END_OF_LIST;
+    m_Removed = 0;
+    m_Sorted = true;
+}
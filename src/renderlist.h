@@ -0,0 +1,115 @@
+/*
+ * renderlist.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef RENDERLIST_H_
+#define RENDERLIST_H_
+
+#include "entity.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Entities the renderer draws, packed into one array in render order. Ownership (the shared_ptr) sits in a
+// separate slot table that is only touched on add/remove - traversal doesn't chase list nodes or touch refcounts.
+// Handles stay valid while other entities come and go; a removed entity's handle goes stale (generation check).
+// Removed entities leave a gap (null entity) in the array until Compact - traverse only after it.
+class RenderList
+{
+public:
+    typedef RenderHandle Handle;
+
+    struct Item
+    {
+        uint64_t key;       // render order, ascending
+        Entity  *entity;
+        Handle   handle;
+    };
+
+    typedef std::vector< Item >::const_iterator const_iterator;
+private:
+    enum {
+        INDEX_BITS = 24,
+        INDEX_MASK = ( 1 << INDEX_BITS ) - 1,
+        END_OF_LIST = INDEX_MASK,       // free list terminator
+    };
+
+    struct Slot
+    {
+        EntityPtr entity;
+        uint32_t  dense;        // position in m_Items. Next free slot while unused
+        uint32_t  generation;   // bumped on remove
+    };
+
+    std::vector< Item > m_Items;
+    std::vector< Item > m_Scratch;      // radix sort ping-pong buffer
+    std::vector< Slot > m_Slots;
+    uint32_t            m_FreeSlot;
+    std::size_t         m_Removed;      // gaps in m_Items
+    bool                m_Sorted;
+
+    static uint32_t GetIndex( Handle handle ) { return handle & INDEX_MASK; }
+
+    static uint32_t GetGeneration( Handle handle ) { return handle >> INDEX_BITS; }
+public:
+    RenderList();
+
+    void Reserve( std::size_t count );
+
+    Handle Add( const EntityPtr& entity, uint64_t key );
+
+    // Leaves a gap in place of the entity - the order of the others doesn't change. Returns false for stale handles
+    bool Remove( Handle handle );
+
+    // Closes the gaps of removed entities in one pass, keeping the order
+    void Compact();
+
+    bool IsValid( Handle handle ) const;
+
+    Entity* Get( Handle handle ) const { return IsValid( handle ) ? m_Items[ m_Slots[ GetIndex( handle ) ].dense ].entity : nullptr; }
+
+    void SetKey( Handle handle, uint64_t key );
+
+    // Small id of handle's entity, unique among the entities in the list. Reused after Remove. Less than GetSlotCount
+    static uint32_t GetSlot( Handle handle ) { return GetIndex( handle ); }
+
+    std::size_t GetSlotCount() const { return m_Slots.size(); }
+
+    // Empty if the slot is unused
+    const EntityPtr& GetSlotEntity( uint32_t slot ) const { return m_Slots[ slot ].entity; }
+
+    // Replaces every key with fn( entity )
+    template< typename Fn >
+    void UpdateKeys( Fn fn )
+    {
+        Compact();
+        for ( auto& item : m_Items ) {
+            item.key = fn( *item.entity );
+        }
+        m_Sorted = false;
+    }
+
+    // False after Add, SetKey or UpdateKeys
+    bool IsSorted() const { return m_Sorted; }
+
+    // Radix sort, stable - entities with equal keys keep their relative order. Cheap if the order didn't change.
+    // Compacts first
+    void Sort();
+
+    void Clear();
+
+    // Including the gaps before Compact
+    std::size_t size() const { return m_Items.size(); }
+
+    bool empty() const { return m_Items.empty(); }
+
+    const_iterator begin() const { return m_Items.begin(); }
+
+    const_iterator end() const { return m_Items.end(); }
+
+    const Item& operator[]( std::size_t i ) const { return m_Items[i]; }
+};
+
+#endif /* RENDERLIST_H_ */
@@ -0,0 +1,227 @@
+/*
+ * scenegraph.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "scenegraph.h"
+#include "threadpool.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+const SceneGraph::NodeId SceneGraph::INVALID_NODE;
+const uint32_t SceneGraph::NO_PARENT;
+
+SceneGraph::SceneGraph()
+    : m_ParallelThreshold(4096)
+    , m_Updated(0)
+    , m_TotalUpdated(0)
+    , m_TotalNodes(0)
+    , m_Updates(0)
+{
+}
+
+template< typename T >
+static void Rotate( std::vector< T >& v, uint32_t first, uint32_t middle, uint32_t last )
+{
+    std::rotate( v.begin() + first, v.begin() + middle, v.begin() + last );
+}
+
+void SceneGraph::Reindex( uint32_t first, const std::vector< NodeId >& parents )
+{
+    // parents come first - their index is already fixed when a child gets to it
+    for ( uint32_t i = first; i < m_Ids.size(); ++i ) {
+        m_Index[ m_Ids[i] ] = i;
+        NodeId parent = parents[ i - first ];
+        m_Parent[i] = parent == INVALID_NODE ? NO_PARENT : m_Index[ parent ];
+    }
+}
+
+void SceneGraph::AddToAncestors( uint32_t parent, int32_t count )
+{
+    for ( ; parent != NO_PARENT; parent = m_Parent[ parent ] ) {
+        m_Size[ parent ] += count;
+    }
+}
+
+void SceneGraph::Move( uint32_t first, uint32_t count, uint32_t to )
+{
+    BOOST_ASSERT( to <= first || to >= first + count );
+    uint32_t start = std::min( first, to );
+
+    // parent ids survive the reordering, parent indices don't
+    std::vector< NodeId > parents( m_Ids.size() - start );
+    for ( uint32_t i = start; i < m_Ids.size(); ++i ) {
+        parents[ i - start ] = m_Parent[i] == NO_PARENT ? INVALID_NODE : m_Ids[ m_Parent[i] ];
+    }
+
+    uint32_t middle, last;
+    if ( to <= first ) {
+        middle = first;
+        last   = first + count;
+    } else {
+        middle = first + count;
+        last   = to;
+    }
+    Rotate( m_Local,  start, middle, last );
+    Rotate( m_World,  start, middle, last );
+    Rotate( m_Size,   start, middle, last );
+    Rotate( m_Dirty,  start, middle, last );
+    Rotate( m_Ids,    start, middle, last );
+    std::rotate( parents.begin(), parents.begin() + ( middle - start ), parents.begin() + ( last - start ) );
+    Reindex( start, parents );
+}
+
+SceneGraph::NodeId SceneGraph::Add( NodeId parent /*= INVALID_NODE*/ )
+{
+    NodeId id;
+    if ( m_FreeIds.empty() ) {
+        id = m_Index.size();
+        m_Index.push_back( NO_PARENT );
+    } else {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    uint32_t index = m_Ids.size();
+    m_Local.push_back( Matrix4() );
+    m_World.push_back( Matrix4() );
+    m_Parent.push_back( NO_PARENT );
+    m_Size.push_back( 1 );
+    m_Dirty.push_back( 1 );
+    m_Ids.push_back( id );
+    m_Index[ id ] = index;
+
+    if ( parent != INVALID_NODE ) {
+        bool attached = SetParent( id, parent );
+        BOOST_ASSERT( attached );
+    }
+    return id;
+}
+
+void SceneGraph::Remove( NodeId node )
+{
+    uint32_t index  = m_Index[ node ];
+    uint32_t parent = m_Parent[ index ];
+    NodeId parentId = parent == NO_PARENT ? INVALID_NODE : m_Ids[ parent ];
+    AddToAncestors( parent, -1 );
+
+    // the children take node's place under its parent. Their world matrices change with that
+    std::vector< NodeId > parents( m_Ids.size() - index - 1 );
+    for ( uint32_t i = index + 1; i < m_Ids.size(); ++i ) {
+        parents[ i - index - 1 ] = m_Parent[i] == NO_PARENT ? INVALID_NODE : m_Ids[ m_Parent[i] ];
+        if ( m_Parent[i] == index ) {
+            parents[ i - index - 1 ] = parentId;
+            m_Dirty[i] = 1;
+        }
+    }
+    m_Local.erase( m_Local.begin() + index );
+    m_World.erase( m_World.begin() + index );
+    m_Parent.erase( m_Parent.begin() + index );
+    m_Size.erase( m_Size.begin() + index );
+    m_Dirty.erase( m_Dirty.begin() + index );
+    m_Ids.erase( m_Ids.begin() + index );
+    m_Index[ node ] = NO_PARENT;
+    m_FreeIds.push_back( node );
+    Reindex( index, parents );
+}
+
+bool SceneGraph::SetParent( NodeId node, NodeId parent )
+{
+    uint32_t index = m_Index[ node ];
+    uint32_t count = m_Size[ index ];
+    uint32_t to    = m_Ids.size();
+    if ( parent != INVALID_NODE ) {
+        uint32_t parentIndex = m_Index[ parent ];
+        if ( parentIndex >= index && parentIndex < index + count ) {
+            return false;
+        }
+        to = parentIndex + m_Size[ parentIndex ];
+    }
+
+    AddToAncestors( m_Parent[ index ], -int32_t( count ) );
+    // only the root of the moved subtree gets a new parent
+    m_Parent[ index ] = parent == INVALID_NODE ? NO_PARENT : m_Index[ parent ];
+    Move( index, count, to );
+
+    uint32_t moved = m_Index[ node ];
+    AddToAncestors( m_Parent[ moved ], count );
+    m_Dirty[ moved ] = 1;
+    return true;
+}
+
+SceneGraph::NodeId SceneGraph::GetParent( NodeId node ) const
+{
+    uint32_t parent = m_Parent[ m_Index[ node ] ];
+    return parent == NO_PARENT ? INVALID_NODE : m_Ids[ parent ];
+}
+
+void SceneGraph::SetLocal( NodeId node, const Matrix4& local )
+{
+    uint32_t index = m_Index[ node ];
+    // entities hand in their matrix every frame - only a changed one costs an update
+    if ( std::memcmp( (const float*)m_Local[ index ], (const float*)local, sizeof( Matrix4 ) ) != 0 ) {
+        m_Local[ index ] = local;
+        m_Dirty[ index ] = 1;
+    }
+}
+
+void SceneGraph::UpdateRange( uint32_t first, uint32_t last )
+{
+    for ( uint32_t i = first; i < last; ++i ) {
+        uint32_t parent = m_Parent[i];
+        if ( parent == NO_PARENT ) {
+            m_World[i] = m_Local[i];
+        } else {
+            Matrix4::Multiply( m_World[ parent ], m_Local[i], m_World[i] );
+        }
+        m_Dirty[i] = 0;
+    }
+}
+
+void SceneGraph::Update()
+{
+    // a dirty node takes its whole subtree with it. The parent of such a subtree is clean - subtrees are independent
+    m_Ranges.clear();
+    m_Updated = 0;
+    for ( uint32_t i = 0; i < m_Ids.size(); ) {
+        if ( m_Dirty[i] ) {
+            m_Ranges.push_back( i );
+            m_Ranges.push_back( i + m_Size[i] );
+            m_Updated += m_Size[i];
+            i += m_Size[i];
+        } else {
+            ++i;
+        }
+    }
+
+    int ranges = m_Ranges.size() / 2;
+    if ( m_ParallelThreshold > 0 && m_Updated >= m_ParallelThreshold && ranges > 1 ) {
+        ThreadPool& pool = ThreadPool::GetDefault();
+        int grain = std::max< int >( 1, ranges / ( 4 * ( pool.GetSize() + 1 ) ) );
+        pool.ParallelFor( 0, ranges, [this]( int first, int last ) {
+            for ( int range = first; range < last; ++range ) {
+                UpdateRange( m_Ranges[ range*2 ], m_Ranges[ range*2 + 1 ] );
+            }
+        }, grain );
+    } else {
+        for ( int range = 0; range < ranges; ++range ) {
+            UpdateRange( m_Ranges[ range*2 ], m_Ranges[ range*2 + 1 ] );
+        }
+    }
+
+    ++m_Updates;
+    m_TotalUpdated += m_Updated;
+    m_TotalNodes   += m_Ids.size();
+}
+
+void SceneGraph::Report( FILE* out ) const
+{
+    if ( !m_Updates ) {
+        return;
+    }
+    fprintf( out, "Scene graph: %.1f of %.1f world matrices updated per frame\n", double( m_TotalUpdated ) / m_Updates,
+            double( m_TotalNodes ) / m_Updates );
+}
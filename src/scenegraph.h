@@ -0,0 +1,110 @@
+/*
+ * scenegraph.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef SCENEGRAPH_H_
+#define SCENEGRAPH_H_
+
+#include "matrix.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <vector>
+
+// Parent/child transform hierarchy in flat arrays, depth first: parents come before their children and every
+// subtree is one contiguous range [index, index + size). Nodes keep a stable id while the arrays get reordered.
+// A node whose local matrix changed marks its whole subtree for Update - everything else keeps last frame's world
+// matrix. Independent dirty subtrees are updated in parallel on the ThreadPool when there are enough nodes.
+// Not thread safe
+class SceneGraph : boost::noncopyable
+{
+public:
+    typedef uint32_t NodeId;
+
+    static const NodeId INVALID_NODE = ~0u;
+private:
+    static const uint32_t NO_PARENT = ~0u;
+
+    // by index, depth first
+    std::vector< Matrix4 >  m_Local;
+    std::vector< Matrix4 >  m_World;
+    std::vector< uint32_t > m_Parent;   // index, NO_PARENT for roots
+    std::vector< uint32_t > m_Size;     // nodes in the subtree, the node itself included
+    std::vector< char >     m_Dirty;    // local changed since the last Update
+    std::vector< NodeId >   m_Ids;
+
+    // by id
+    std::vector< uint32_t > m_Index;    // NO_PARENT for unused ids
+    std::vector< NodeId >   m_FreeIds;
+
+    std::vector< uint32_t > m_Ranges;   // Update scratch: first, last of each dirty subtree
+
+    std::size_t m_ParallelThreshold;
+    std::size_t m_Updated;              // world matrices computed by the last Update
+    std::size_t m_TotalUpdated;
+    std::size_t m_TotalNodes;
+    unsigned    m_Updates;
+
+    // Moves count nodes starting at first to before index to (outside the moved range), fixing up all indices
+    void Move( uint32_t first, uint32_t count, uint32_t to );
+
+    // Indices from first on changed - rebuild the id map and the parent indices there
+    void Reindex( uint32_t first, const std::vector< NodeId >& parents );
+
+    void AddToAncestors( uint32_t parent, int32_t count );
+
+    void UpdateRange( uint32_t first, uint32_t last );
+public:
+    SceneGraph();
+
+    // New node with an identity local matrix, the last child of parent. A root if parent is INVALID_NODE
+    NodeId Add( NodeId parent = INVALID_NODE );
+
+    // The children of node move up to node's parent
+    void Remove( NodeId node );
+
+    // Moves node with its subtree to the end of parent's children (INVALID_NODE: make it a root). False if parent is
+    // node itself or one of its descendants
+    bool SetParent( NodeId node, NodeId parent );
+
+    NodeId GetParent( NodeId node ) const;
+
+    // Marks the subtree dirty if local differs from the current local matrix
+    void SetLocal( NodeId node, const Matrix4& local );
+
+    const Matrix4& GetLocal( NodeId node ) const { return m_Local[ m_Index[ node ] ]; }
+
+    // Parent's world * local, as of the last Update
+    const Matrix4& GetWorld( NodeId node ) const { return m_World[ m_Index[ node ] ]; }
+
+    // Recomputes the world matrices of all dirty subtrees
+    void Update();
+
+    // Dirty nodes from which Update goes parallel. 0 never does
+    void SetParallelThreshold( std::size_t nodes ) { m_ParallelThreshold = nodes; }
+
+    std::size_t GetSize() const { return m_Ids.size(); }
+
+    // World matrices computed by the last Update
+    std::size_t GetUpdated() const { return m_Updated; }
+
+    // Calls fn( node ) for every node the last Update recomputed. Until the next Add, Remove or SetParent
+    template< typename Fn >
+    void ForEachUpdated( Fn fn ) const
+    {
+        for ( std::size_t range = 0; range < m_Ranges.size(); range += 2 ) {
+            for ( uint32_t i = m_Ranges[ range ]; i < m_Ranges[ range + 1 ]; ++i ) {
+                fn( m_Ids[i] );
+            }
+        }
+    }
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* SCENEGRAPH_H_ */
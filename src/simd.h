@@ -0,0 +1,150 @@
+/*
+ * simd.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <cmath>
+
+// Thin wrapper around the 4-wide float registers of the target. Picks SSE (SSE4.1 if enabled) on x86 and NEON on ARM.
+// Build with -DVECTOR_NO_SIMD to force the plain scalar code (e.g. to compare against it)
+#if !defined(VECTOR_NO_SIMD)
+#   if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define SIMD_SSE 1
+#       include <emmintrin.h>
+#       if defined(__SSE4_1__) || defined(__AVX__)
+#           define SIMD_SSE4 1
+#           include <smmintrin.h>
+#       endif
+#       if defined(__AVX__)
+#           define SIMD_AVX 1
+#           include <immintrin.h>
+#       endif
+#   elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#       define SIMD_NEON 1
+#       include <arm_neon.h>
+#   endif
+#endif
+
+#if defined(SIMD_SSE) || defined(SIMD_NEON)
+#   define SIMD_ENABLED 1
+#endif
+
+#if defined(_MSC_VER)
+#   define SIMD_ALIGN( n ) __declspec( align( n ) )
+#else
+#   define SIMD_ALIGN( n ) __attribute__(( aligned( n ) ))
+#endif
+
+#ifdef SIMD_ENABLED
+namespace simd
+{
+#if defined(SIMD_SSE)
+    typedef __m128 float4;
+
+    // Unaligned loads: std::allocator doesn't guarantee 16 byte alignment for std::vector<Vector> on all our targets (MinGW 32bit).
+    // No penalty on aligned addresses on anything newer than Core2.
+    inline float4 load( const float* p ) { return _mm_loadu_ps( p ); }
+
+    inline void store( float* p, float4 v ) { _mm_storeu_ps( p, v ); }
+
+    inline float4 splat( float f ) { return _mm_set1_ps( f ); }
+
+    inline float4 add( float4 a, float4 b ) { return _mm_add_ps( a, b ); }
+
+    inline float4 sub( float4 a, float4 b ) { return _mm_sub_ps( a, b ); }
+
+    inline float4 mul( float4 a, float4 b ) { return _mm_mul_ps( a, b ); }
+
+    inline float4 min( float4 a, float4 b ) { return _mm_min_ps( a, b ); }
+
+    // x*x + y*y + z*z - same summation order as the scalar code
+    inline float dot3( float4 a, float4 b )
+    {
+#if defined(SIMD_SSE4)
+        return _mm_cvtss_f32( _mm_dp_ps( a, b, 0x71 ) );
+#else
+        float4 m = _mm_mul_ps( a, b );
+        float4 y = _mm_shuffle_ps( m, m, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+        float4 z = _mm_shuffle_ps( m, m, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+        return _mm_cvtss_f32( _mm_add_ss( _mm_add_ss( m, y ), z ) );
+#endif
+    }
+
+    // w is cleared
+    inline float4 cross3( float4 a, float4 b )
+    {
+        float4 a_yzx = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        float4 b_yzx = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        float4 a_zxy = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        float4 b_zxy = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+        float4 c = _mm_sub_ps( _mm_mul_ps( a_yzx, b_zxy ), _mm_mul_ps( a_zxy, b_yzx ) );
+        const float4 maskXYZ = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+        return _mm_and_ps( c, maskXYZ );
+    }
+
+    inline float sqrt1( float f ) { return _mm_cvtss_f32( _mm_sqrt_ss( _mm_set_ss( f ) ) ); }
+
+    // ~22 bit accurate 1/sqrt(f): hardware estimate + one Newton-Raphson step
+    inline float4 rsqrt( float4 f )
+    {
+        float4 y = _mm_rsqrt_ps( f );
+        float4 yyf = _mm_mul_ps( _mm_mul_ps( y, y ), f );
+        return _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), y ), _mm_sub_ps( _mm_set1_ps( 3.0f ), yyf ) );
+    }
+#elif defined(SIMD_NEON)
+    typedef float32x4_t float4;
+
+    inline float4 load( const float* p ) { return vld1q_f32( p ); }
+
+    inline void store( float* p, float4 v ) { vst1q_f32( p, v ); }
+
+    inline float4 splat( float f ) { return vdupq_n_f32( f ); }
+
+    inline float4 add( float4 a, float4 b ) { return vaddq_f32( a, b ); }
+
+    inline float4 sub( float4 a, float4 b ) { return vsubq_f32( a, b ); }
+
+    inline float4 mul( float4 a, float4 b ) { return vmulq_f32( a, b ); }
+
+    inline float4 min( float4 a, float4 b ) { return vminq_f32( a, b ); }
+
+    inline float dot3( float4 a, float4 b )
+    {
+        float4 m = vmulq_f32( a, b );
+        return vgetq_lane_f32( m, 0 ) + vgetq_lane_f32( m, 1 ) + vgetq_lane_f32( m, 2 );
+    }
+
+    // w is cleared
+    inline float4 cross3( float4 a, float4 b )
+    {
+        // {y,z,x,x} / {z,x,y,y} built from 64 bit halves: {x,y},{z,w}
+        float32x2_t a_xy = vget_low_f32( a ), a_zw = vget_high_f32( a );
+        float32x2_t b_xy = vget_low_f32( b ), b_zw = vget_high_f32( b );
+        float32x2_t a_yx = vrev64_f32( a_xy ), b_yx = vrev64_f32( b_xy );
+        float32x2_t a_zx = vset_lane_f32( vget_lane_f32( a_xy, 0 ), a_zw, 1 );
+        float32x2_t b_zx = vset_lane_f32( vget_lane_f32( b_xy, 0 ), b_zw, 1 );
+        float4 a_yzx = vcombine_f32( vext_f32( a_xy, a_zw, 1 ), vdup_lane_f32( a_xy, 0 ) );
+        float4 b_yzx = vcombine_f32( vext_f32( b_xy, b_zw, 1 ), vdup_lane_f32( b_xy, 0 ) );
+        float4 a_zxy = vcombine_f32( a_zx, vdup_lane_f32( a_yx, 0 ) );
+        float4 b_zxy = vcombine_f32( b_zx, vdup_lane_f32( b_yx, 0 ) );
+        float4 c = vsubq_f32( vmulq_f32( a_yzx, b_zxy ), vmulq_f32( a_zxy, b_yzx ) );
+        return vsetq_lane_f32( 0.0f, c, 3 );
+    }
+
+    inline float sqrt1( float f ) { return std::sqrt( f ); }
+
+    // ~23 bit accurate 1/sqrt(f): hardware estimate + one Newton-Raphson step
+    inline float4 rsqrt( float4 f )
+    {
+        float4 y = vrsqrteq_f32( f );
+        return vmulq_f32( y, vrsqrtsq_f32( vmulq_f32( f, y ), y ) );
+    }
+#endif
+}
+#endif /* SIMD_ENABLED */
+
+#endif /* SIMD_H_ */
@@ -1,14 +1,17 @@
 #include "sphere.h"
+#include "batch.h"
+#include "instancer.h"
+#include "threadpool.h"
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
+#include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 
-const int sCcolumns = 32;
-const int sRows    = 12;
-
 #ifndef M_PI
 #define M_PI 3.14159265358979323846f
 #endif
@@ -25,204 +28,193 @@ static Vector sColors[NUM_COLORS] = // Rainbow Of Colors
     {0.5f,0.5f,1.0f},{0.75f,0.5f,1.0f},{1.0f,0.5f,1.0f},{1.0f,0.5f,0.75f}
 };
 
-Sphere::Sphere( float radius /* = 1.0f */ )
-    : m_VboID(-1)
-    , m_IdxBufferID(-1)
-    , m_Stride(1) // needed if/when we pack color + vertex into one array
-    , m_VertexBuffer( sCcolumns*sRows*m_Stride )    // use the same memory pool for vertex and texture coords
-    , m_ColorBuffer( sCcolumns*sRows*m_Stride )
+Sphere::Sphere( float radius /* = 1.0f */, int columns /*= DEFAULT_COLUMNS*/, int rows /*= DEFAULT_ROWS*/,
+                MeshBuilder::Topology topology /*= MeshBuilder::TRIANGLES*/, int levels /*= 1*/ )
+    : m_Topology(topology)
     , m_Radius(radius)
+    , m_Columns(columns)
+    , m_Rows(rows)
     , m_Position( { 0, 0, 3 } )
     , m_Scale( { 1,1,1 } )
     , m_Rotation( { 0,0,0,0 } )
 {
-    // we might just want to create this in DoInitialize - and throw away the data we don't need locally
-    MakeSphere( sCcolumns, sRows );
+    BOOST_ASSERT( levels > 0 && ( columns >> ( levels - 1 ) ) >= 3 );
+    for ( int level = levels - 1; level >= 0; --level ) {
+        int levelColumns = columns >> level;
+        int levelRows    = std::max( 1, rows >> level );
+        m_Lod.AddLevel( MakeShapeKey( "sphere", { radius, float(levelColumns), float(levelRows), float(topology) } ), levelColumns );
+    }
 }
 
 Sphere::~Sphere()
 {
-    // shouldn't be done in d'tor...might be weakly linked to e.g. event handler...but vbo must be released from render thread
-    if ( m_VboID > 0 ) {
-        glDeleteBuffers(1, (GLuint*)&m_VboID);
-    }
-    if ( m_IdxBufferID > 0 ) {
-        glDeleteBuffers(1, (GLuint*)&m_IdxBufferID);
-    }
 }
 
-void Sphere::MakeSphere( float columns, float rows )
+void Sphere::MakeGeometry( MeshBuilder& geometry, float radius, int columns, int rows )
 {
-    std::vector< std::vector< Vector > > rings;
-
     const float RAD180 = M_PI; // PI in RAD
     const float RAD360 = M_PI*2; // 2*PI in RAD
 
     ++rows;
-    int lastColumn = columns - 1;
-    int lastRow = rows - 1;
-
-    // Add two extra vertices at center bottom and top
-    m_VertexBuffer.resize( columns*rows*m_Stride );
-    m_NormalBuffer.resize( columns*rows*m_Stride );
-    m_ColorBuffer.resize( columns*rows*m_Stride );
+    const int numColumns = columns;
+    const int numRows    = rows;
+    const int lastColumn = numColumns - 1;
+    const int lastRow    = numRows - 1;
+    const int numVertices = numColumns*numRows;
 
     // generate index array; we got rows * columns * 2 tris
-    m_IndexArray.resize( columns * rows * 3 * 2 ); // 3 vertices per tri, 2 tri per quad = 6 entries per iteration
-
-    auto vit = m_VertexBuffer.begin();
-    auto nit = m_NormalBuffer.begin();
-    auto cit = m_ColorBuffer.begin();
-    int looper(0);
-    int iv(0);
-
-    int numVertices = columns*rows;
+    const bool strips = geometry.GetTopology() == MeshBuilder::TRIANGLE_STRIP;
+    // strips: one per row, 2 indices per quad plus the closing column, separated by RESTART_INDEX
+    const int stripSize = ( numColumns + 1 ) * 2 + 1;
+    IndexArray& indexArray = geometry.GetIndices();
+    indexArray.resize( strips ? stripSize * numRows - 1 : numColumns * numRows * 3 * 2 ); // 3 vertices per tri, 2 tri per quad = 6 entries per iteration
+    VertexArray& vertices = geometry.GetVertices();
+    vertices.resize( numVertices );
 
     // from http://www.math.montana.edu/frankw/ccp/multiworld/multipleIVP/spherical/learn.htm
 
     // need one extra ring to close the gap (overlaps 0)
     float segmentAngle = RAD180/lastRow;
     float segmentSize  = RAD360/columns;
-    for( float y = 0; y < rows; ++y ){  //0-PI
-        std::vector< Vector > segments;
-        float theta = y * segmentAngle;
-        for( float x = 0; x < columns; ++x ) { //0-2PI
-            float phi = x * segmentSize;
-            // vertex
-            auto& vertex = *vit; ++vit;
-            vertex[ Vector::X ] = m_Radius * std::sin(phi) * std::cos(theta);
-            vertex[ Vector::Y ] = m_Radius * std::sin(phi) * std::sin(theta);
-            vertex[ Vector::Z ] = m_Radius * std::cos(phi);
-
-            // Add normal vectors - at vertex direction from center (-{0,0,0})
-            auto& normal = *nit; ++nit;
-            normal = vertex.Normalized();
 
+    // sin/cos once per column and ring instead of twice per vertex. Same float arguments as before -> same results
+    std::vector< float > sinPhi( numColumns ), cosPhi( numColumns ), sinTheta( numRows ), cosTheta( numRows );
+    for ( int x = 0; x < numColumns; ++x ) {
+        float phi = float(x) * segmentSize;
+        sinPhi[x] = std::sin(phi);
+        cosPhi[x] = std::cos(phi);
+    }
+    for ( int y = 0; y < numRows; ++y ) {
+        float theta = float(y) * segmentAngle;
+        sinTheta[y] = std::sin(theta);
+        cosTheta[y] = std::cos(theta);
+    }
+
+    // Rows are independent. Each chunk writes its own vertices and indices only - the result doesn't depend on the split
+    auto makeRows = [&]( int firstRow, int endRow ) {
+        const int first = firstRow * numColumns;
+        const int count = ( endRow - firstRow ) * numColumns;
+        // planar scratch buffers for the bulk normalize - interleaved into geometry below
+        VectorArray vertexBuffer( count );
+        VectorArray normalBuffer( count );
+
+        auto vit = vertexBuffer.begin();
+        for( int y = firstRow; y < endRow; ++y ){  //0-PI
+            for( int x = 0; x < numColumns; ++x ) { //0-2PI
+                // vertex
+                auto& vertex = *vit; ++vit;
+                vertex[ Vector::X ] = radius * sinPhi[x] * cosTheta[y];
+                vertex[ Vector::Y ] = radius * sinPhi[x] * sinTheta[y];
+                vertex[ Vector::Z ] = radius * cosPhi[x];
+
+                // vertices don't need to be set just yet. We just index them here
+
+                // this needs work: we use a row * col vertex and texture array
+                // to extract triangles, the index array needs to be calculated appropriately
+                //        0  1  2...n
+                //        +--+--+...
+                //        |\ |\ |
+                //        | \| \|
+                //        +--+--+
+                // n*y +  0' 1' 2'...(n+1)*y
+
+                // e.g. t[0] = { 0,1,1'} { 1',0',1 } ...
+                if ( strips ) {
+                    continue;
+                }
+                int looper = ( y*numColumns + x ) * 6;
+                // top tri
+                indexArray[ looper++ ] = ((x + 0) % lastColumn) + numColumns*((y+0) % numRows);  // 0x0
+                indexArray[ looper++ ] = ((x + 1) % lastColumn) + numColumns*((y+0) % numRows);  // 1x0
+                indexArray[ looper++ ] = ((x + 0) % lastColumn) + numColumns*((y+1) % numRows);  // 1x1 - bottom row
+
+                // bottom tri
+                indexArray[ looper++ ] = ((x + 1) % lastColumn) + numColumns*((y+0) % numRows);  // 0x0
+                indexArray[ looper++ ] = ((x + 1) % lastColumn) + numColumns*((y+1) % numRows);  // 0x1 - bottom row
+                indexArray[ looper++ ] = ((x + 0) % lastColumn) + numColumns*((y+1) % numRows);  // 1x1 - bottom row
+            }
+            if ( strips ) {
+                // one strip per row: 0' 0 1' 1 2' 2 ... - 2 indices per quad instead of 6. Same wrap around as above
+                int looper = y*stripSize;
+                for ( int x = 0; x <= numColumns; ++x ) {
+                    indexArray[ looper++ ] = (x % lastColumn) + numColumns*((y+1) % numRows);    // bottom row
+                    indexArray[ looper++ ] = (x % lastColumn) + numColumns*y;                    // top row
+                }
+                if ( y < lastRow ) {
+                    indexArray[ looper ] = RESTART_INDEX;
+                }
+            }
+        }
+
+        // Add normal vectors - at vertex direction from center (-{0,0,0})
+        batch::Normalize( &normalBuffer[0], &vertexBuffer[0], count );
+
+        for ( int i = 0; i < count; ++i ) {
+            Vertex& v = vertices[ first + i ];
+            v.position = vertexBuffer[i];
+            v.normal   = normalBuffer[i];
             // vertex color
-            auto& color = *cit; ++cit;
-            color = sColors[iv*NUM_COLORS/numVertices]; ++iv;
-
-            // vertices don't need to be set just yet. We just index them here
-
-            // this needs work: we use a row * col vertex and texture array
-            // to extract triangles, the index array needs to be calculated appropriately
-            //        0  1  2...n
-            //        +--+--+...
-            //        |\ |\ |
-            //        | \| \|
-            //        +--+--+
-            // n*y +  0' 1' 2'...(n+1)*y
-
-            // e.g. t[0] = { 0,1,1'} { 1',0',1 } ...
-            // top tri
-            int
-            idx = int((int(x + 0) % lastColumn) + columns *(int(y+0)%(int)rows)); m_IndexArray[ looper++ ] = idx;  // 0x0
-            idx = int((int(x + 1) % lastColumn) + columns *(int(y+0)%(int)rows)); m_IndexArray[ looper++ ] = idx;  // 1x0
-            idx = int((int(x + 0) % lastColumn) + columns *(int(y+1)%(int)rows)); m_IndexArray[ looper++ ] = idx;  // 1x1 - bottom row
-
-            // bottom tri
-            idx = int((int(x + 1) % lastColumn) + columns *(int(y+0)%(int)rows)); m_IndexArray[ looper++ ] = idx; // 0x0
-            idx = int((int(x + 1) % lastColumn) + columns *(int(y+1)%(int)rows)); m_IndexArray[ looper++ ] = idx; // 0x1 - bottom row
-            idx = int((int(x + 0) % lastColumn) + columns *(int(y+1)%(int)rows)); m_IndexArray[ looper++ ] = idx; // 1x1 - bottom row
+            v.color    = sColors[ (first + i)*NUM_COLORS/numVertices ];
         }
-    }
+    };
+
+    // small spheres aren't worth waking up the pool
+    const int minVerticesPerChunk = 16*1024;
+    ThreadPool::GetDefault().ParallelFor( 0, numRows, makeRows, std::max( 1, minVerticesPerChunk / numColumns ) );
 }
 
-bool Sphere::Initialize( )
+bool Sphere::Prepare()
 {
-    bool hasVBO  = glewGetExtension("GL_ARB_vertex_buffer_object");
-    ASSERT( hasVBO, "VBOs not supported!" );
-
-    glGenBuffers(1, (GLuint*)&m_VboID);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VboID);
-    int bufSize = sizeof(Vector)*m_VertexBuffer.size()
-                + sizeof(Vector)*m_NormalBuffer.size()
-                + sizeof(Vector)*m_ColorBuffer.size();
-    glBufferData(GL_ARRAY_BUFFER, bufSize, 0, GL_STATIC_DRAW);
-    std::size_t offset(0);
-    // Vertex buffer
-    float *vertices = (float*)&m_VertexBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_VertexBuffer.size(), vertices);
-    // Normal buffer
-    offset += sizeof(Vector)*m_VertexBuffer.size();
-    float *normals = (float*)&m_NormalBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_NormalBuffer.size(), normals);
-    // Color buffer
-    offset += sizeof(Vector)*m_NormalBuffer.size();
-    float *colors = (float*)&m_ColorBuffer[0];
-    glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(Vector)*m_ColorBuffer.size(), colors);
-
-    // Index Buffer
-    glGenBuffers(1, (GLuint*)&m_IdxBufferID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IdxBufferID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*m_IndexArray.size(), &m_IndexArray[0], GL_STATIC_DRAW);
-
-    // TODO: We can delete local storage here
+    int finest = int( m_Lod.GetLevelCount() ) - 1;
+    m_Lod.Prepare( m_Topology, [this, finest]( MeshBuilder& geometry, std::size_t level ) {
+        int coarser = finest - int( level );
+        MakeGeometry( geometry, m_Radius, m_Columns >> coarser, std::max( 1, m_Rows >> coarser ) );
+        geometry.Optimize();
+    } );
+    return true;
+}
 
+bool Sphere::Initialize( )
+{
+    // first sphere of its kind uploads, the local copy is dropped right after
+    m_Lod.Upload();
     return true;
 }
 
-void Sphere::Render( long ticks )
+void Sphere::GetDrawInfo( DrawInfo& info ) const
 {
-    // save the initial ModelView matrix before modifying ModelView matrix
-    glPushMatrix();
+    info.state       = m_Lod.GetMesh().GetStateId();
+    info.buffer      = m_Lod.GetMesh().GetBufferId();
+    info.hasPosition = true;
+    info.position    = m_Position;
+}
 
+bool Sphere::UpdateTransform( long ticks, Matrix4& local )
+{
     m_Rotation[ Vector::X ] += 45.0f * float(ticks) / 1000.0f;
     m_Rotation[ Vector::Y ] += 90.0f * float(ticks) / 1000.0f;
 
-    glTranslatef( m_Position[Vector::X], m_Position[Vector::Y], m_Position[Vector::Z] );
-    glScalef( m_Scale[Vector::X], m_Scale[Vector::Y], m_Scale[Vector::Z] );
-    glRotatef( m_Rotation[ Vector::X ], 1, 0, 0);
-    glRotatef( m_Rotation[ Vector::Y ], 0, 1, 0);
-    glRotatef( m_Rotation[ Vector::Z ], 0, 0, 1);
-
-    int vertexArrayEnabled;
-    glGetIntegerv( GL_VERTEX_ARRAY, &vertexArrayEnabled );
-    if (!vertexArrayEnabled) {
-        glEnableClientState(GL_VERTEX_ARRAY);
-    }
-    int normalArrayEnabled;
-    glGetIntegerv( GL_NORMAL_ARRAY, &normalArrayEnabled );
-    if ( !normalArrayEnabled )  {
-        glEnableClientState(GL_NORMAL_ARRAY);
-    }
-    int colorArrayEnabled;
-    glGetIntegerv( GL_COLOR_ARRAY, &colorArrayEnabled );
-    if ( !colorArrayEnabled) {
-        glEnableClientState(GL_COLOR_ARRAY);
-    }
-
-    int blend_enabled;
-    glGetIntegerv(GL_BLEND, &blend_enabled);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_VboID);
-    // before draw, specify vertex and index arrays with their offsets
-    std::size_t offset(0);
-    glVertexPointer(4, GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
-
-    offset += sizeof(Vector)*m_VertexBuffer.size();
-    glNormalPointer(GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
-
-    offset += sizeof(Vector)*m_NormalBuffer.size();
-    glColorPointer(4, GL_FLOAT, m_Stride*sizeof(Vector), (void*)offset);
+    local = Matrix4::Compose( m_Position, Quaternion::FromEuler( m_Rotation ), m_Scale );
+    return true;
+}
 
-    // use index array
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IdxBufferID);
-    glDrawElements( GL_TRIANGLES, m_IndexArray.size(), GL_UNSIGNED_INT, (void*)0 );
+bool Sphere::GetBounds( Bounds& bounds ) const
+{
+    // computed when the shared mesh was generated
+    bounds = m_Lod.GetBounds();
+    return true;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void Sphere::Render( long ticks )
+{
+    m_Lod.GetMesh().Draw( GetModelView() );
+}
 
-    if (!vertexArrayEnabled)  {
-        glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
-    }
-    if ( !normalArrayEnabled )  {
-        glDisableClientState(GL_NORMAL_ARRAY);
-    }
-    if ( !colorArrayEnabled) {
-        glDisableClientState(GL_COLOR_ARRAY);
-    }
 
-    glPopMatrix();
+bool Sphere::RenderInstanced( long ticks, Instancer& instancer )
+{
+    InstanceData instance = { {}, { 1, 1, 1, 1 } };
+    std::memcpy( instance.transform, (const float*)GetWorld(), sizeof( instance.transform ) );
+    instancer.Add( m_Lod.GetKey(), m_Lod.GetMesh(), instance );
+    return true;
 }
-
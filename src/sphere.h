@@ -4,6 +4,7 @@
 #include "err.h"
 #include "entity.h"
 #include "vector.h"
+#include "lod.h"
 
 #include <vector>
 
@@ -14,37 +15,50 @@ public:
         NORMAL,
         SPECULAR
     };
+    enum {
+        DEFAULT_COLUMNS = 32,
+        DEFAULT_ROWS    = 12
+    };
 
 private:
-    int  m_VboID;
-    int  m_IdxBufferID;
-
-    typedef std::vector<Vector> VertexArray;
-    typedef std::vector<Vector> ColorArray;
-    typedef std::vector<unsigned int> IndexArray;
-
-    int         m_Stride;
-    VertexArray m_VertexBuffer; // linear buffer
-    VertexArray m_NormalBuffer; // linear buffer
-    ColorArray  m_ColorBuffer;  // color buffer overlays Vertex Array
-    IndexArray  m_IndexArray;   // standard array to map vertices to tris
+    LodChain    m_Lod;          // meshes shared with all spheres of the same size and tessellation
+    MeshBuilder::Topology m_Topology;
 
     float       m_Radius;
+    int         m_Columns;      // of the finest level
+    int         m_Rows;
     Vector      m_Position;
     Vector      m_Scale;
     Vector      m_Rotation;
 public:
-    Sphere( float radius = 1.0f );
+    // levels: detail levels, each with half the columns and rows of the next finer one, down from columns x rows
+    Sphere( float radius = 1.0f, int columns = DEFAULT_COLUMNS, int rows = DEFAULT_ROWS,
+            MeshBuilder::Topology topology = MeshBuilder::TRIANGLES, int levels = 1 );
 
     virtual ~Sphere();
-private:
-    void MakeSphere( float meridians, float parallels );
+
+    // Generates the sphere into geometry, using geometry's topology. Thread safe - no GL involved
+    static void MakeGeometry( MeshBuilder& geometry, float radius, int columns, int rows );
 
 protected:
+    virtual bool Prepare();
+
+    virtual std::size_t GetUploadSize() const { return m_Lod.GetUploadSize(); }
+
+    virtual void GetDrawInfo( DrawInfo& info ) const;
+
     virtual bool Initialize( );
 
+    virtual bool UpdateTransform( long ticks, Matrix4& local );
+
+    virtual bool GetBounds( Bounds& bounds ) const;
+
+    virtual bool SetScreenRadius( float pixels ) { return m_Lod.Select( pixels ); }
+
     virtual void Render( long ticks );
 
+    virtual bool RenderInstanced( long ticks, Instancer& instancer );
+
     virtual bool HandleEvent( const SDL_Event& event ) { return false; }
 };
 
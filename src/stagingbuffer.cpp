@@ -0,0 +1,226 @@
+/*
+ * stagingbuffer.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "stagingbuffer.h"
+#include "err.h"
+
+#include <cstring>
+
+StagingBuffer *StagingBuffer::sCurrent = nullptr;
+
+// ring offsets are kept aligned for the copy engine
+static const GLsizeiptr ALIGNMENT = 64;
+
+StagingBuffer::StagingBuffer()
+    : m_BufferID(0)
+    , m_Mode(MODE_DIRECT)
+    , m_Size(0)
+    , m_Head(0)
+    , m_Mapped(nullptr)
+    , m_BytesStreamed(0)
+    , m_BytesDirect(0)
+    , m_Stalls(0)
+{
+}
+
+StagingBuffer::~StagingBuffer()
+{
+    // GL objects are gone with the context if Release wasn't called
+}
+
+void StagingBuffer::Init( GLsizeiptr size )
+{
+    Release();
+
+    m_Mode = MODE_DIRECT;
+    bool canCopy = glewGetExtension("GL_ARB_copy_buffer") && glewGetExtension("GL_ARB_map_buffer_range");
+    if ( size <= 0 || !canCopy ) {
+        return;
+    }
+    m_Size = size;
+    m_Head = 0;
+
+    glGenBuffers(1, &m_BufferID);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_BufferID);
+#ifdef GL_ARB_buffer_storage
+    if ( glewGetExtension("GL_ARB_buffer_storage") && glewGetExtension("GL_ARB_sync") ) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, m_Size, nullptr, flags);
+        m_Mapped = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, m_Size, flags);
+        if ( m_Mapped ) {
+            m_Mode = MODE_PERSISTENT;
+        } else {
+            // immutable storage can't be orphaned - start over with a mutable buffer
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &m_BufferID);
+            glGenBuffers(1, &m_BufferID);
+            glBindBuffer(GL_COPY_READ_BUFFER, m_BufferID);
+        }
+    }
+#endif
+    if ( m_Mode == MODE_DIRECT ) {
+        glBufferData(GL_COPY_READ_BUFFER, m_Size, nullptr, GL_STREAM_DRAW);
+        m_Mode = MODE_ORPHAN;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void StagingBuffer::Release()
+{
+    for ( auto& fence : m_Fences ) {
+        glDeleteSync( fence.sync );
+    }
+    m_Fences.clear();
+    if ( m_BufferID > 0 ) {
+        if ( m_Mapped ) {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_BufferID);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            m_Mapped = nullptr;
+        }
+        glDeleteBuffers(1, &m_BufferID);
+        m_BufferID = 0;
+    }
+    if ( sCurrent == this ) {
+        sCurrent = nullptr;
+    }
+    m_Mode = MODE_DIRECT;
+}
+
+void StagingBuffer::PopFence()
+{
+    Fence& fence = m_Fences.front();
+    GLenum status = glClientWaitSync( fence.sync, 0, 0 );
+    if ( status == GL_TIMEOUT_EXPIRED ) {
+        ++m_Stalls;
+        do {
+            status = glClientWaitSync( fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 ); // 1s
+        } while ( status == GL_TIMEOUT_EXPIRED );
+    }
+    glDeleteSync( fence.sync );
+    m_Fences.pop_front();
+}
+
+GLsizeiptr StagingBuffer::Allocate( GLsizeiptr size )
+{
+    if ( m_Head + size > m_Size ) {
+        // MODE_PERSISTENT: the skipped tail still has fences from the last lap, older than everything after the
+        // wrap. They have to go before the front can guard the region at 0
+        while ( !m_Fences.empty() && m_Fences.front().begin >= m_Head ) {
+            PopFence();
+        }
+        m_Head = 0;
+        if ( m_Mode == MODE_ORPHAN ) {
+            // fresh storage - the driver keeps the old one alive until pending copies are done
+            glBufferData(GL_COPY_READ_BUFFER, m_Size, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    GLsizeiptr offset = m_Head;
+    m_Head = ( offset + size + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 );
+
+    // MODE_PERSISTENT: regions are handed out in ring order, the oldest fences guard the region ahead of us
+    while ( !m_Fences.empty() && m_Fences.front().begin < offset + size && offset < m_Fences.front().end ) {
+        PopFence();
+    }
+    return offset;
+}
+
+bool StagingBuffer::Stage( GLsizeiptr size, const GLvoid* data, GLsizeiptr& offset )
+{
+    if ( m_Mode == MODE_DIRECT || size > m_Size || !data ) {
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_BufferID);
+    offset = Allocate( size );
+    if ( m_Mode == MODE_PERSISTENT ) {
+        std::memcpy( m_Mapped + offset, data, size );
+    } else {
+        // nothing in flight reads this range after an orphan - no need to sync
+        void* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, offset, size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if ( !mapped ) {
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return false;
+        }
+        std::memcpy( mapped, data, size );
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    }
+    return true;
+}
+
+void StagingBuffer::Copied( GLsizeiptr offset, GLsizeiptr size )
+{
+    if ( m_Mode == MODE_PERSISTENT ) {
+        Fence fence = { glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ), offset, offset + size };
+        m_Fences.push_back( fence );
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_BytesStreamed += size;
+}
+
+void StagingBuffer::BufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage )
+{
+    GLsizeiptr offset(0);
+    if ( !Stage( size, data, offset ) ) {
+        glBufferData(target, size, data, usage);
+        m_BytesDirect += size;
+        return;
+    }
+    // allocate the destination, then let the GPU copy
+    glBufferData(target, size, nullptr, usage);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, target, offset, 0, size);
+    Copied( offset, size );
+}
+
+void StagingBuffer::BufferSubData( GLenum target, GLintptr dest, GLsizeiptr size, const GLvoid* data )
+{
+    GLsizeiptr offset(0);
+    if ( !Stage( size, data, offset ) ) {
+        glBufferSubData(target, dest, size, data);
+        m_BytesDirect += size;
+        return;
+    }
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, target, offset, dest, size);
+    Copied( offset, size );
+}
+
+const char* StagingBuffer::GetModeName( Mode mode )
+{
+    switch ( mode )
+    {
+    case MODE_DIRECT:     return "direct";
+    case MODE_ORPHAN:     return "orphan";
+    case MODE_PERSISTENT: return "persistent";
+    default:              return "unknown";
+    }
+}
+
+void StagingBuffer::Report( FILE* out ) const
+{
+    fprintf( out, "Staging: %s, %u KB ring, %u KB streamed, %u KB direct, %u stalls\n", GetModeName( m_Mode ),
+            unsigned( m_Size / 1024 ), unsigned( m_BytesStreamed / 1024 ), unsigned( m_BytesDirect / 1024 ), m_Stalls );
+}
+
+void StagedBufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage )
+{
+    StagingBuffer* staging = StagingBuffer::GetCurrent();
+    if ( staging ) {
+        staging->BufferData( target, size, data, usage );
+    } else {
+        glBufferData(target, size, data, usage);
+    }
+}
+
+void StagedBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data )
+{
+    StagingBuffer* staging = StagingBuffer::GetCurrent();
+    if ( staging ) {
+        staging->BufferSubData( target, offset, size, data );
+    } else {
+        glBufferSubData(target, offset, size, data);
+    }
+}
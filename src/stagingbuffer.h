@@ -0,0 +1,94 @@
+/*
+ * stagingbuffer.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef STAGINGBUFFER_H_
+#define STAGINGBUFFER_H_
+
+#include <GL/glew.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdio>
+#include <deque>
+
+// Streams static buffer data through one mapped ring buffer and copies it into the destination on the GPU
+// (glCopyBufferSubData) instead of handing client memory to glBufferData. Render thread only
+class StagingBuffer : boost::noncopyable
+{
+public:
+    enum Mode {
+        MODE_DIRECT = 0,    // plain glBufferData - no GL_ARB_copy_buffer/GL_ARB_map_buffer_range
+        MODE_ORPHAN,        // ring is orphaned when full, mapped unsynchronized per upload
+        MODE_PERSISTENT,    // GL_ARB_buffer_storage: mapped once, ring regions guarded by fences (GL_ARB_sync)
+    };
+private:
+    struct Fence
+    {
+        GLsync     sync;
+        GLsizeiptr begin;
+        GLsizeiptr end;
+    };
+
+    GLuint         m_BufferID;
+    Mode           m_Mode;
+    GLsizeiptr     m_Size;
+    GLsizeiptr     m_Head;
+    unsigned char *m_Mapped;        // MODE_PERSISTENT only
+    std::deque< Fence > m_Fences;   // oldest first
+
+    std::size_t    m_BytesStreamed; // through the ring
+    std::size_t    m_BytesDirect;   // too big for the ring or MODE_DIRECT
+    unsigned       m_Stalls;        // waits for the GPU to release a ring region
+
+    static StagingBuffer *sCurrent;
+
+    // Waits for the GPU to pass the oldest fence and drops it
+    void PopFence();
+
+    // Returns the ring offset to write size bytes to. Waits for the GPU if the region is still in use
+    GLsizeiptr Allocate( GLsizeiptr size );
+
+    // Copies data into the ring and leaves it bound to GL_COPY_READ_BUFFER. False if it has to go direct
+    bool Stage( GLsizeiptr size, const GLvoid* data, GLsizeiptr& offset );
+
+    // After the copy out of the ring region was issued
+    void Copied( GLsizeiptr offset, GLsizeiptr size );
+public:
+    StagingBuffer();
+
+    ~StagingBuffer();
+
+    // Picks the best mode the current context supports and creates the ring. size 0 forces MODE_DIRECT
+    void Init( GLsizeiptr size );
+
+    // Must be called while the context is still current
+    void Release();
+
+    Mode GetMode() const { return m_Mode; }
+
+    // Same as glBufferData( target, size, data, usage ) for the buffer bound to target
+    void BufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage );
+
+    // Same as glBufferSubData( target, offset, size, data )
+    void BufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data );
+
+    void Report( FILE* out ) const;
+
+    static const char* GetModeName( Mode mode );
+
+    // Staging buffer of the render thread. nullptr uploads directly
+    static StagingBuffer* GetCurrent() { return sCurrent; }
+
+    static void SetCurrent( StagingBuffer* staging ) { sCurrent = staging; }
+};
+
+// glBufferData through the current staging buffer, if there is one
+void StagedBufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage );
+
+// glBufferSubData through the current staging buffer, if there is one
+void StagedBufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data );
+
+#endif /* STAGINGBUFFER_H_ */
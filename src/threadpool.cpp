@@ -0,0 +1,141 @@
+/*
+ * threadpool.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "threadpool.h"
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <exception>
+
+ThreadPool::ThreadPool( unsigned numThreads )
+    : m_Shutdown(false)
+    , m_MaxParallelism(numThreads)
+{
+    for ( unsigned i = 0; i < numThreads; ++i ) {
+        m_Threads.create_thread( boost::bind( &ThreadPool::WorkerLoop, this ) );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        boost::lock_guard< boost::mutex > lock( m_Mutex );
+        m_Shutdown = true;
+    }
+    m_Wake.notify_all();
+    m_Threads.join_all();
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+    static ThreadPool sPool( std::max( 2u, boost::thread::hardware_concurrency() ) - 1 );
+    return sPool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;) {
+        Job job;
+        {
+            boost::unique_lock< boost::mutex > lock( m_Mutex );
+            while ( m_Jobs.empty() && !m_Shutdown ) {
+                m_Wake.wait( lock );
+            }
+            if ( m_Jobs.empty() ) {
+                // shutdown and nothing left to do
+                return;
+            }
+            job = m_Jobs.front();
+            m_Jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::Submit( const Job& job )
+{
+    if ( m_Threads.size() == 0 ) {
+        job();
+        return;
+    }
+    {
+        boost::lock_guard< boost::mutex > lock( m_Mutex );
+        m_Jobs.push_back( job );
+    }
+    m_Wake.notify_one();
+}
+
+// Shared between the caller and the helper jobs. Helpers might only get to run after the caller finished all chunks
+struct ParallelForState
+{
+    ThreadPool::RangeJob fn;
+    int end;
+    int grain;
+    std::atomic< int > next;
+    std::atomic< int > pending;     // chunks not finished yet
+
+    boost::mutex mutex;
+    boost::condition_variable done;
+    std::exception_ptr error;
+
+    void Run()
+    {
+        for (;;) {
+            int first = next.fetch_add( grain );
+            if ( first >= end ) {
+                return;
+            }
+            try {
+                fn( first, std::min( first + grain, end ) );
+            }
+            catch ( ... ) {
+                boost::lock_guard< boost::mutex > lock( mutex );
+                if ( !error ) {
+                    error = std::current_exception();
+                }
+            }
+            if ( --pending == 0 ) {
+                boost::lock_guard< boost::mutex > lock( mutex );
+                done.notify_all();
+            }
+        }
+    }
+};
+
+void ThreadPool::ParallelFor( int begin, int end, const RangeJob& fn, int grain /*= 1*/ )
+{
+    if ( begin >= end ) {
+        return;
+    }
+    grain = std::max( grain, 1 );
+    int chunks = ( end - begin + grain - 1 ) / grain;
+    unsigned helpers = std::min( std::min( GetSize(), (unsigned)m_MaxParallelism ), unsigned( chunks - 1 ) );
+    if ( helpers == 0 ) {
+        fn( begin, end );
+        return;
+    }
+
+    boost::shared_ptr< ParallelForState > state = boost::make_shared< ParallelForState >();
+    state->fn      = fn;
+    state->end     = end;
+    state->grain   = grain;
+    state->next    = begin;
+    state->pending = chunks;
+    for ( unsigned i = 0; i < helpers; ++i ) {
+        Submit( boost::bind( &ParallelForState::Run, state ) );
+    }
+    state->Run();
+
+    boost::unique_lock< boost::mutex > lock( state->mutex );
+    while ( state->pending > 0 ) {
+        state->done.wait( lock );
+    }
+    if ( state->error ) {
+        std::rethrow_exception( state->error );
+    }
+}
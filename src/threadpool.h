@@ -0,0 +1,56 @@
+/*
+ * threadpool.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <deque>
+
+// Fixed set of worker threads for CPU side jobs (mesh generation etc.). Never touches GL
+class ThreadPool : boost::noncopyable
+{
+public:
+    typedef boost::function< void() > Job;
+
+    // fn( first, last ) processes the half open range [first, last)
+    typedef boost::function< void( int, int ) > RangeJob;
+private:
+    boost::thread_group m_Threads;
+    boost::mutex        m_Mutex;
+    boost::condition_variable m_Wake;
+    std::deque< Job >   m_Jobs;
+    bool                m_Shutdown;
+    std::atomic< unsigned > m_MaxParallelism;
+
+    void WorkerLoop();
+public:
+    explicit ThreadPool( unsigned numThreads );
+
+    // Finishes queued jobs, then joins the threads
+    ~ThreadPool();
+
+    // Shared pool with one thread less than the CPU has cores (at least one) - the thread calling ParallelFor does its share
+    static ThreadPool& GetDefault();
+
+    unsigned GetSize() const { return m_Threads.size(); }
+
+    // Caps the number of pool threads ParallelFor uses. 0 runs everything on the calling thread
+    void SetMaxParallelism( unsigned threads ) { m_MaxParallelism = threads; }
+
+    // Runs the job on the calling thread if the pool has no threads
+    void Submit( const Job& job );
+
+    // Splits [begin, end) into chunks of grain and runs them on the pool and the calling thread.
+    // Blocks until all chunks are done. The first exception thrown by fn is rethrown here
+    void ParallelFor( int begin, int end, const RangeJob& fn, int grain = 1 );
+};
+
+#endif /* THREADPOOL_H_ */
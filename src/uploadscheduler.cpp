@@ -0,0 +1,121 @@
+/*
+ * uploadscheduler.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "uploadscheduler.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+// Uploads below this are dominated by the per-upload overhead (buffer creation, validation) and train that part only
+static const std::size_t SMALL_UPLOAD = 4*1024;
+
+// Weight of a new measurement in the cost model
+static const double SMOOTHING = 0.25;
+
+UploadScheduler::UploadScheduler()
+    : m_Budget(2000)
+    , m_TargetFrameTime(0)
+    , m_Overhead(50)          // pessimistic until we measured something
+    , m_Throughput(1000)      // ~1 GB/s
+    , m_OtherWork(0)
+    , m_FrameBudget(0)
+    , m_Spent(0)
+    , m_FrameUploads(0)
+    , m_QueuedEntities(0)
+    , m_QueuedBytes(0)
+    , m_PeakQueuedBytes(0)
+    , m_Uploads(0)
+    , m_UploadedBytes(0)
+    , m_UploadFrames(0)
+{
+}
+
+void UploadScheduler::Queue( std::size_t bytes )
+{
+    ++m_QueuedEntities;
+    m_QueuedBytes += bytes;
+    m_PeakQueuedBytes = std::max( m_PeakQueuedBytes, m_QueuedBytes );
+}
+
+void UploadScheduler::BeginFrame()
+{
+    m_FrameBudget = m_Budget;
+    if ( m_TargetFrameTime > 0 ) {
+        m_FrameBudget = std::max( 0.0, std::min( m_FrameBudget, m_TargetFrameTime - m_OtherWork ) );
+    }
+    m_Spent = 0;
+    m_FrameUploads = 0;
+}
+
+bool UploadScheduler::Admit( std::size_t bytes ) const
+{
+    return m_FrameUploads == 0 || m_Spent + Estimate( bytes ) <= m_FrameBudget;
+}
+
+void UploadScheduler::Dequeue( std::size_t bytes )
+{
+    m_QueuedEntities -= std::min< std::size_t >( m_QueuedEntities, 1 );
+    m_QueuedBytes    -= std::min( m_QueuedBytes, bytes );
+}
+
+void UploadScheduler::Uploaded( std::size_t bytes, Clock::duration elapsed, Clock::time_point queued )
+{
+    double t = std::chrono::duration< double, std::micro >( elapsed ).count();
+    m_Spent += t;
+    if ( m_FrameUploads++ == 0 ) {
+        ++m_UploadFrames;
+    }
+
+    if ( bytes < SMALL_UPLOAD ) {
+        m_Overhead += SMOOTHING * ( t - m_Overhead );
+    } else {
+        // whatever exceeds the overhead is transfer. Clamped, a single fast upload shouldn't make everything look free
+        double throughput = double( bytes ) / std::max( t - m_Overhead, 1.0 );
+        m_Throughput += SMOOTHING * ( throughput - m_Throughput );
+    }
+
+    ++m_Uploads;
+    m_UploadedBytes += bytes;
+    m_Visible.push_back( queued );
+}
+
+void UploadScheduler::Failed( Clock::duration elapsed )
+{
+    m_Spent += std::chrono::duration< double, std::micro >( elapsed ).count();
+}
+
+void UploadScheduler::EndFrame( double frameTime )
+{
+    m_OtherWork = std::max( 0.0, frameTime - m_Spent );
+}
+
+void UploadScheduler::Presented()
+{
+    if ( m_Visible.empty() ) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    for ( auto& queued : m_Visible ) {
+        m_Latencies.push_back( std::chrono::duration< double, std::micro >( now - queued ).count() );
+    }
+    m_Visible.clear();
+}
+
+double UploadScheduler::GetLatencyPercentile( double p ) const
+{
+    return Percentile( m_Latencies, p );
+}
+
+void UploadScheduler::Report( FILE* out ) const
+{
+    fprintf( out, "Uploads: %u entities, %u KB in %u frames (%u KB queued, peak %u KB)\n",
+            unsigned( m_Uploads ), unsigned( m_UploadedBytes / 1024 ), unsigned( m_UploadFrames ),
+            unsigned( m_QueuedBytes / 1024 ), unsigned( m_PeakQueuedBytes / 1024 ) );
+    fprintf( out, "Upload cost: %.2f us + %.2f MB/s\n", m_Overhead, m_Throughput );
+    fprintf( out, "%-8s %12s %12s %12s\n", "latency", "p50 (us)", "p95 (us)", "p99 (us)" );
+    fprintf( out, "%-8s %12.2f %12.2f %12.2f\n", "visible",
+            GetLatencyPercentile( 50 ), GetLatencyPercentile( 95 ), GetLatencyPercentile( 99 ) );
+}
@@ -0,0 +1,94 @@
+/*
+ * uploadscheduler.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef UPLOADSCHEDULER_H_
+#define UPLOADSCHEDULER_H_
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Decides how many entity uploads fit into a frame. Every upload is predicted from its size in bytes with a cost model
+// (fixed overhead + bytes / throughput) that learns from the measured upload times. Render thread only.
+class UploadScheduler
+{
+public:
+    typedef std::chrono::high_resolution_clock Clock;
+private:
+    unsigned    m_Budget;           // microseconds per frame at most
+    unsigned    m_TargetFrameTime;  // microseconds. 0 always uses the full budget
+
+    // cost model
+    double      m_Overhead;         // microseconds per upload
+    double      m_Throughput;       // bytes per microsecond
+
+    // current frame
+    double      m_OtherWork;        // microseconds the previous frame spent on everything but uploads
+    double      m_FrameBudget;
+    double      m_Spent;
+    unsigned    m_FrameUploads;
+    std::vector< Clock::time_point > m_Visible;  // queue times of entities uploaded this frame
+
+    // stats
+    std::size_t m_QueuedEntities;
+    std::size_t m_QueuedBytes;
+    std::size_t m_PeakQueuedBytes;
+    std::size_t m_Uploads;
+    std::size_t m_UploadedBytes;
+    std::size_t m_UploadFrames;     // frames with at least one upload
+    std::vector< double > m_Latencies;  // microseconds from AddEntity to the first frame presented with the entity
+public:
+    UploadScheduler();
+
+    void SetBudget( unsigned microseconds ) { m_Budget = microseconds; }
+
+    unsigned GetBudget() const { return m_Budget; }
+
+    // Frame time to hold: uploads get what the previous frame left of it, capped by the budget
+    void SetTargetFrameTime( unsigned microseconds ) { m_TargetFrameTime = microseconds; }
+
+    // Entity prepared and waiting for its upload
+    void Queue( std::size_t bytes );
+
+    void BeginFrame();
+
+    // True if an upload of bytes is predicted to fit into what's left of the frame budget. The first upload
+    // of a frame always fits - otherwise a single upload larger than the budget would never happen
+    bool Admit( std::size_t bytes ) const;
+
+    // An entity queued with bytes left the queue - uploaded, failed or removed
+    void Dequeue( std::size_t bytes );
+
+    // Books a successful upload and feeds the measured time into the cost model. queued: time the entity was added
+    void Uploaded( std::size_t bytes, Clock::duration elapsed, Clock::time_point queued );
+
+    // An upload that failed: takes its time from the frame budget but doesn't train the cost model
+    void Failed( Clock::duration elapsed );
+
+    // Frame work so far (microseconds since BeginFrame) - sizes the next frame's budget against the target frame time
+    void EndFrame( double frameTime );
+
+    // Call after the frame has been presented. Records the latency of this frame's uploads
+    void Presented();
+
+    // Predicted microseconds for an upload of bytes
+    double Estimate( std::size_t bytes ) const { return m_Overhead + double( bytes ) / m_Throughput; }
+
+    std::size_t GetQueuedEntities() const { return m_QueuedEntities; }
+
+    std::size_t GetQueuedBytes() const { return m_QueuedBytes; }
+
+    std::size_t GetPeakQueuedBytes() const { return m_PeakQueuedBytes; }
+
+    std::size_t GetUploadedBytes() const { return m_UploadedBytes; }
+
+    // p in [0..100]. Returns microseconds
+    double GetLatencyPercentile( double p ) const;
+
+    void Report( FILE* out ) const;
+};
+
+#endif /* UPLOADSCHEDULER_H_ */
@@ -9,11 +9,13 @@
 #define VECTOR_H_
 
 #include "err.h"
+#include "simd.h"
 
 #include <cmath>
 #include <cstring>
+#include <limits>
 
-class Vector
+class SIMD_ALIGN(16) Vector
 {
 public:
     enum Coord {
@@ -33,6 +35,14 @@ private:
 #pragma pack( pop )
     // rest of class is inlined which degrades the whole vector into 4 floats and a "namespace" - never create a vtable for this class!!!
     // A vertex will only need 3 components, but all load store are 4 anyway...at the cost of an additional float...
+    // 16 byte aligned: one float[4] is exactly one SSE/NEON register. sizeof(Vector) stays 16!
+#ifdef SIMD_ENABLED
+    simd::float4 Load() const { return simd::load( vec ); }
+
+    void Store( simd::float4 v ) { simd::store( vec, v ); }
+
+    Vector( simd::float4 v ) { Store( v ); }
+#endif
 public:
     Vector() : vec({0,0,0,1})
     {
@@ -40,7 +50,21 @@ public:
 
     Vector( const Vector& v )
     {
+#ifdef SIMD_ENABLED
+        Store( v.Load() );
+#else
+        std::memcpy(vec,v.vec, 4*sizeof(float));
+#endif
+    }
+
+    Vector& operator=( const Vector& v )
+    {
+#ifdef SIMD_ENABLED
+        Store( v.Load() );
+#else
         std::memcpy(vec,v.vec, 4*sizeof(float));
+#endif
+        return *this;
     }
 
     Vector( const float v[4] )
@@ -85,48 +109,72 @@ public:
     }
 
     void operator+=( float v ) {
+#ifdef SIMD_ENABLED
+        Store( simd::add( Load(), simd::splat( v ) ) );
+#else
         vec[0] += v;
         vec[1] += v;
         vec[2] += v;
         vec[3] += v;
+#endif
     }
 
     void operator-=( float v ) {
+#ifdef SIMD_ENABLED
+        Store( simd::sub( Load(), simd::splat( v ) ) );
+#else
         vec[0] -= v;
         vec[1] -= v;
         vec[2] -= v;
         vec[3] -= v;
+#endif
     }
 
     void operator*=( float v ) {
+#ifdef SIMD_ENABLED
+        Store( simd::mul( Load(), simd::splat( v ) ) );
+#else
         vec[0] *= v;
         vec[1] *= v;
         vec[2] *= v;
         vec[3] *= v;
+#endif
     }
 
     void operator+=( const Vector& v )
     {
+#ifdef SIMD_ENABLED
+        Store( simd::add( Load(), v.Load() ) );
+#else
         vec[0] += v.vec[0];
         vec[1] += v.vec[1];
         vec[2] += v.vec[2];
         vec[3] += v.vec[3];
+#endif
     }
 
     void operator-=( const Vector& v )
     {
+#ifdef SIMD_ENABLED
+        Store( simd::sub( Load(), v.Load() ) );
+#else
         vec[0] -= v.vec[0];
         vec[1] -= v.vec[1];
         vec[2] -= v.vec[2];
         vec[3] -= v.vec[3];
+#endif
     }
 
     void operator*=( const Vector& v )
     {
+#ifdef SIMD_ENABLED
+        Store( simd::mul( Load(), v.Load() ) );
+#else
         vec[0] *= v.vec[0];
         vec[1] *= v.vec[1];
         vec[2] *= v.vec[2];
         vec[3] *= v.vec[3];
+#endif
     }
 
     Vector& Add( const Vector& v )
@@ -198,16 +246,27 @@ public:
     float Magnitude() const
     {
         // only x,y,z values - ignore w. Always positive. There is no neg sqrt
+#ifdef SIMD_ENABLED
+        return simd::sqrt1( Dot( *this ) );
+#else
         return std::sqrt( vec[0]*vec[0] + vec[1]*vec[1] + vec[2]*vec[2] );
+#endif
     }
 
     float Dot( const Vector& v ) const
     {
+#ifdef SIMD_ENABLED
+        return simd::dot3( Load(), v.Load() );
+#else
         return vec[0]*v.vec[0] + vec[1]*v.vec[1] + vec[2]*v.vec[2];
+#endif
     }
 
     Vector& Cross( const Vector& v )
     {
+#ifdef SIMD_ENABLED
+        Store( simd::cross3( Load(), v.Load() ) );
+#else
         float x = vec[Y] * v.vec[Z] - vec[Z] * v.vec[Y];
         float y = vec[Z] * v.vec[X] - vec[X] * v.vec[Z];
         float z = vec[X] * v.vec[Y] - vec[Y] * v.vec[X];
@@ -216,6 +275,7 @@ public:
         vec[Y] = y;
         vec[Z] = z;
         vec[W] = 0;
+#endif
         return *this;
     }
 
@@ -233,6 +293,28 @@ public:
     {
         return Vector( *this ).Normalize();
     }
+
+    // Same as Normalize() but uses the reciprocal square root estimate (~22 bits). Good enough for normals and directions
+    Vector& NormalizeFast()
+    {
+#ifdef SIMD_ENABLED
+        simd::float4 v = Load();
+        float lengthSq = simd::dot3( v, v );
+        if ( lengthSq < std::numeric_limits< float >::min() ) {
+            // the estimate flushes denormals to zero and returns inf - tiny vectors take the precise path
+            return Normalize();
+        }
+        Store( simd::mul( v, simd::rsqrt( simd::splat( lengthSq ) ) ) );
+        return *this;
+#else
+        return Normalize();
+#endif
+    }
+
+    Vector NormalizedFast() const
+    {
+        return Vector( *this ).NormalizeFast();
+    }
 };
 
 
@@ -0,0 +1,212 @@
+/*
+ * vertexformat.cpp
+ *
+ *  Created on: 2026-10-16
+ */
+
+#include "vertexformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <stdint.h>
+
+#if defined(SIMD_SSE) && defined(__F16C__)
+#include <immintrin.h>
+#define VERTEXFORMAT_F16C 1
+#endif
+
+static VertexFormat sDefaultFormat( VertexFormat::Float() );
+
+VertexFormat::VertexFormat( PositionEncoding p /*= POSITION_FLOAT*/, NormalEncoding n /*= NORMAL_FLOAT*/, ColorEncoding c /*= COLOR_FLOAT*/ )
+    : position(p)
+    , normal(n)
+    , color(c)
+{
+    ComputeLayout();
+}
+
+void VertexFormat::ComputeLayout()
+{
+    // every attribute is a multiple of 4 bytes - no padding required
+    positionOffset = 0;
+    normalOffset   = positionOffset + ( position == POSITION_FLOAT ? 16 : 8 );
+    colorOffset    = normalOffset   + ( normal   == NORMAL_FLOAT   ? 16 : 4 );
+    stride         = colorOffset    + ( color    == COLOR_FLOAT    ? 16 : 4 );
+}
+
+GLenum VertexFormat::GetPositionType() const
+{
+    switch ( position ) {
+    case POSITION_HALF:    return GL_HALF_FLOAT;
+    case POSITION_SNORM16: return GL_SHORT;
+    default:               return GL_FLOAT;
+    }
+}
+
+GLint VertexFormat::GetPositionSize() const
+{
+    // packed formats carry w in their padding. Let GL fill in w = 1
+    return position == POSITION_FLOAT ? 4 : 3;
+}
+
+GLenum VertexFormat::GetNormalType() const
+{
+    switch ( normal ) {
+    case NORMAL_2_10_10_10: return GL_INT_2_10_10_10_REV;
+    case NORMAL_SNORM8:     return GL_BYTE;
+    default:                return GL_FLOAT;
+    }
+}
+
+GLenum VertexFormat::GetColorType() const
+{
+    return color == COLOR_UNORM8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+}
+
+VertexFormat VertexFormat::Supported() const
+{
+    PositionEncoding p = position;
+    NormalEncoding   n = normal;
+    if ( p == POSITION_HALF && !glewGetExtension("GL_ARB_half_float_vertex") ) {
+        p = POSITION_SNORM16;
+    }
+    if ( n == NORMAL_2_10_10_10 && !glewGetExtension("GL_ARB_vertex_type_2_10_10_10_rev") ) {
+        n = NORMAL_SNORM8;
+    }
+    return VertexFormat( p, n, color );
+}
+
+const VertexFormat& VertexFormat::GetDefault()
+{
+    return sDefaultFormat;
+}
+
+void VertexFormat::SetDefault( const VertexFormat& format )
+{
+    sDefaultFormat = format;
+}
+
+// Encode kernels //////////////////////////////////////////////////////////////
+
+// IEEE half, round to nearest even. See F. Giesen, "float->half variants"
+static inline uint16_t floatToHalf( float f )
+{
+    uint32_t u;
+    std::memcpy( &u, &f, 4 );
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t h;
+    if ( u >= ( (127 + 16) << 23 ) ) {
+        // Inf or NaN (all exponent bits set)
+        h = ( u > ( 255u << 23 ) ) ? 0x7e00 : 0x7c00;
+    }
+    else if ( u < ( 113 << 23 ) ) {
+        // subnormal or zero: let the FPU do the rounding
+        const uint32_t denormMagicU = ( (127 - 15) + (23 - 10) + 1 ) << 23;
+        float denormMagic, v;
+        std::memcpy( &denormMagic, &denormMagicU, 4 );
+        std::memcpy( &v, &u, 4 );
+        v += denormMagic;
+        std::memcpy( &u, &v, 4 );
+        h = uint16_t( u - denormMagicU );
+    }
+    else {
+        uint32_t mantOdd = ( u >> 13 ) & 1;
+        u += ( uint32_t( 15 - 127 ) << 23 ) + 0xfff;
+        u += mantOdd;
+        h = uint16_t( u >> 13 );
+    }
+    return h | uint16_t( sign >> 16 );
+}
+
+static inline int quantize( float v, float scale, float lo, float hi )
+{
+    // nearbyint rounds to nearest even - same as cvtps2dq
+    return int( std::nearbyint( std::min( std::max( v * scale, lo ), hi ) ) );
+}
+
+static inline void encodeHalf4( const float* v, unsigned char* out )
+{
+#if defined(VERTEXFORMAT_F16C)
+    _mm_storel_epi64( (__m128i*)out, _mm_cvtps_ph( _mm_loadu_ps( v ), _MM_FROUND_TO_NEAREST_INT ) );
+#else
+    uint16_t h[4] = { floatToHalf( v[0] ), floatToHalf( v[1] ), floatToHalf( v[2] ), floatToHalf( v[3] ) };
+    std::memcpy( out, h, sizeof(h) );
+#endif
+}
+
+static inline void encodeSnorm16( const float* v, float scale, unsigned char* out )
+{
+#if defined(SIMD_SSE)
+    __m128 s = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( v ), _mm_set1_ps( scale ) ), _mm_set1_ps( -32767.0f ) ), _mm_set1_ps( 32767.0f ) );
+    __m128i i = _mm_cvtps_epi32( s );
+    _mm_storel_epi64( (__m128i*)out, _mm_packs_epi32( i, i ) );
+#else
+    int16_t s[4] = { int16_t( quantize( v[0], scale, -32767, 32767 ) ), int16_t( quantize( v[1], scale, -32767, 32767 ) ),
+                     int16_t( quantize( v[2], scale, -32767, 32767 ) ), int16_t( quantize( v[3], scale, -32767, 32767 ) ) };
+    std::memcpy( out, s, sizeof(s) );
+#endif
+}
+
+static inline void encode2_10_10_10( const float* v, unsigned char* out )
+{
+    uint32_t x = uint32_t( quantize( v[0], 511, -511, 511 ) ) & 0x3ff;
+    uint32_t y = uint32_t( quantize( v[1], 511, -511, 511 ) ) & 0x3ff;
+    uint32_t z = uint32_t( quantize( v[2], 511, -511, 511 ) ) & 0x3ff;
+    uint32_t packed = x | ( y << 10 ) | ( z << 20 );
+    std::memcpy( out, &packed, 4 );
+}
+
+static inline void encodeSnorm8( const float* v, unsigned char* out )
+{
+    int8_t s[4] = { int8_t( quantize( v[0], 127, -127, 127 ) ), int8_t( quantize( v[1], 127, -127, 127 ) ), int8_t( quantize( v[2], 127, -127, 127 ) ), 0 };
+    std::memcpy( out, s, sizeof(s) );
+}
+
+static inline void encodeUnorm8( const float* v, unsigned char* out )
+{
+#if defined(SIMD_SSE)
+    __m128 s = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( v ), _mm_set1_ps( 255.0f ) ), _mm_setzero_ps() ), _mm_set1_ps( 255.0f ) );
+    __m128i i = _mm_cvtps_epi32( s );
+    i = _mm_packs_epi32( i, i );
+    i = _mm_packus_epi16( i, i );
+    int packed = _mm_cvtsi128_si32( i );
+    std::memcpy( out, &packed, 4 );
+#else
+    out[0] = (unsigned char)quantize( v[0], 255, 0, 255 );
+    out[1] = (unsigned char)quantize( v[1], 255, 0, 255 );
+    out[2] = (unsigned char)quantize( v[2], 255, 0, 255 );
+    out[3] = (unsigned char)quantize( v[3], 255, 0, 255 );
+#endif
+}
+
+void VertexFormat::Encode( const VertexArray& vertices, float positionScale, std::vector< unsigned char >& out ) const
+{
+    out.resize( vertices.size() * stride );
+    const float snormScale = positionScale * 32767.0f;
+    unsigned char* dst = out.empty() ? nullptr : &out[0];
+    for ( auto& vertex : vertices ) {
+        const float* p = vertex.position;
+        const float* n = vertex.normal;
+        const float* c = vertex.color;
+
+        switch ( position ) {
+        case POSITION_HALF:    encodeHalf4( p, dst + positionOffset ); break;
+        case POSITION_SNORM16: encodeSnorm16( p, snormScale, dst + positionOffset ); break;
+        default:               std::memcpy( dst + positionOffset, p, 16 ); break;
+        }
+        switch ( normal ) {
+        case NORMAL_2_10_10_10: encode2_10_10_10( n, dst + normalOffset ); break;
+        case NORMAL_SNORM8:     encodeSnorm8( n, dst + normalOffset ); break;
+        default:                std::memcpy( dst + normalOffset, n, 16 ); break;
+        }
+        switch ( color ) {
+        case COLOR_UNORM8: encodeUnorm8( c, dst + colorOffset ); break;
+        default:           std::memcpy( dst + colorOffset, c, 16 ); break;
+        }
+        dst += stride;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * vertexformat.h
+ *
+ *  Created on: 2026-10-16
+ */
+
+#ifndef VERTEXFORMAT_H_
+#define VERTEXFORMAT_H_
+
+#include "vector.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// Interleaved vertex. Everything the fixed function pipeline fetches for one vertex sits next to each other
+struct Vertex
+{
+    Vector position;
+    Vector normal;
+    Vector color;
+};
+
+typedef std::vector< Vector >       VectorArray;
+typedef std::vector< Vertex >       VertexArray;
+typedef std::vector< unsigned int > IndexArray;
+
+// Ends a triangle strip in an IndexArray. Narrowed to the restart index of the index type on upload
+const unsigned int RESTART_INDEX = ~0u;
+
+// Describes how the interleaved Vertex (3 x Vector = 48 bytes) is stored in the VBO.
+// The compact format needs 16 bytes per vertex: half float position, 2_10_10_10 normal, RGBA8 color.
+struct VertexFormat
+{
+    enum PositionEncoding {
+        POSITION_FLOAT = 0,     // 4 x float, 16 bytes
+        POSITION_HALF,          // 4 x half float, 8 bytes (GL_ARB_half_float_vertex)
+        POSITION_SNORM16,       // 3 x short + pad, 8 bytes. Scaled by the mesh bounds in Mesh::Draw
+    };
+    enum NormalEncoding {
+        NORMAL_FLOAT = 0,       // 4 x float, 16 bytes
+        NORMAL_2_10_10_10,      // signed 10 bit x,y,z packed into 4 bytes (GL_ARB_vertex_type_2_10_10_10_rev)
+        NORMAL_SNORM8,          // 3 x signed byte + pad, 4 bytes
+    };
+    enum ColorEncoding {
+        COLOR_FLOAT = 0,        // 4 x float, 16 bytes
+        COLOR_UNORM8,           // RGBA8, 4 bytes
+    };
+
+    PositionEncoding position;
+    NormalEncoding   normal;
+    ColorEncoding    color;
+
+    // Layout - set by ComputeLayout()
+    GLsizei stride;
+    GLsizei positionOffset;
+    GLsizei normalOffset;
+    GLsizei colorOffset;
+
+    VertexFormat( PositionEncoding p = POSITION_FLOAT, NormalEncoding n = NORMAL_FLOAT, ColorEncoding c = COLOR_FLOAT );
+
+    bool IsFloat() const { return position == POSITION_FLOAT && normal == NORMAL_FLOAT && color == COLOR_FLOAT; }
+
+    // GL type and component count for gl*Pointer
+    GLenum GetPositionType() const;
+    GLint  GetPositionSize() const;
+    GLenum GetNormalType() const;
+    GLenum GetColorType() const;
+
+    // Replaces encodings the current GL context can't handle with the next best one. Render thread only
+    VertexFormat Supported() const;
+
+    // Encodes vertices into out. positionScale: 1/max(|x|,|y|,|z|) for POSITION_SNORM16, ignored otherwise
+    void Encode( const VertexArray& vertices, float positionScale, std::vector< unsigned char >& out ) const;
+
+    static VertexFormat Float() { return VertexFormat(); }
+
+    static VertexFormat Compact() { return VertexFormat( POSITION_HALF, NORMAL_2_10_10_10, COLOR_UNORM8 ); }
+
+    // Format new meshes are created with
+    static const VertexFormat& GetDefault();
+
+    static void SetDefault( const VertexFormat& format );
+private:
+    void ComputeLayout();
+};
+
+#endif /* VERTEXFORMAT_H_ */
@@ -13,6 +13,7 @@
 Viewport::Viewport( int width, int height )
     : m_Width(width)
     , m_Height(height)
+    , m_Projection( Matrix4::Perspective( 60.0f, float(width)/float(height), 1.0f, 1000.0f ) ) // FOV, AspectRatio, NearClip, FarClip
 {
 }
 
@@ -37,8 +38,7 @@ void Viewport::Render(long ticks)
 
     // set perspective viewing frustum
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(60.0f, ((float)m_Width)/((float)m_Height), 1.0f, 1000.0f); // FOV, AspectRatio, NearClip, FarClip
+    glLoadMatrixf( m_Projection );
 
     // switch to modelview matrix in order to set scene
     glMatrixMode(GL_MODELVIEW);
@@ -10,19 +10,29 @@
 
 #include "err.h"
 #include "entity.h"
+#include "matrix.h"
 
 class Viewport : public Entity
 {
     int    m_Width;
     int    m_Height;
+    Matrix4 m_Projection;
 public:
     Viewport( int width, int height );
 
     virtual ~Viewport();
 
+    const Matrix4& GetProjection() const { return m_Projection; }
+
 private:
     virtual bool Initialize();
 
+    virtual void GetDrawInfo( DrawInfo& info ) const
+    {
+        info.layer      = DrawInfo::LAYER_SETUP;
+        info.projection = &m_Projection;
+    }
+
     virtual bool HandleEvent( const SDL_Event& event );
 
     virtual void Render( long ticks );